@@ -0,0 +1,35 @@
+#pragma once
+
+#include "torchrl/envs/BatchedAbstractEnv.hpp"
+
+/// @brief Same env as MountainCarContinuousEnv, but all the
+/// cars are stepped at once using SIMD instructions if available
+class BatchedMountainCarContinuousEnv : public BatchedAbstractEnv
+{
+public:
+    BatchedMountainCarContinuousEnv(const int64_t num_envs_, const unsigned int seed = 0);
+    virtual ~BatchedMountainCarContinuousEnv();
+
+    virtual int64_t GetObservationSize() const override;
+    virtual int64_t GetActionSize() const override;
+
+    virtual void GetObs(float* obs_out) const override;
+
+    /// @brief Set the state of one car
+    void SetState(const int64_t index, const float position_, const float velocity_);
+
+protected:
+    virtual void ResetImpl(const int64_t index) override;
+    virtual void GetEnvObs(const int64_t index, float* obs_out) const override;
+    virtual void RenderImpl() override;
+    virtual void StepBatch(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out) override;
+
+private:
+    template<class T>
+    void StepKernel(const int64_t i, const float* actions, float* rewards_out);
+
+private:
+    std::vector<float> position;
+    std::vector<float> velocity;
+    std::vector<float> last_action;
+};
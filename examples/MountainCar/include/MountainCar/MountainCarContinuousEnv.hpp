@@ -14,9 +14,14 @@ public:
     virtual void ResetImpl() override;
     virtual void RenderImpl() override;
     virtual StepResult StepImpl(const torch::Tensor& action) override;
+    virtual StepResult StepInPlaceImpl(const float* action, float* obs_out) override;
     virtual torch::Tensor GetObs() const override;
+    virtual void WriteObs(float* obs_out) const override;
 
-private:
+    /// @brief Draw a mountain car in the console
+    static void Draw(const float position, const float last_action);
+
+public:
     static constexpr float min_action = -1.0f;
     static constexpr float max_action = 1.0f;
     static constexpr float min_position = -1.2f;
@@ -25,6 +30,7 @@ private:
     static constexpr float goal_position = 0.45f;
     static constexpr float power = 0.0015f;
 
+private:
     float position;
     float velocity;
 
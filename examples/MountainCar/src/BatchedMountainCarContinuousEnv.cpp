@@ -0,0 +1,113 @@
+#include "MountainCar/BatchedMountainCarContinuousEnv.hpp"
+#include "MountainCar/MountainCarContinuousEnv.hpp"
+
+#include "torchrl/utils/SIMD.hpp"
+
+using Env = MountainCarContinuousEnv;
+
+BatchedMountainCarContinuousEnv::BatchedMountainCarContinuousEnv(const int64_t num_envs_, const unsigned int seed) : BatchedAbstractEnv(num_envs_, seed)
+{
+    position = std::vector<float>(num_envs, 0.0f);
+    velocity = std::vector<float>(num_envs, 0.0f);
+    last_action = std::vector<float>(num_envs, 0.0f);
+}
+
+BatchedMountainCarContinuousEnv::~BatchedMountainCarContinuousEnv()
+{
+
+}
+
+int64_t BatchedMountainCarContinuousEnv::GetObservationSize() const
+{
+    return 2;
+}
+
+int64_t BatchedMountainCarContinuousEnv::GetActionSize() const
+{
+    return 1;
+}
+
+void BatchedMountainCarContinuousEnv::GetObs(float* obs_out) const
+{
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        GetEnvObs(i, obs_out + 2 * i);
+    }
+}
+
+void BatchedMountainCarContinuousEnv::SetState(const int64_t index, const float position_, const float velocity_)
+{
+    position[index] = position_;
+    velocity[index] = velocity_;
+}
+
+void BatchedMountainCarContinuousEnv::ResetImpl(const int64_t index)
+{
+    // Same draws as MountainCarContinuousEnv, so both envs start in the same state with the same seed
+    position[index] = std::uniform_real_distribution<float>(-0.6f, 0.4f)(random_engines[index]);
+    velocity[index] = 0.0f;
+    last_action[index] = 0.0f;
+}
+
+void BatchedMountainCarContinuousEnv::GetEnvObs(const int64_t index, float* obs_out) const
+{
+    obs_out[0] = position[index];
+    obs_out[1] = velocity[index];
+}
+
+void BatchedMountainCarContinuousEnv::RenderImpl()
+{
+    Env::Draw(position[0], last_action[0]);
+}
+
+template<class T>
+void BatchedMountainCarContinuousEnv::StepKernel(const int64_t i, const float* actions, float* rewards_out)
+{
+    using namespace simd;
+
+    const T raw_a = Load<T>(actions + i);
+    const T a = Clamp(raw_a, Set1<T>(Env::min_action), Set1<T>(Env::max_action));
+    T pos = Load<T>(position.data() + i);
+    T vel = Load<T>(velocity.data() + i);
+
+    vel = Add(vel, Sub(Mul(a, Set1<T>(Env::power)), Mul(Set1<T>(0.0025f), Cos(Mul(Set1<T>(3.0f), pos)))));
+    vel = Clamp(vel, Set1<T>(-Env::max_speed), Set1<T>(Env::max_speed));
+
+    pos = Clamp(Add(pos, vel), Set1<T>(Env::min_position), Set1<T>(Env::max_position));
+    vel = Select(And(LessEqual(pos, Set1<T>(Env::min_position)), Less(vel, Set1<T>(0.0f))), Set1<T>(0.0f), vel);
+
+    Store(position.data() + i, pos);
+    Store(velocity.data() + i, vel);
+    Store(last_action.data() + i, a);
+    // Goal reward is added afterwards, with the terminal states
+    Store(rewards_out + i, Mul(Mul(Set1<T>(-0.1f), raw_a), raw_a));
+}
+
+void BatchedMountainCarContinuousEnv::StepBatch(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out)
+{
+    int64_t i = 0;
+#if TORCHRL_SIMD_WIDTH > 1
+    for (; i + simd::width <= num_envs; i += simd::width)
+    {
+        StepKernel<simd::vfloat>(i, actions, rewards_out);
+    }
+#endif
+    // Remaining envs
+    for (; i < num_envs; ++i)
+    {
+        StepKernel<float>(i, actions, rewards_out);
+    }
+
+    for (i = 0; i < num_envs; ++i)
+    {
+        obs_out[2 * i + 0] = position[i];
+        obs_out[2 * i + 1] = velocity[i];
+
+        const TerminalState is_final = current_episode_length[i] == 999 ? TerminalState::Timeout : (position[i] >= Env::goal_position ? TerminalState::Terminal : TerminalState::NotTerminal);
+        terminal_out[i] = static_cast<uint8_t>(is_final);
+        if (is_final == TerminalState::Terminal)
+        {
+            rewards_out[i] += 100.0f;
+        }
+    }
+}
@@ -30,6 +30,11 @@ void MountainCarContinuousEnv::ResetImpl()
 }
 
 void MountainCarContinuousEnv::RenderImpl()
+{
+    Draw(position, last_action);
+}
+
+void MountainCarContinuousEnv::Draw(const float position, const float last_action)
 {
     const int width = 62;
     const int height = 27;
@@ -106,7 +111,18 @@ void MountainCarContinuousEnv::RenderImpl()
 
 StepResult MountainCarContinuousEnv::StepImpl(const torch::Tensor& action)
 {
+    torch::Tensor obs = torch::zeros({ 2 });
     const float raw_a = action.item<float>();
+
+    StepResult result = StepInPlaceImpl(&raw_a, obs.data_ptr<float>());
+    result.obs = obs;
+
+    return result;
+}
+
+StepResult MountainCarContinuousEnv::StepInPlaceImpl(const float* action, float* obs_out)
+{
+    const float raw_a = action[0];
     const float a = std::min(max_action, std::max(min_action, raw_a));
 
     velocity += a * power - 0.0025f * std::cos(3.0f * position);
@@ -123,19 +139,21 @@ StepResult MountainCarContinuousEnv::StepImpl(const torch::Tensor& action)
     const TerminalState is_final = current_episode_length == 999 ? TerminalState::Timeout : (position >= goal_position ? TerminalState::Terminal : TerminalState::NotTerminal );
     float reward = -raw_a * raw_a * 0.1f + (is_final == TerminalState::Terminal ? 100.0f : 0.0f);
 
-    torch::Tensor obs = GetObs();
+    WriteObs(obs_out);
 
-    return StepResult{ obs, reward, is_final };
+    return StepResult{ torch::Tensor(), reward, is_final };
 }
 
 torch::Tensor MountainCarContinuousEnv::GetObs() const
 {
     torch::Tensor output = torch::zeros({ 2 });
-    float* data = output.data<float>();
-
-    data[0] = position;
-    data[1] = velocity;
+    WriteObs(output.data_ptr<float>());
 
     return output;
 }
 
+void MountainCarContinuousEnv::WriteObs(float* obs_out) const
+{
+    obs_out[0] = position;
+    obs_out[1] = velocity;
+}
@@ -0,0 +1,12 @@
+#include "torchrl/utils/EnvBenchmark.hpp"
+
+#include "MountainCar/BatchedMountainCarContinuousEnv.hpp"
+#include "MountainCar/MountainCarContinuousEnv.hpp"
+
+int main(int argc, char* argv[])
+{
+    // Bigger action range in the accuracy check to check the clamping
+    return env_benchmark::Run<MountainCarContinuousEnv, BatchedMountainCarContinuousEnv>(argc, argv,
+        "MountainCarContinuousEnv", "BatchedMountainCarContinuousEnv", 1.0f, 1.5f,
+        [](BatchedMountainCarContinuousEnv& env, const int64_t i, const float* obs) { env.SetState(i, obs[0], obs[1]); });
+}
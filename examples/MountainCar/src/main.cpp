@@ -1,6 +1,7 @@
 #include "torchrl/algorithms/ppo/PPO.hpp"
 #include "torchrl/algorithms/ppo/PPOArgs.hpp"
 #include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/utils/Distributed.hpp"
 
 #include "MountainCar/MountainCarContinuousEnv.hpp"
 
@@ -33,15 +34,23 @@ int main(char argc, char* argv[])
         // Parse user specified ones
         args.ParseArgs(argc, argv);
 
-        torch::manual_seed(args.seed);
+        // With --world_size > 1, one process per rank must be launched with the same args
+        std::unique_ptr<Distributed> distributed;
+        if (args.world_size > 1)
+        {
+            distributed = std::make_unique<Distributed>(args.rank, args.world_size, args.dist_store);
+        }
+
+        torch::manual_seed(args.seed + args.rank);
 
         //########################################################
         //######################### TRAIN ########################
         //########################################################
         VectorizedEnv env(args.normalize_env_obs, args.normalize_env_reward);
-        env.CreateEnvs<MountainCarContinuousEnv>(args.n_envs, args.seed);
+        env.CreateEnvs<MountainCarContinuousEnv>(args.n_envs, args.seed + args.rank * args.n_envs);
+        env.SetNumThreads(args.n_env_threads);
 
-        PPO ppo(env, args);
+        PPO ppo(env, args, distributed.get());
 
         auto start = std::chrono::steady_clock::now();
         ppo.Learn(50000);
@@ -49,6 +58,11 @@ int main(char argc, char* argv[])
         std::cout << "Training done in: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / 1000.0 << "s" << std::endl;
     
 
+        if (args.rank != 0)
+        {
+            return 0;
+        }
+
         //#######################################################
         //######################### PLAY ########################
         //#######################################################
@@ -113,6 +127,7 @@ int main(char argc, char* argv[])
             //########################################################
             VectorizedEnv env(args.normalize_env_obs, args.normalize_env_reward);
             env.CreateEnvs<MountainCarContinuousEnv>(args.n_envs, args.seed);
+            env.SetNumThreads(args.n_env_threads);
 
             PPO ppo(env, args);
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "torchrl/envs/BatchedAbstractEnv.hpp"
+
+/// @brief Same env as PendulumEnv, but all the pendulums
+/// are stepped at once using SIMD instructions if available
+class BatchedPendulumEnv : public BatchedAbstractEnv
+{
+public:
+    BatchedPendulumEnv(const int64_t num_envs_, const unsigned int seed = 0);
+    virtual ~BatchedPendulumEnv();
+
+    virtual int64_t GetObservationSize() const override;
+    virtual int64_t GetActionSize() const override;
+
+    virtual void GetObs(float* obs_out) const override;
+
+    /// @brief Set the state of one pendulum
+    void SetState(const int64_t index, const float theta_, const float thetadot_);
+
+protected:
+    virtual void ResetImpl(const int64_t index) override;
+    virtual void GetEnvObs(const int64_t index, float* obs_out) const override;
+    virtual void RenderImpl() override;
+    virtual void StepBatch(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out) override;
+
+private:
+    template<class T>
+    void StepKernel(const int64_t i, const float* actions, float* rewards_out);
+
+private:
+    std::vector<float> theta;
+    std::vector<float> thetadot;
+    std::vector<float> last_action;
+
+    /// @brief cos/sin of theta after the last step, interleaved in the obs afterwards
+    std::vector<float> cos_theta;
+    std::vector<float> sin_theta;
+};
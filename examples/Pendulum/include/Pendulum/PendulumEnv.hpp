@@ -14,7 +14,12 @@ public:
     virtual void ResetImpl() override;
     virtual void RenderImpl() override;
     virtual StepResult StepImpl(const torch::Tensor& action) override;
+    virtual StepResult StepInPlaceImpl(const float* action, float* obs_out) override;
     virtual torch::Tensor GetObs() const override;
+    virtual void WriteObs(float* obs_out) const override;
+
+    /// @brief Draw a pendulum in the console
+    static void Draw(const float theta, const float last_action);
 
 private:
     float theta;
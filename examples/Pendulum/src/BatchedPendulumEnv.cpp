@@ -0,0 +1,116 @@
+#include "Pendulum/BatchedPendulumEnv.hpp"
+#include "Pendulum/PendulumEnv.hpp"
+
+#include "torchrl/utils/SIMD.hpp"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+BatchedPendulumEnv::BatchedPendulumEnv(const int64_t num_envs_, const unsigned int seed) : BatchedAbstractEnv(num_envs_, seed)
+{
+    theta = std::vector<float>(num_envs, static_cast<float>(M_PI_2));
+    thetadot = std::vector<float>(num_envs, 0.0f);
+    last_action = std::vector<float>(num_envs, 0.0f);
+    cos_theta = std::vector<float>(num_envs, 0.0f);
+    sin_theta = std::vector<float>(num_envs, 0.0f);
+}
+
+BatchedPendulumEnv::~BatchedPendulumEnv()
+{
+
+}
+
+int64_t BatchedPendulumEnv::GetObservationSize() const
+{
+    return 3;
+}
+
+int64_t BatchedPendulumEnv::GetActionSize() const
+{
+    return 1;
+}
+
+void BatchedPendulumEnv::GetObs(float* obs_out) const
+{
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        GetEnvObs(i, obs_out + 3 * i);
+    }
+}
+
+void BatchedPendulumEnv::SetState(const int64_t index, const float theta_, const float thetadot_)
+{
+    theta[index] = theta_;
+    thetadot[index] = thetadot_;
+}
+
+void BatchedPendulumEnv::ResetImpl(const int64_t index)
+{
+    // Same draws as PendulumEnv, so both envs start in the same state with the same seed
+    theta[index] = std::uniform_real_distribution<float>(-M_PI, M_PI)(random_engines[index]);
+    thetadot[index] = std::uniform_real_distribution<float>(-1.0f, 1.0f)(random_engines[index]);
+    last_action[index] = 0.0f;
+}
+
+void BatchedPendulumEnv::GetEnvObs(const int64_t index, float* obs_out) const
+{
+    simd::SinCos(theta[index], obs_out[1], obs_out[0]);
+    obs_out[2] = thetadot[index];
+}
+
+void BatchedPendulumEnv::RenderImpl()
+{
+    PendulumEnv::Draw(theta[0], last_action[0]);
+}
+
+template<class T>
+void BatchedPendulumEnv::StepKernel(const int64_t i, const float* actions, float* rewards_out)
+{
+    using namespace simd;
+
+    const T a = Clamp(Load<T>(actions + i), Set1<T>(-2.0f), Set1<T>(2.0f));
+    const T th = Load<T>(theta.data() + i);
+    T thdot = Load<T>(thetadot.data() + i);
+
+    // normalized between -M_PI and M_PI
+    const T normalized_theta = Fma(Set1<T>(static_cast<float>(-2 * M_PI)), Round(Mul(th, Set1<T>(static_cast<float>(0.5 * M_1_PI)))), th);
+    const T pos_reward = Add(Add(Mul(normalized_theta, normalized_theta), Mul(Mul(Set1<T>(0.1f), thdot), thdot)), Mul(Mul(Set1<T>(0.001f), a), a));
+
+    thdot = Add(thdot, Mul(Fma(Set1<T>(3.0f * 10.0f / 2.0f), Sin(th), Mul(Set1<T>(3.0f), a)), Set1<T>(0.05f)));
+    thdot = Clamp(thdot, Set1<T>(-8.0f), Set1<T>(8.0f));
+    const T new_th = Fma(thdot, Set1<T>(0.05f), th);
+
+    T s, c;
+    SinCos(new_th, s, c);
+
+    Store(theta.data() + i, new_th);
+    Store(thetadot.data() + i, thdot);
+    Store(last_action.data() + i, a);
+    Store(cos_theta.data() + i, c);
+    Store(sin_theta.data() + i, s);
+    Store(rewards_out + i, Sub(Set1<T>(0.0f), pos_reward));
+}
+
+void BatchedPendulumEnv::StepBatch(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out)
+{
+    int64_t i = 0;
+#if TORCHRL_SIMD_WIDTH > 1
+    for (; i + simd::width <= num_envs; i += simd::width)
+    {
+        StepKernel<simd::vfloat>(i, actions, rewards_out);
+    }
+#endif
+    // Remaining envs
+    for (; i < num_envs; ++i)
+    {
+        StepKernel<float>(i, actions, rewards_out);
+    }
+
+    for (i = 0; i < num_envs; ++i)
+    {
+        obs_out[3 * i + 0] = cos_theta[i];
+        obs_out[3 * i + 1] = sin_theta[i];
+        obs_out[3 * i + 2] = thetadot[i];
+        terminal_out[i] = static_cast<uint8_t>(current_episode_length[i] == 200 ? TerminalState::Timeout : TerminalState::NotTerminal);
+    }
+}
@@ -83,6 +83,11 @@ void PendulumEnv::ResetImpl()
 }
 
 void PendulumEnv::RenderImpl()
+{
+    Draw(theta, last_action);
+}
+
+void PendulumEnv::Draw(const float theta, const float last_action)
 {
     const int width = 41;
     const int height = 21;
@@ -204,7 +209,18 @@ void PendulumEnv::RenderImpl()
 
 StepResult PendulumEnv::StepImpl(const torch::Tensor& action)
 {
-    const float a = std::min(2.0f, std::max(-2.0f, action.item<float>()));
+    torch::Tensor obs = torch::zeros({ 3 });
+    const float a = action.item<float>();
+
+    StepResult result = StepInPlaceImpl(&a, obs.data_ptr<float>());
+    result.obs = obs;
+
+    return result;
+}
+
+StepResult PendulumEnv::StepInPlaceImpl(const float* action, float* obs_out)
+{
+    const float a = std::min(2.0f, std::max(-2.0f, action[0]));
     const float normalized_theta = remainderf(theta, 2 * M_PI); // normalized between -M_PI and M_PI
     const float pos_reward = normalized_theta * normalized_theta + 0.1f * thetadot * thetadot + 0.001f * a * a;
 
@@ -213,20 +229,23 @@ StepResult PendulumEnv::StepImpl(const torch::Tensor& action)
     theta = theta + thetadot * 0.05f;
     last_action = a;
 
-    torch::Tensor obs = GetObs();
+    WriteObs(obs_out);
     const TerminalState is_final = current_episode_length == 200 ? TerminalState::Timeout : TerminalState::NotTerminal;
 
-    return StepResult{obs, -pos_reward, is_final};
+    return StepResult{ torch::Tensor(), -pos_reward, is_final };
 }
 
 torch::Tensor PendulumEnv::GetObs() const
 {
     torch::Tensor output = torch::zeros({ 3 });
-    float* data = output.data<float>();
-
-    data[0] = std::cos(theta);
-    data[1] = std::sin(theta);
-    data[2] = thetadot;
+    WriteObs(output.data_ptr<float>());
 
     return output;
 }
+
+void PendulumEnv::WriteObs(float* obs_out) const
+{
+    obs_out[0] = std::cos(theta);
+    obs_out[1] = std::sin(theta);
+    obs_out[2] = thetadot;
+}
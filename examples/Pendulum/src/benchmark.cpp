@@ -0,0 +1,14 @@
+#include "torchrl/utils/EnvBenchmark.hpp"
+
+#include "Pendulum/BatchedPendulumEnv.hpp"
+#include "Pendulum/PendulumEnv.hpp"
+
+#include <cmath>
+
+int main(int argc, char* argv[])
+{
+    // Bigger action range in the accuracy check to check the clamping. As the dynamics
+    // are chaotic, the batched envs are synchronized with the scalar ones before each step
+    return env_benchmark::Run<PendulumEnv, BatchedPendulumEnv>(argc, argv, "PendulumEnv", "BatchedPendulumEnv", 2.0f, 3.0f,
+        [](BatchedPendulumEnv& env, const int64_t i, const float* obs) { env.SetState(i, std::atan2(obs[1], obs[0]), obs[2]); });
+}
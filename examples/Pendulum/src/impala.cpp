@@ -0,0 +1,59 @@
+#include "torchrl/algorithms/impala/IMPALA.hpp"
+#include "torchrl/algorithms/impala/IMPALAArgs.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+
+#include "Pendulum/PendulumEnv.hpp"
+
+int main(char argc, char* argv[])
+{
+    try
+    {
+        IMPALAArgs args;
+
+        // Manually set args for this example
+        args.seed = 12345;
+
+        // Parse user specified ones
+        args.ParseArgs(argc, argv);
+
+        torch::manual_seed(args.seed);
+
+        //########################################################
+        //######################### TRAIN ########################
+        //########################################################
+        // One vectorized env per actor, with different seeds
+        std::vector<std::unique_ptr<VectorizedEnv>> envs;
+        std::vector<VectorizedEnv*> actor_envs;
+        for (uint64_t i = 0; i < args.n_actors; ++i)
+        {
+            envs.push_back(std::make_unique<VectorizedEnv>(args.normalize_env_obs, args.normalize_env_reward));
+            envs.back()->CreateEnvs<PendulumEnv>(args.n_envs, args.seed + i * args.n_envs);
+            envs.back()->SetNumThreads(args.n_env_threads);
+            actor_envs.push_back(envs.back().get());
+        }
+
+        IMPALA impala(actor_envs, args);
+
+        auto start = std::chrono::steady_clock::now();
+        impala.Learn(150000);
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "Training done in: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / 1000.0 << "s" << std::endl;
+
+        //#######################################################
+        //######################### PLAY ########################
+        //#######################################################
+
+        // We recreate everything so we're sure data will be loaded from the files
+        VectorizedEnv env_play(args.normalize_env_obs, args.normalize_env_reward);
+        env_play.CreateEnvs<PendulumEnv>(1, args.seed + 42);
+        IMPALA impala_play({ &env_play }, args);
+
+        impala_play.Play(10);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "torchrl/algorithms/ppo/PPO.hpp"
 #include "torchrl/algorithms/ppo/PPOArgs.hpp"
 #include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/utils/Distributed.hpp"
 
 #include "Pendulum/PendulumEnv.hpp"
 
@@ -17,15 +18,23 @@ int main(char argc, char* argv[])
         // Parse user specified ones
         args.ParseArgs(argc, argv);
 
-        torch::manual_seed(args.seed);
+        // With --world_size > 1, one process per rank must be launched with the same args
+        std::unique_ptr<Distributed> distributed;
+        if (args.world_size > 1)
+        {
+            distributed = std::make_unique<Distributed>(args.rank, args.world_size, args.dist_store);
+        }
+
+        torch::manual_seed(args.seed + args.rank);
 
         //########################################################
         //######################### TRAIN ########################
         //########################################################
         VectorizedEnv env(args.normalize_env_obs, args.normalize_env_reward);
-        env.CreateEnvs<PendulumEnv>(args.n_envs, args.seed);
+        env.CreateEnvs<PendulumEnv>(args.n_envs, args.seed + args.rank * args.n_envs);
+        env.SetNumThreads(args.n_env_threads);
 
-        PPO ppo(env, args);
+        PPO ppo(env, args, distributed.get());
 
         auto start = std::chrono::steady_clock::now();
         ppo.Learn(150000);
@@ -33,6 +42,11 @@ int main(char argc, char* argv[])
         std::cout << "Training done in: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / 1000.0 << "s" << std::endl;
 
 
+        if (args.rank != 0)
+        {
+            return 0;
+        }
+
         //#######################################################
         //######################### PLAY ########################
         //#######################################################
@@ -69,43 +83,49 @@ int main(char argc, char* argv[])
         const std::string base_path = args.exp_path;
         const unsigned int base_seed = args.seed;
 
+        // Each seed is trained with and without compact rollouts, to compare their learning curves
         for (size_t i = 0; i < 10; ++i)
         {
-            args.exp_path = base_path + "_" + std::to_string(i);
-            args.seed = base_seed + i;
-            std::cout << "Starting training " << i << " with seed " << args.seed << std::endl;
-
-
-            torch::manual_seed(args.seed);
-
-            //########################################################
-            //######################### TRAIN ########################
-            //########################################################
-            VectorizedEnv env(args.normalize_env_obs, args.normalize_env_reward);
-            env.CreateEnvs<PendulumEnv>(args.n_envs, args.seed);
-
-            PPO ppo(env, args);
-
-            ppo.Learn(150000, false, false);
-
-            //#######################################################
-            //######################### PLAY ########################
-            //#######################################################
-            std::cout << "Starting testing " << i << std::endl;
-
-            // We recreate everything so we're sure data will be loaded from the files
-            VectorizedEnv env_play(args.normalize_env_obs, args.normalize_env_reward);
-            env_play.CreateEnvs<PendulumEnv>(1, args.seed + 42);
-            PPO ppo_play(env_play, args);
-
-            std::vector<std::pair<uint64_t, float> > played_episodes = ppo_play.Play(100, false);
-            std::ofstream played(args.exp_path + "/played.csv", std::ios::out);
-            played << "Episode length\t" << "Episode reward\t" << std::endl;
-            for (const auto& p : played_episodes)
+            for (const bool compact : { false, true })
             {
-                played << p.first << "\t" << p.second << "\t" << std::endl;
+                args.compact_rollouts = compact;
+                args.exp_path = base_path + (compact ? "_compact_" : "_") + std::to_string(i);
+                args.seed = base_seed + i;
+                std::cout << "Starting training " << i << " with seed " << args.seed << (compact ? " (compact rollouts)" : "") << std::endl;
+
+
+                torch::manual_seed(args.seed);
+
+                //########################################################
+                //######################### TRAIN ########################
+                //########################################################
+                VectorizedEnv env(args.normalize_env_obs, args.normalize_env_reward);
+                env.CreateEnvs<PendulumEnv>(args.n_envs, args.seed);
+                env.SetNumThreads(args.n_env_threads);
+
+                PPO ppo(env, args);
+
+                ppo.Learn(150000, false, false);
+
+                //#######################################################
+                //######################### PLAY ########################
+                //#######################################################
+                std::cout << "Starting testing " << i << std::endl;
+
+                // We recreate everything so we're sure data will be loaded from the files
+                VectorizedEnv env_play(args.normalize_env_obs, args.normalize_env_reward);
+                env_play.CreateEnvs<PendulumEnv>(1, args.seed + 42);
+                PPO ppo_play(env_play, args);
+
+                std::vector<std::pair<uint64_t, float> > played_episodes = ppo_play.Play(100, false);
+                std::ofstream played(args.exp_path + "/played.csv", std::ios::out);
+                played << "Episode length\t" << "Episode reward\t" << std::endl;
+                for (const auto& p : played_episodes)
+                {
+                    played << p.first << "\t" << p.second << "\t" << std::endl;
+                }
+                played.close();
             }
-            played.close();
         }
     }
     catch (const std::exception& e)
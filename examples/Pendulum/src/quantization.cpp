@@ -0,0 +1,157 @@
+#include "torchrl/algorithms/ppo/PPOArgs.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/rl/Policy.hpp"
+#include "torchrl/rl/QuantizedMLP.hpp"
+#include "torchrl/utils/SIMD.hpp"
+
+#include "Pendulum/PendulumEnv.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+/// @brief Create an env in play mode with the normalizers saved after training
+std::unique_ptr<VectorizedEnv> CreateEnv(const PPOArgs& args, const int64_t N, const unsigned int seed)
+{
+    std::unique_ptr<VectorizedEnv> env = std::make_unique<VectorizedEnv>(args.normalize_env_obs, args.normalize_env_reward);
+    env->CreateEnvs<PendulumEnv>(N, seed);
+    env->Load(args.exp_path);
+    env->SetTraining(false);
+    return env;
+}
+
+/// @brief Record the (normalized) obs seen by the fp32 policy playing in the env
+/// @return A {num_steps * N, obs_dim} tensor
+torch::Tensor RecordObservations(VectorizedEnv& env, Policy& policy, const int num_steps)
+{
+    std::vector<torch::Tensor> recorded;
+    torch::Tensor obs = env.Reset();
+    for (int s = 0; s < num_steps; ++s)
+    {
+        recorded.push_back(obs);
+        auto [action, value, log_prob] = policy(obs, true);
+        const VectorizedStepResult& step_result = env.Step(action);
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+    }
+    return torch::cat(recorded, 0);
+}
+
+/// @brief Play num_episodes deterministic episodes with act choosing the actions
+/// @return The mean episode reward
+float PlayEpisodes(VectorizedEnv& env, const int num_episodes, const std::function<torch::Tensor(const torch::Tensor&)>& act)
+{
+    float total_reward = 0.0f;
+    int episodes = 0;
+    torch::Tensor obs = env.Reset();
+    while (episodes < num_episodes)
+    {
+        const VectorizedStepResult& step_result = env.Step(act(obs));
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+        // Several envs can end on the same step, only the first num_episodes are counted
+        for (const int64_t i : step_result.terminated_envs)
+        {
+            if (episodes == num_episodes)
+            {
+                break;
+            }
+            total_reward += step_result.episodes_tot_reward[i];
+            episodes += 1;
+        }
+    }
+    return total_reward / episodes;
+}
+
+/// @brief Get the mean latency of f in microseconds
+double Latency(const int num_calls, const std::function<void()>& f)
+{
+    // Warmup
+    f();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_calls; ++i)
+    {
+        f();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / num_calls;
+}
+
+int main(char argc, char* argv[])
+{
+    try
+    {
+        PPOArgs args;
+        args.seed = 12345;
+        args.ParseArgs(argc, argv);
+
+        torch::manual_seed(args.seed);
+        // Single threaded, as on the small cores the controllers run on
+        torch::set_num_threads(1);
+
+        const std::filesystem::path exp_path = args.exp_path;
+        if (!std::filesystem::exists(exp_path / "policy.pt"))
+        {
+            std::cerr << "Error, can't find trained files in " << exp_path << ", train a policy with Pendulum first" << std::endl;
+            return 1;
+        }
+
+        torch::NoGradGuard no_grad;
+
+        std::unique_ptr<VectorizedEnv> env = CreateEnv(args, args.n_envs, args.seed);
+        Policy policy(env->GetObservationSize(), env->GetActionSize());
+        torch::load(policy, (exp_path / "policy.pt").string());
+        policy->train(false);
+        MLP actor = policy->GetActorNet();
+
+        // Calibrate the quantization on obs visited by the trained policy
+        const torch::Tensor calibration_obs = RecordObservations(*env, policy, 1000);
+        QuantizedMLP quantized(actor, calibration_obs);
+
+        const torch::Tensor fp32_actions = actor->forward(calibration_obs);
+        const torch::Tensor int8_actions = quantized.Forward(calibration_obs);
+        std::cout << "SIMD instruction set: " << simd::GetInstructionSet() << std::endl;
+        std::cout << "Max action diff on " << calibration_obs.size(0) << " calibration obs: "
+            << (fp32_actions - int8_actions).abs().max().item<float>() << std::endl;
+
+        //########################################################
+        //###################### ACCURACY ########################
+        //########################################################
+        // Same seed for both, so episodes start from the same states
+        const int num_episodes = 100;
+        std::unique_ptr<VectorizedEnv> fp32_env = CreateEnv(args, args.n_envs, args.seed + 42);
+        const float fp32_reward = PlayEpisodes(*fp32_env, num_episodes,
+            [&](const torch::Tensor& obs) { return std::get<0>(policy(obs, true)); });
+        std::unique_ptr<VectorizedEnv> int8_env = CreateEnv(args, args.n_envs, args.seed + 42);
+        const float int8_reward = PlayEpisodes(*int8_env, num_episodes,
+            [&](const torch::Tensor& obs) { return quantized.Forward(obs); });
+
+        // Allow 5% of the fp32 reward, episodes can diverge after a small action difference
+        const bool ok = std::abs(int8_reward - fp32_reward) <= 0.05f * std::abs(fp32_reward);
+        std::cout << "Mean episode reward on " << num_episodes << " episodes: fp32 " << fp32_reward
+            << ", int8 " << int8_reward << (ok ? " [OK]" : " [FAILED]") << std::endl;
+
+        //########################################################
+        //###################### LATENCY #########################
+        //########################################################
+        for (const int64_t batch_size : { 1, 8, 64 })
+        {
+            const torch::Tensor obs = calibration_obs.narrow(0, 0, batch_size).contiguous();
+            const double fp32_latency = Latency(10000, [&]() { actor->forward(obs); });
+            const double int8_latency = Latency(10000, [&]() { quantized.Forward(obs); });
+            std::cout << "Batch size " << std::setw(3) << batch_size << ": "
+                << std::fixed << std::setprecision(2)
+                << "fp32 " << std::setw(8) << fp32_latency << " us, "
+                << "int8 " << std::setw(8) << int8_latency << " us, "
+                << "speedup x" << fp32_latency / int8_latency << std::endl;
+        }
+
+        return ok ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,303 @@
+#include "torchrl/envs/ExperienceRecorder.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/rl/ExperienceReader.hpp"
+#include "torchrl/rl/Policy.hpp"
+#include "torchrl/rl/ReplayBuffer.hpp"
+#include "torchrl/rl/RolloutBuffer.hpp"
+
+#include "Pendulum/PendulumEnv.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+
+/// @brief Transitions stepped while recording, to compare them with the recorded file
+struct Transitions
+{
+    std::vector<torch::Tensor> obs;
+    std::vector<torch::Tensor> action;
+    std::vector<torch::Tensor> reward;
+    std::vector<torch::Tensor> next_obs;
+    std::vector<torch::Tensor> env_id;
+    std::vector<torch::Tensor> terminal_state;
+
+    /// @param obs_ Observations the actions were chosen on, one row per env of result
+    /// @param action_ Actions of the envs of result
+    void Add(const torch::Tensor& obs_, const torch::Tensor& action_, const VectorizedStepResult& result)
+    {
+        const int64_t N = result.rewards.size(0);
+        obs.push_back(obs_.clone());
+        action.push_back(action_.clone());
+        reward.push_back(result.rewards.clone());
+        next_obs.push_back(result.obs.clone());
+        if (result.env_ids.empty())
+        {
+            env_id.push_back(torch::arange(N, torch::kLong));
+        }
+        else
+        {
+            env_id.push_back(torch::tensor(result.env_ids, torch::kLong));
+        }
+        torch::Tensor states = torch::empty({ N }, torch::kUInt8);
+        for (int64_t k = 0; k < N; ++k)
+        {
+            states.data_ptr<uint8_t>()[k] = static_cast<uint8_t>(result.terminal_states[k]);
+        }
+        terminal_state.push_back(states);
+    }
+};
+
+/// @brief Step num_envs Pendulum envs with random actions, recording them if recorder is not nullptr.
+/// Nothing else is done in the loop, so the difference with and without recorder is its overhead
+/// @return The env steps per second
+double TimeEnvs(const int num_envs, const int num_steps, ExperienceRecorder* recorder)
+{
+    torch::manual_seed(42);
+    VectorizedEnv env(false, false);
+    env.CreateEnvs<PendulumEnv>(num_envs, 42);
+    env.Reset();
+    env.SetRecorder(recorder);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < num_steps; ++s)
+    {
+        env.Step(torch::rand({ num_envs, 1 }) * 4.0f - 2.0f);
+    }
+    if (recorder != nullptr)
+    {
+        recorder->Flush();
+    }
+    return num_envs * num_steps / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief Step num_envs Pendulum envs with random actions and Step, recording them
+/// @param expected Output, the transitions the file must contain
+void RecordEnvs(const int num_envs, const int num_steps, ExperienceRecorder& recorder, Transitions& expected)
+{
+    torch::manual_seed(42);
+    VectorizedEnv env(false, false);
+    env.CreateEnvs<PendulumEnv>(num_envs, 42);
+    torch::Tensor obs = env.Reset();
+    env.SetRecorder(&recorder);
+
+    for (int s = 0; s < num_steps; ++s)
+    {
+        const torch::Tensor action = torch::rand({ num_envs, 1 }) * 4.0f - 2.0f;
+        const VectorizedStepResult& step_result = env.Step(action);
+        expected.Add(obs, action, step_result);
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+    }
+    env.SetRecorder(nullptr);
+}
+
+/// @brief Collect n_steps steps for each env of env with StepAsync and Recv, filling
+/// buffer the same way PPO does with --async_batch_size 4
+/// @param expected Output, the transitions recorded by the recorder of env (if any)
+/// @return The values to compute the returns of buffer with
+torch::Tensor CollectRolloutAsync(VectorizedEnv& env, Policy& policy, const int64_t n_steps, const float gamma,
+    RolloutBuffer& buffer, Transitions& expected)
+{
+    torch::NoGradGuard no_grad;
+
+    const int64_t num_envs = env.GetNumEnvs();
+    std::vector<int64_t> env_steps(num_envs, 0);
+    torch::Tensor last_ended = torch::zeros({ num_envs }, torch::kBool);
+
+    torch::Tensor obs = env.GetObs();
+    torch::Tensor actions = torch::zeros({ num_envs, env.GetActionSize() });
+    torch::Tensor values = torch::zeros({ num_envs, 1 });
+    torch::Tensor log_probs = torch::zeros({ num_envs, 1 });
+
+    auto send = [&](const std::vector<int64_t>& env_ids)
+    {
+        const torch::Tensor ids = torch::tensor(env_ids, torch::kLong);
+        auto [action, value, log_prob] = policy(obs.index_select(0, ids));
+        actions.index_copy_(0, ids, action);
+        values.index_copy_(0, ids, value);
+        log_probs.index_copy_(0, ids, log_prob);
+        env.StepAsync(action, env_ids);
+    };
+
+    std::vector<int64_t> all_envs(num_envs);
+    std::iota(all_envs.begin(), all_envs.end(), 0);
+    send(all_envs);
+
+    while (env.GetNumStepping() > 0)
+    {
+        const VectorizedStepResult step_result = env.Recv(std::min<int64_t>(4, env.GetNumStepping()));
+        const torch::Tensor ids = torch::tensor(step_result.env_ids, torch::kLong);
+        expected.Add(obs.index_select(0, ids), actions.index_select(0, ids), step_result);
+
+        torch::Tensor timeout_mask = torch::empty({ ids.size(0) }, torch::kBool);
+        for (size_t k = 0; k < step_result.terminal_states.size(); ++k)
+        {
+            timeout_mask.data_ptr<bool>()[k] = step_result.terminal_states[k] == TerminalState::Timeout;
+        }
+        const torch::Tensor rewards = step_result.rewards +
+            (gamma * policy->PredictValues(step_result.obs).view({ -1 })).masked_fill_(timeout_mask.logical_not(), 0.0f);
+        buffer.Add(step_result.env_ids, obs.index_select(0, ids), actions.index_select(0, ids),
+            values.index_select(0, ids), log_probs.index_select(0, ids), rewards, step_result.terminal_states);
+
+        obs.index_copy_(0, ids, torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs));
+        last_ended.index_copy_(0, ids, step_result.terminal_mask);
+
+        std::vector<int64_t> next_env_ids;
+        for (const int64_t i : step_result.env_ids)
+        {
+            env_steps[i] += 1;
+            if (env_steps[i] < n_steps)
+            {
+                next_env_ids.push_back(i);
+            }
+        }
+        if (!next_env_ids.empty())
+        {
+            send(next_env_ids);
+        }
+    }
+
+    return policy->PredictValues(obs).masked_fill_(last_ended.unsqueeze(1), 0.0f);
+}
+
+/// @brief Check that all the columns of an experience file are exactly the expected transitions
+bool CheckRecording(const std::string& path, const Transitions& expected)
+{
+    ExperienceReader reader(path);
+    Transitions read;
+    ExperienceBatch batch;
+    while (reader.Next(1000, batch))
+    {
+        read.obs.push_back(batch.obs.clone());
+        read.action.push_back(batch.action.clone());
+        read.reward.push_back(batch.reward.clone());
+        read.next_obs.push_back(batch.next_obs.clone());
+        read.env_id.push_back(batch.env_id.clone());
+        read.terminal_state.push_back(batch.terminal_state.clone());
+    }
+    if (read.obs.empty())
+    {
+        return false;
+    }
+
+    const std::pair<const std::vector<torch::Tensor>*, const std::vector<torch::Tensor>*> columns[] = {
+        { &read.obs, &expected.obs },
+        { &read.action, &expected.action },
+        { &read.reward, &expected.reward },
+        { &read.next_obs, &expected.next_obs },
+        { &read.env_id, &expected.env_id },
+        { &read.terminal_state, &expected.terminal_state }
+    };
+    for (const auto& [read_column, expected_column] : columns)
+    {
+        if (!torch::equal(torch::cat(*read_column, 0), torch::cat(*expected_column, 0)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const int num_envs = 16;
+        const int num_steps = 10000;
+        const std::string path = (std::filesystem::temp_directory_path() / "pendulum_experience.bin").string();
+        std::filesystem::remove(path);
+
+        torch::NoGradGuard no_grad;
+
+        //########################################################
+        //####################### OVERHEAD #######################
+        //########################################################
+        const double base_steps_per_s = TimeEnvs(num_envs, num_steps, nullptr);
+        double recorded_steps_per_s = 0.0;
+        {
+            ExperienceRecorder recorder(path, 3, 1, 4096);
+            recorded_steps_per_s = TimeEnvs(num_envs, num_steps, &recorder);
+        }
+        std::filesystem::remove(path);
+        std::cout << "Env steps/s: " << static_cast<int64_t>(base_steps_per_s) << " without recording, "
+            << static_cast<int64_t>(recorded_steps_per_s) << " with recording" << std::endl;
+
+        //########################################################
+        //######################## REPLAY ########################
+        //########################################################
+        // Replayed transitions must be exactly the stepped ones
+        Transitions expected;
+        {
+            ExperienceRecorder recorder(path, 3, 1, 4096);
+            RecordEnvs(num_envs, num_steps, recorder, expected);
+        }
+        const bool sync_ok = CheckRecording(path, expected);
+        ExperienceReader reader(path);
+        std::cout << "Step: " << reader.GetNumTransitions() << " transitions in " << reader.GetNumChunks() << " chunks ("
+            << std::filesystem::file_size(path) / (1024 * 1024) << " MB)" << (sync_ok ? " [OK]" : " [FAILED]") << std::endl;
+
+        // Offline replay buffer, filled without any env step
+        ReplayBuffer replay_buffer(num_envs * num_steps, 3, 1);
+        const auto start = std::chrono::steady_clock::now();
+        const int64_t added = reader.Fill(replay_buffer);
+        std::cout << "Filled a replay buffer with " << added << " transitions in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        std::filesystem::remove(path);
+
+        //########################################################
+        //###################### PPO REPLAY ######################
+        //########################################################
+        // A rollout collected with StepAsync/Recv is recorded in chunks that don't match
+        // the Recv batches, then read back in a second rollout buffer, which must get
+        // the same steps, returns and advantages
+        const int64_t n_steps = 256;
+        const float gamma = 0.9f;
+        torch::manual_seed(42);
+        Policy policy(3, 1);
+        policy->train(false);
+        VectorizedEnv env(false, false);
+        env.CreateEnvs<PendulumEnv>(num_envs, 42);
+        env.SetNumThreads(4);
+        env.Reset();
+
+        RolloutBuffer collected(num_envs, n_steps, 3, 1);
+        Transitions expected_async;
+        torch::Tensor collected_values;
+        {
+            ExperienceRecorder recorder(path, 3, 1, 1000);
+            env.SetRecorder(&recorder);
+            collected_values = CollectRolloutAsync(env, policy, n_steps, gamma, collected, expected_async);
+            env.SetRecorder(nullptr);
+        }
+        const bool async_ok = CheckRecording(path, expected_async);
+        std::cout << "StepAsync/Recv: " << num_envs * n_steps << " transitions" << (async_ok ? " [OK]" : " [FAILED]") << std::endl;
+
+        ExperienceReader rollout_reader(path);
+        RolloutBuffer replayed(num_envs, n_steps, 3, 1);
+        torch::Tensor replayed_values;
+        const int64_t replayed_steps = rollout_reader.Fill(replayed, policy, gamma, replayed_values);
+        bool ppo_ok = replayed_steps == num_envs * n_steps;
+        if (ppo_ok)
+        {
+            collected.ComputeReturnsAndAdvantage(collected_values, gamma, 0.95f);
+            replayed.ComputeReturnsAndAdvantage(replayed_values, gamma, 0.95f);
+            const torch::Tensor all_steps = torch::arange(num_envs * n_steps, torch::kLong);
+            const RolloutSample a = collected.GetBatch(all_steps);
+            const RolloutSample b = replayed.GetBatch(all_steps);
+            // Values are evaluated on other batches than during the collection, so they can differ by rounding
+            ppo_ok = torch::equal(a.observation, b.observation) && torch::equal(a.action, b.action) &&
+                torch::allclose(a.value, b.value, 1e-4, 1e-5) && torch::allclose(a.log_prob, b.log_prob, 1e-4, 1e-5) &&
+                torch::allclose(a.returns, b.returns, 1e-4, 1e-5) && torch::allclose(a.advantage, b.advantage, 1e-4, 1e-5);
+        }
+        std::cout << "PPO rollout replayed in a RolloutBuffer: " << replayed_steps << " steps" << (ppo_ok ? " [OK]" : " [FAILED]") << std::endl;
+        std::filesystem::remove(path);
+
+        return sync_ok && async_ok && ppo_ok ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return 1;
+}
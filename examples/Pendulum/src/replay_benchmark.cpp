@@ -0,0 +1,148 @@
+#include "torchrl/rl/PrioritizedReplayBuffer.hpp"
+#include "torchrl/utils/SumTree.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+/// @brief Measure the stratified sampling and batched update throughput of a SumTree
+/// filled with random priorities
+void BenchmarkSumTree(const int64_t capacity, const int64_t batch_size, const int num_batches)
+{
+    SumTree tree(capacity);
+    std::mt19937 random_engine(capacity);
+    std::uniform_real_distribution<float> distribution(0.01f, 10.0f);
+
+    // Fill by chunks, as transitions are added by the envs
+    const int64_t chunk = 65536;
+    std::vector<int64_t> indices(chunk);
+    std::vector<float> priorities(chunk);
+    for (int64_t start = 0; start < capacity; start += chunk)
+    {
+        const int64_t n = std::min(chunk, capacity - start);
+        for (int64_t i = 0; i < n; ++i)
+        {
+            indices[i] = start + i;
+            priorities[i] = distribution(random_engine);
+        }
+        tree.Update(indices.data(), priorities.data(), n);
+    }
+
+    indices.resize(batch_size);
+    priorities.resize(batch_size);
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < num_batches; ++b)
+    {
+        tree.Sample(batch_size, random_engine, indices.data());
+    }
+    const double sample_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Update the sampled leaves, as the learner does with the new TD errors
+    start = std::chrono::steady_clock::now();
+    for (int b = 0; b < num_batches; ++b)
+    {
+        for (int64_t i = 0; i < batch_size; ++i)
+        {
+            indices[i] = random_engine() % capacity;
+            priorities[i] = distribution(random_engine);
+        }
+        tree.Update(indices.data(), priorities.data(), batch_size);
+    }
+    const double update_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "SumTree capacity " << std::setw(9) << capacity << ", batch " << batch_size << ": "
+        << std::setw(12) << static_cast<int64_t>(num_batches * batch_size / sample_s) << " samples/s, "
+        << std::setw(12) << static_cast<int64_t>(num_batches * batch_size / update_s) << " updates/s" << std::endl;
+}
+
+/// @brief Measure the full PrioritizedReplayBuffer sampling (tree + gather of Pendulum
+/// sized transitions + priority update), alone and while another thread adds transitions
+void BenchmarkBuffer(const int64_t capacity, const int64_t batch_size, const int num_batches)
+{
+    torch::NoGradGuard no_grad;
+
+    const int64_t num_envs = 64;
+    PrioritizedReplayBuffer buffer(capacity, 3, 1, 0.6f, 42);
+    const torch::Tensor obs = torch::randn({ num_envs, 3 });
+    const torch::Tensor action = torch::randn({ num_envs, 1 });
+    const torch::Tensor reward = torch::randn({ num_envs });
+    const std::vector<TerminalState> terminal_states(num_envs, TerminalState::NotTerminal);
+    for (int64_t i = 0; i < capacity; i += num_envs)
+    {
+        buffer.Add(obs, action, reward, obs, terminal_states);
+    }
+
+    ReplaySample batch;
+    for (const bool concurrent_inserts : { false, true })
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<int64_t> num_added(0);
+        std::thread actor;
+        if (concurrent_inserts)
+        {
+            actor = std::thread([&]() {
+                while (!stop)
+                {
+                    buffer.Add(obs, action, reward, obs, terminal_states);
+                    num_added += num_envs;
+                }
+            });
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < num_batches; ++b)
+        {
+            buffer.Sample(batch_size, batch);
+            buffer.UpdatePriorities(batch.indices, torch::rand({ batch_size }));
+        }
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        stop = true;
+        if (actor.joinable())
+        {
+            actor.join();
+        }
+
+        std::cout << "PrioritizedReplayBuffer capacity " << std::setw(9) << capacity << ", batch " << batch_size
+            << (concurrent_inserts ? " (with inserts): " : ":                ")
+            << std::setw(12) << static_cast<int64_t>(num_batches * batch_size / elapsed_s) << " samples/s";
+        if (concurrent_inserts)
+        {
+            std::cout << ", " << static_cast<int64_t>(num_added / elapsed_s) << " inserts/s";
+        }
+        std::cout << std::endl;
+    }
+}
+
+/// @brief Usage: PendulumReplayBenchmark [batch_size] [num_batches]
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const int64_t batch_size = argc > 1 ? std::stoll(argv[1]) : 256;
+        const int num_batches = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+        torch::manual_seed(42);
+        torch::set_num_threads(1);
+
+        for (const int64_t capacity : { 1000000, 10000000 })
+        {
+            BenchmarkSumTree(capacity, batch_size, num_batches);
+        }
+        for (const int64_t capacity : { 1000000, 10000000 })
+        {
+            BenchmarkBuffer(capacity, batch_size, num_batches);
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,54 @@
+#include "torchrl/algorithms/sac/SAC.hpp"
+#include "torchrl/algorithms/sac/SACArgs.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+
+#include "Pendulum/PendulumEnv.hpp"
+
+int main(char argc, char* argv[])
+{
+    try
+    {
+        SACArgs args;
+
+        // Manually set args for this example
+        args.seed = 12345;
+        // Pendulum torque is in [-2, 2]
+        args.action_scale = 2.0f;
+
+        // Parse user specified ones
+        args.ParseArgs(argc, argv);
+
+        torch::manual_seed(args.seed);
+
+        //########################################################
+        //######################### TRAIN ########################
+        //########################################################
+        VectorizedEnv env(args.normalize_env_obs, args.normalize_env_reward);
+        env.CreateEnvs<PendulumEnv>(args.n_envs, args.seed);
+        env.SetNumThreads(args.n_env_threads);
+
+        SAC sac(env, args);
+
+        auto start = std::chrono::steady_clock::now();
+        sac.Learn(20000);
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "Training done in: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / 1000.0 << "s" << std::endl;
+
+        //#######################################################
+        //######################### PLAY ########################
+        //#######################################################
+
+        // We recreate everything so we're sure data will be loaded from the files
+        VectorizedEnv env_play(args.normalize_env_obs, args.normalize_env_reward);
+        env_play.CreateEnvs<PendulumEnv>(1, args.seed + 42);
+        SAC sac_play(env_play, args);
+
+        sac_play.Play();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return 0;
+}
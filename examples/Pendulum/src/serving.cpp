@@ -0,0 +1,108 @@
+#include "torchrl/rl/Policy.hpp"
+#include "torchrl/serving/InferenceClient.hpp"
+#include "torchrl/serving/InferenceServer.hpp"
+
+#include "Pendulum/PendulumEnv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+/// @brief Usage: PendulumServing [num_clients] [requests_per_client] [max_batch_size] [max_wait_us]
+/// Serve the policy trained in exp/ (or an untrained one if there is none) and
+/// send requests from num_clients loopback clients, each in its own thread
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const int num_clients = argc > 1 ? std::stoi(argv[1]) : 32;
+        const int requests_per_client = argc > 2 ? std::stoi(argv[2]) : 2000;
+        const int64_t max_batch_size = argc > 3 ? std::stoll(argv[3]) : 32;
+        const int64_t max_wait_us = argc > 4 ? std::stoll(argv[4]) : 200;
+
+        torch::manual_seed(12345);
+        // The server runs the batches, clients only wait on their socket
+        torch::set_num_threads(1);
+
+        PendulumEnv env(12345);
+        Policy policy(env.GetObservationSize(), env.GetActionSize());
+        const std::filesystem::path policy_path = std::filesystem::path("exp") / "policy.pt";
+        if (std::filesystem::exists(policy_path))
+        {
+            torch::load(policy, policy_path.string());
+        }
+        else
+        {
+            std::cout << "Can't find " << policy_path << ", serving an untrained policy" << std::endl;
+        }
+
+        const std::string socket_path = (std::filesystem::temp_directory_path() / "torchrl_serving.sock").string();
+        InferenceServer server(policy, socket_path, max_batch_size, max_wait_us);
+        server.Start();
+
+        // Each client has its own thread, as an env controller in another process would
+        std::vector<std::vector<float>> client_latencies_us(num_clients);
+        std::vector<std::thread> threads;
+        const auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < num_clients; ++c)
+        {
+            threads.emplace_back([&, c]() {
+                InferenceClient client(socket_path);
+                std::mt19937 random_engine(c);
+                std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+                std::vector<float> obs(client.GetObservationSize());
+                std::vector<float> action(client.GetActionSize());
+                client_latencies_us[c].reserve(requests_per_client);
+                for (int i = 0; i < requests_per_client; ++i)
+                {
+                    std::generate(obs.begin(), obs.end(), [&]() { return distribution(random_engine); });
+                    const auto request_start = std::chrono::steady_clock::now();
+                    client.Act(obs.data(), action.data());
+                    client_latencies_us[c].push_back(std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - request_start).count());
+                }
+            });
+        }
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const InferenceServerStats stats = server.GetStats();
+        server.Stop();
+
+        std::vector<float> latencies;
+        for (const std::vector<float>& l : client_latencies_us)
+        {
+            latencies.insert(latencies.end(), l.begin(), l.end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << num_clients << " clients, max batch size " << max_batch_size << ", max wait " << max_wait_us << " us" << std::endl;
+        std::cout << "Throughput: " << latencies.size() / elapsed_s << " requests/s" << std::endl;
+        std::cout << "Client latency: p50 " << latencies[(latencies.size() - 1) * 50 / 100]
+            << " us, p99 " << latencies[(latencies.size() - 1) * 99 / 100] << " us" << std::endl;
+        std::cout << "Server latency: p50 " << stats.latency_p50_us << " us, p99 " << stats.latency_p99_us << " us" << std::endl;
+        std::cout << "Mean batch size: " << static_cast<double>(stats.num_requests) / stats.num_batches << std::endl;
+        std::cout << "Batch size histogram:" << std::endl;
+        for (size_t i = 1; i < stats.batch_size_histogram.size(); ++i)
+        {
+            if (stats.batch_size_histogram[i] > 0)
+            {
+                std::cout << std::setw(5) << i << ": " << stats.batch_size_histogram[i] << std::endl;
+            }
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "torchrl/envs/RunningMeanStd.hpp"
+#include "torchrl/rl/Policy.hpp"
+#include "torchrl/utils/LockFreeQueue.hpp"
+
+struct IMPALAArgs;
+class VectorizedEnv;
+
+/// @brief Steps collected by one actor with its own copy of the policy
+struct TrajectorySegment
+{
+    /// @brief {T + 1, N, o}, the last row is the obs after the last step
+    torch::Tensor observations;
+    /// @brief {T, N, a}
+    torch::Tensor actions;
+    /// @brief Log prob of the actions under the actor policy, {T, N}
+    torch::Tensor behaviour_log_probs;
+    /// @brief {T, N}
+    torch::Tensor rewards;
+    /// @brief gamma for each step, 0 if the episode ended, {T, N}
+    torch::Tensor discounts;
+
+    /// @brief Sum of the rewards of the episodes that ended during this segment
+    float total_reward = 0.0f;
+    /// @brief Sum of the lengths of the episodes that ended during this segment
+    uint64_t total_steps = 0;
+    /// @brief Number of episodes that ended during this segment
+    uint64_t total_episodes = 0;
+};
+
+/// @brief Decoupled actor-learner training (IMPALA). Each actor thread steps
+/// its own VectorizedEnv with a local copy of the policy and pushes trajectory
+/// segments in a bounded queue. The learner trains on batches of segments
+/// and corrects the lag between the actors and learner policies with V-trace
+class IMPALA
+{
+public:
+    /// @param envs_ One vectorized env per actor, all with the same number of envs and
+    /// dimensions. Each env is only stepped by its actor thread. Obs and reward
+    /// normalizers (if any) are updated by each env and merged in common statistics,
+    /// synchronized back to all the envs when the actors pull new weights
+    /// @param args IMPALA parameters
+    IMPALA(const std::vector<VectorizedEnv*>& envs_, const IMPALAArgs& args);
+    ~IMPALA();
+
+    /// @brief Start an IMPALA training
+    /// @param total_timesteps Number of timesteps to play (summed over all the actors)
+    /// @param log_console If true will log training data to console
+    /// @param draw_curves If true, will draw training curves (assuming WITH_IMPLOT, otherwise does nothing)
+    void Learn(const uint64_t total_timesteps, const bool log_console = true, const bool draw_curves = true);
+
+    /// @brief Play for num_episode in the first env and render it
+    /// @param num_episode The number of episode to play
+    /// @param render If true, render the env between each decision and print the episode results to console
+    /// @return A vector of num_episode pairs <episode length, episode reward>
+    std::vector<std::pair<uint64_t, float> > Play(const uint64_t num_episode, const bool render = true);
+
+private:
+    /// @brief Main loop of actor i, until stop is set
+    void ActorLoop(const int64_t i);
+
+    /// @brief Copy the learner weights to the snapshot read by the actors
+    void PublishWeights();
+
+    /// @brief Copy the last published weights in an actor policy if they are newer than its own
+    /// @param actor_policy Policy to update
+    /// @param version Version of the actor weights, updated
+    void PullWeights(Policy& actor_policy, uint64_t& version);
+
+    /// @brief Merge the normalizers updates of env i in the shared statistics, then set them in env i.
+    /// Must be called from the thread stepping env i
+    void SyncNormalizers(const int64_t i);
+
+    /// @brief Set stop and wake up the threads waiting on the queue
+    void Stop();
+
+private:
+    std::vector<VectorizedEnv*> envs;
+    const IMPALAArgs& args;
+
+    /// @brief Learner policy
+    Policy policy{ nullptr };
+
+    LockFreeQueue<std::unique_ptr<TrajectorySegment>> queue;
+    /// @brief Notified after each push or pop in the queue, so the learner
+    /// and the actors can sleep while it's empty or full
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+
+    /// @brief Learner weights as of the last update, copied by the actors
+    std::vector<torch::Tensor> published_weights;
+    std::atomic<uint64_t> published_version;
+    std::mutex published_mutex;
+
+    /// @brief Normalizers statistics of all the actors envs
+    RunningMeanStd shared_obs_rms;
+    RunningMeanStd shared_ret_rms;
+    /// @brief State of each env normalizers at its last synchronization
+    std::vector<torch::Tensor> synced_obs_states;
+    std::vector<torch::Tensor> synced_ret_states;
+    std::mutex normalizers_mutex;
+
+    std::atomic<bool> stop;
+    std::exception_ptr actor_exception;
+    std::mutex actor_exception_mutex;
+};
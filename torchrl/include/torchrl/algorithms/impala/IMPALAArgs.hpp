@@ -0,0 +1,264 @@
+#pragma once
+
+#include "torchrl/utils/Args.hpp"
+
+struct IMPALAArgs : public Args
+{
+    // Training parameters
+
+    /// @brief Number of actor threads, each stepping its own vectorized env
+    uint64_t n_actors = 2;
+    /// @brief Number of steps of each trajectory segment sent by the actors
+    uint64_t unroll_length = 32;
+    /// @brief Number of trajectory segments in one learner batch
+    uint64_t batch_size = 4;
+    /// @brief Max number of trajectory segments waiting for the learner, actors wait when it's full
+    uint64_t queue_capacity = 16;
+    /// @brief Number of timesteps between two log lines
+    uint64_t log_interval = 2048;
+
+    /// @brief Value loss weight
+    float val_loss_weight = 0.5f;
+    /// @brief Entropy loss weight
+    float entropy_loss_weight = 0.0f;
+    /// @brief Max norm of the grad (disabled if 0)
+    float max_grad_norm = 0.5f;
+    /// @brief Initial log value for the gaussian distribution std
+    float init_sampling_log_std = 0.0f;
+    /// @brief Whether to use or not orthogonal initialization
+    bool ortho_init = true;
+    /// @brief If true, rollouts are collected running the actor and critic networks as a single packed one
+    bool fused_policy = false;
+    /// @brief Gamma value
+    float gamma = 0.9f;
+    /// @brief V-trace clipping threshold of the importance weights
+    float rho_bar = 1.0f;
+    /// @brief V-trace clipping threshold of the traces
+    float c_bar = 1.0f;
+
+    /// @brief Learning rate
+    float lr = 0.001f;
+
+    std::string GenerateHelp(const char* argv0, const bool include_parent_help = true)
+    {
+        std::stringstream s;
+        if (include_parent_help)
+        {
+            s << Args::GenerateHelp(argv0);
+        }
+        s
+            << "\t--n_actors\tNumber of actor threads, each stepping its own vectorized env of n_envs envs, default: 2\n"
+            << "\t--unroll_length\tNumber of steps of each trajectory segment sent by the actors, default: 32\n"
+            << "\t--batch_size\tNumber of trajectory segments in one learner batch, default: 4\n"
+            << "\t--queue_capacity\tMax number of trajectory segments waiting for the learner, default: 16\n"
+            << "\t--log_interval\tNumber of timesteps between two log lines, default: 2048\n"
+            << "\t--val_loss_weight\tValue loss weight, default: 0.5\n"
+            << "\t--entropy_loss_weight\tEntropy loss weight, default: 0.0\n"
+            << "\t--max_grad_norm\tMax norm of the grad (disabled if 0), default: 0.5\n"
+            << "\t--init_sampling_log_std\tInitial log value for the gaussian distribution std, default: 0.0\n"
+            << "\t--ortho_init\tWhether to use or not orthogonal initialization, default: true\n"
+            << "\t--fused_policy\tIf true, rollouts are collected running the actor and critic networks as a single packed one, default: false\n"
+            << "\t--gamma\tGamma value, default: 0.9\n"
+            << "\t--rho_bar\tV-trace clipping threshold of the importance weights, default: 1.0\n"
+            << "\t--c_bar\tV-trace clipping threshold of the traces, default: 1.0\n"
+            << "\t--lr\tLearning rate, default: 0.001\n";
+
+        return s.str();
+    }
+
+    void ParseArgs(char argc, char* argv[])
+    {
+        // First, parse parents args
+        Args::ParseArgs(argc, argv);
+
+        // Then parse self args
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help")
+            {
+                std::cout << GenerateHelp(argv[0], false) << std::endl;
+            }
+            else if (arg == "--n_actors")
+            {
+                if (i + 1 < argc)
+                {
+                    n_actors = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--n_actors requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--unroll_length")
+            {
+                if (i + 1 < argc)
+                {
+                    unroll_length = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--unroll_length requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--batch_size")
+            {
+                if (i + 1 < argc)
+                {
+                    batch_size = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--batch_size requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--queue_capacity")
+            {
+                if (i + 1 < argc)
+                {
+                    queue_capacity = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--queue_capacity requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--log_interval")
+            {
+                if (i + 1 < argc)
+                {
+                    log_interval = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--log_interval requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--val_loss_weight")
+            {
+                if (i + 1 < argc)
+                {
+                    val_loss_weight = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--val_loss_weight requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--entropy_loss_weight")
+            {
+                if (i + 1 < argc)
+                {
+                    entropy_loss_weight = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--entropy_loss_weight requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--max_grad_norm")
+            {
+                if (i + 1 < argc)
+                {
+                    max_grad_norm = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--max_grad_norm requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--init_sampling_log_std")
+            {
+                if (i + 1 < argc)
+                {
+                    init_sampling_log_std = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--init_sampling_log_std requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--ortho_init")
+            {
+                if (i + 1 < argc)
+                {
+                    ortho_init = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--ortho_init requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--fused_policy")
+            {
+                if (i + 1 < argc)
+                {
+                    fused_policy = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--fused_policy requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--gamma")
+            {
+                if (i + 1 < argc)
+                {
+                    gamma = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--gamma requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--rho_bar")
+            {
+                if (i + 1 < argc)
+                {
+                    rho_bar = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--rho_bar requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--c_bar")
+            {
+                if (i + 1 < argc)
+                {
+                    c_bar = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--c_bar requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--lr")
+            {
+                if (i + 1 < argc)
+                {
+                    lr = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--lr requires an argument" << std::endl;
+                    return;
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "torch/torch.h"
+
+struct VTraceReturns
+{
+    /// @brief V-trace value targets, shape {T, N}
+    torch::Tensor vs;
+    /// @brief Advantages for the policy gradient, shape {T, N}
+    torch::Tensor pg_advantages;
+};
+
+/// @brief Compute V-trace targets as described in "IMPALA: Scalable Distributed
+/// Deep-RL with Importance Weighted Actor-Learner Architectures" (Espeholt et al.)
+/// No gradient flows through the results
+/// @param log_rhos log(target policy prob / behaviour policy prob) of the actions, shape {T, N}
+/// @param discounts gamma for each step, 0 if the episode ended at this step, shape {T, N}
+/// @param rewards Rewards of each step, shape {T, N}
+/// @param values Target policy values of the obs of each step, shape {T, N}
+/// @param bootstrap_value Target policy values of the obs after the last step, shape {N}
+/// @param rho_bar Clipping threshold of the importance weights for the value targets
+/// @param c_bar Clipping threshold of the traces
+/// @param pg_rho_bar Clipping threshold of the importance weights for the policy gradient
+VTraceReturns ComputeVTrace(const torch::Tensor& log_rhos, const torch::Tensor& discounts,
+    const torch::Tensor& rewards, const torch::Tensor& values, const torch::Tensor& bootstrap_value,
+    const float rho_bar = 1.0f, const float c_bar = 1.0f, const float pg_rho_bar = 1.0f);
@@ -6,13 +6,21 @@
 #include "torchrl/rl/Policy.hpp"
 
 struct PPOArgs;
+class Distributed;
+class InferenceEngine;
 class VectorizedEnv;
 class RolloutBuffer;
 
 class PPO
 {
 public:
-    PPO(VectorizedEnv& env_, const PPOArgs& args);
+    /// @param env_ Env to collect rollouts in
+    /// @param args PPO parameters
+    /// @param distributed_ If not nullptr, process group this training is part of. Each process
+    /// collects rollouts in its own env (all with the same number of envs), gradients are
+    /// averaged before each optimization step and env normalizers are synchronized after
+    /// each rollout. Only rank 0 saves the trained files
+    PPO(VectorizedEnv& env_, const PPOArgs& args, Distributed* distributed_ = nullptr);
     ~PPO();
 
     /// @brief Start a PPO training
@@ -28,14 +36,36 @@ public:
     std::vector<std::pair<uint64_t, float> > Play(const uint64_t num_episode = 0, const bool render = true);
 
 private:
-    /// @brief Use the policy to play in the env and store the data in buffer
+    /// @brief Use the actor policy to play in the env and store the data in buffer
     /// @param buffer The rollout buffer to store data in
     /// @return A tuple <reward at the end of episodes, number of steps at the end of episodes, number of end of episodes>
     std::tuple<float, uint64_t, uint64_t> CollectRollouts(RolloutBuffer& buffer);
 
+    /// @brief Same as CollectRollouts, but envs are stepped asynchronously and the
+    /// policy is run on partial batches as soon as args.async_batch_size envs are done
+    /// @param buffer The rollout buffer to store data in
+    /// @return A tuple <reward at the end of episodes, number of steps at the end of episodes, number of end of episodes>
+    std::tuple<float, uint64_t, uint64_t> CollectRolloutsAsync(RolloutBuffer& buffer);
+
+    /// @brief Copy the learner policy weights into the actor one
+    void SyncActorPolicy();
+
+    /// @brief Run the actor policy, or the inference engine if enabled
+    /// @return A tuple <actions, values, log probabilities of the actions>
+    std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> ActorForward(const torch::Tensor& observations);
+    /// @brief Get the actor policy estimated values, or the inference engine ones if enabled
+    torch::Tensor ActorPredictValues(const torch::Tensor& observations);
+
 private:
     VectorizedEnv& env;
     const PPOArgs& args;
+    Distributed* distributed;
 
+    /// @brief Policy being trained
     Policy policy{ nullptr };
+    /// @brief Policy used to collect the rollouts, a snapshot of policy
+    /// in pipelined mode, the same module as policy otherwise
+    Policy actor_policy{ nullptr };
+    /// @brief If not nullptr, used instead of the policies to collect rollouts and play
+    std::unique_ptr<InferenceEngine> inference_engine;
 };
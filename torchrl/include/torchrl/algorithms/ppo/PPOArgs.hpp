@@ -12,6 +12,18 @@ struct PPOArgs : public Args
     uint64_t n_steps = 1024;
     /// @brief Number of times each collected sample is used for training
     uint64_t n_epochs = 10;
+    /// @brief If > 0, envs are stepped asynchronously and the policy is run as soon as this number of envs are done
+    uint64_t async_batch_size = 0;
+    /// @brief If true, the next minibatch is gathered on a helper thread during the optimization step
+    bool prefetch_minibatches = false;
+    /// @brief If true, the next rollouts are collected on a helper thread with the previous policy weights during training
+    bool pipelined = false;
+    /// @brief Number of processes training together (requires TORCHRL_DISTRIBUTED if > 1)
+    int world_size = 1;
+    /// @brief Rank of this process in [0, world_size)
+    int rank = 0;
+    /// @brief File used by the processes to find each other, must not exist before the training
+    std::string dist_store = "torchrl_store";
 
     /// @brief Value loss weight
     float val_loss_weight = 0.5f;
@@ -23,6 +35,13 @@ struct PPOArgs : public Args
     float init_sampling_log_std = 0.0f;
     /// @brief Whether to use or not orthogonal initialization
     bool ortho_init = true;
+    /// @brief If true, rollouts are collected running the actor and critic networks as a single packed one
+    bool fused_policy = false;
+    /// @brief If true, rollouts are collected and episodes played with the SIMD InferenceEngine instead of libtorch
+    bool inference_engine = false;
+    /// @brief If true, rollout observations are stored as bfloat16 and episode ends as bits.
+    /// Experimental, its effect on the learning curves hasn't been validated yet
+    bool compact_rollouts = false;
     /// @brief Gamma value
     float gamma = 0.9f;
     /// @brief Lambda value
@@ -33,6 +52,11 @@ struct PPOArgs : public Args
     /// @brief Learning rate
     float lr = 0.001f;
 
+    /// @brief If true, a frozen TorchScript module of the deterministic actor (with the obs normalization) is also saved after training
+    bool export_torchscript = false;
+    /// @brief If not empty, rollouts are stored in memory-mapped files in this folder instead of RAM
+    std::string rollout_storage = "";
+
     std::string GenerateHelp(const char* argv0, const bool include_parent_help = true)
     {
         std::stringstream s;
@@ -44,15 +68,26 @@ struct PPOArgs : public Args
             << "\t--batch_size\tSize of a minibatch, default: 64\n"
             << "\t--n_steps\tNumber of steps collected by each env during one rollout, default: 1024\n"
             << "\t--n_epochs\tNumber of times each collected sample is used for training, default: 10\n"
+            << "\t--async_batch_size\tIf > 0, envs are stepped asynchronously and the policy is run as soon as this number of envs are done, default: 0\n"
+            << "\t--prefetch_minibatches\tIf true, the next minibatch is gathered on a helper thread during the optimization step, default: false\n"
+            << "\t--pipelined\tIf true, the next rollouts are collected on a helper thread with the previous policy weights during training, default: false\n"
+            << "\t--world_size\tNumber of processes training together (requires TORCHRL_DISTRIBUTED if > 1), default: 1\n"
+            << "\t--rank\tRank of this process in [0, world_size), default: 0\n"
+            << "\t--dist_store\tFile used by the processes to find each other, must not exist before the training, default: \"torchrl_store\"\n"
             << "\t--val_loss_weight\tValue loss weight, default: 0.5\n"
             << "\t--entropy_loss_weight\tEntropy loss weight, default: 0.0\n"
             << "\t--max_grad_norm\tMax norm of the grad (disabled if 0), default: 0.5\n"
             << "\t--init_sampling_log_std\tInitial log value for the gaussian distribution std, default: 0.0\n"
             << "\t--ortho_init\tWhether to use or not orthogonal initialization, default: true\n"
+            << "\t--fused_policy\tIf true, rollouts are collected running the actor and critic networks as a single packed one, default: false\n"
+            << "\t--inference_engine\tIf true, rollouts are collected and episodes played with the SIMD InferenceEngine instead of libtorch, default: false\n"
+            << "\t--compact_rollouts\tIf true, rollout observations are stored as bfloat16 and episode ends as bits (experimental), default: false\n"
             << "\t--gamma\tGamma value, default: 0.9\n"
             << "\t--lambda_gae\tLambda value for GAE, default: 0.95\n"
             << "\t--clip_value\tPPO Clip value, default: 0.2\n"
-            << "\t--lr\tLearning rate, default: 0.001\n";
+            << "\t--lr\tLearning rate, default: 0.001\n"
+            << "\t--export_torchscript\tIf true, a frozen TorchScript module of the deterministic actor (with the obs normalization) is also saved after training, default: false\n"
+            << "\t--rollout_storage\tIf not empty, rollouts are stored in memory-mapped scratch files in this folder instead of RAM, default: \"\"\n";
 
         return s.str();
     }
@@ -106,6 +141,78 @@ struct PPOArgs : public Args
                     return;
                 }
             }
+            else if (arg == "--async_batch_size")
+            {
+                if (i + 1 < argc)
+                {
+                    async_batch_size = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--async_batch_size requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--prefetch_minibatches")
+            {
+                if (i + 1 < argc)
+                {
+                    prefetch_minibatches = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--prefetch_minibatches requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--pipelined")
+            {
+                if (i + 1 < argc)
+                {
+                    pipelined = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--pipelined requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--world_size")
+            {
+                if (i + 1 < argc)
+                {
+                    world_size = std::stoi(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--world_size requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--rank")
+            {
+                if (i + 1 < argc)
+                {
+                    rank = std::stoi(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--rank requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--dist_store")
+            {
+                if (i + 1 < argc)
+                {
+                    dist_store = argv[++i];
+                }
+                else
+                {
+                    std::cerr << "--dist_store requires an argument" << std::endl;
+                    return;
+                }
+            }
             else if (arg == "--val_loss_weight")
             {
                 if (i + 1 < argc)
@@ -166,6 +273,42 @@ struct PPOArgs : public Args
                 return;
             }
             }
+            else if (arg == "--fused_policy")
+            {
+                if (i + 1 < argc)
+                {
+                    fused_policy = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--fused_policy requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--inference_engine")
+            {
+                if (i + 1 < argc)
+                {
+                    inference_engine = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--inference_engine requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--compact_rollouts")
+            {
+                if (i + 1 < argc)
+                {
+                    compact_rollouts = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--compact_rollouts requires an argument" << std::endl;
+                    return;
+                }
+            }
             else if (arg == "--gamma")
             {
                 if (i + 1 < argc)
@@ -214,6 +357,30 @@ struct PPOArgs : public Args
                     return;
                 }
             }
+            else if (arg == "--export_torchscript")
+            {
+                if (i + 1 < argc)
+                {
+                    export_torchscript = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--export_torchscript requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--rollout_storage")
+            {
+                if (i + 1 < argc)
+                {
+                    rollout_storage = argv[++i];
+                }
+                else
+                {
+                    std::cerr << "--rollout_storage requires an argument" << std::endl;
+                    return;
+                }
+            }
         }
     }
 };
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "torchrl/rl/SACPolicy.hpp"
+
+struct SACArgs;
+struct ReplaySample;
+class VectorizedEnv;
+
+/// @brief Off-policy Soft Actor-Critic. Transitions played by a squashed gaussian
+/// actor are stored in a ReplayBuffer and reused for many updates of the actor and
+/// twin Q critics, with an entropy bonus whose coefficient can be learned
+class SAC
+{
+public:
+    /// @param env_ Env to play in
+    /// @param args SAC parameters
+    SAC(VectorizedEnv& env_, const SACArgs& args);
+    ~SAC();
+
+    /// @brief Start a SAC training
+    /// @param total_timesteps Number of timesteps to play
+    /// @param log_console If true will log training data to console
+    /// @param draw_curves If true, will draw training curves (assuming WITH_IMPLOT, otherwise does nothing)
+    void Learn(const uint64_t total_timesteps, const bool log_console = true, const bool draw_curves = true);
+
+    /// @brief Play for num_episode and render the env
+    /// @param num_episode The number of episode to play, if 0 will ask user to continue
+    /// @param render If true, render the env between each decision and print the episode results to console
+    /// @return A vector of num_episode pairs <episode length, episode reward>
+    std::vector<std::pair<uint64_t, float> > Play(const uint64_t num_episode = 0, const bool render = true);
+
+private:
+    /// @brief Do one gradient step of the critics, actor and entropy coefficient on a batch,
+    /// with the critic loss weighted by batch.weight if it's defined
+    /// @return A tuple <critic loss, actor loss, entropy coefficient, {B} TD errors>
+    std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor> Train(const ReplaySample& batch,
+        torch::optim::Optimizer& actor_optimizer, torch::optim::Optimizer& critic_optimizer,
+        torch::optim::Optimizer* ent_coef_optimizer);
+
+    /// @brief Move the target critics weights towards the critics ones by tau
+    void UpdateTarget();
+
+private:
+    VectorizedEnv& env;
+    const SACArgs& args;
+
+    SquashedGaussianActor actor{ nullptr };
+    TwinQNetwork critic{ nullptr };
+    /// @brief Slowly updated copy of critic, used to compute the TD targets
+    TwinQNetwork critic_target{ nullptr };
+    torch::Tensor log_ent_coef;
+    float target_entropy;
+};
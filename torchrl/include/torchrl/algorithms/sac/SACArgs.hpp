@@ -0,0 +1,277 @@
+#pragma once
+
+#include "torchrl/utils/Args.hpp"
+
+struct SACArgs : public Args
+{
+    // Training parameters
+
+    /// @brief Number of transitions kept in the replay buffer
+    uint64_t buffer_size = 1000000;
+    /// @brief Number of transitions in a training batch
+    uint64_t batch_size = 256;
+    /// @brief Number of steps played with uniformly random actions before training starts
+    uint64_t learning_starts = 1000;
+    /// @brief Number of vectorized env steps between two training phases
+    uint64_t train_freq = 1;
+    /// @brief Number of gradient steps of each training phase
+    uint64_t gradient_steps = 1;
+    /// @brief Number of timesteps between two log lines
+    uint64_t log_interval = 1000;
+    /// @brief Gamma value
+    float gamma = 0.99f;
+    /// @brief Soft update coefficient of the target critics
+    float tau = 0.005f;
+    /// @brief Learning rate of the actor, critics and entropy coefficient
+    float lr = 0.0003f;
+    /// @brief Initial value of the entropy coefficient
+    float init_ent_coef = 1.0f;
+    /// @brief If true, the entropy coefficient is learned to reach an entropy of -action_size
+    bool auto_ent_coef = true;
+    /// @brief Actions are squashed in [-action_scale, action_scale]
+    float action_scale = 1.0f;
+    /// @brief If true, transitions are sampled proportionally to their TD error instead of uniformly
+    bool prioritized_replay = false;
+    /// @brief Prioritization exponent of the prioritized replay
+    float per_alpha = 0.6f;
+    /// @brief Initial importance sampling exponent of the prioritized replay, annealed to 1 during training
+    float per_beta = 0.4f;
+    /// @brief If not empty, the replay buffer is stored in this memory-mapped file instead of RAM, and resumed from it if it exists
+    std::string replay_storage = "";
+
+    std::string GenerateHelp(const char* argv0, const bool include_parent_help = true)
+    {
+        std::stringstream s;
+        if (include_parent_help)
+        {
+            s << Args::GenerateHelp(argv0);
+        }
+        s
+            << "\t--buffer_size\tNumber of transitions kept in the replay buffer, default: 1000000\n"
+            << "\t--batch_size\tNumber of transitions in a training batch, default: 256\n"
+            << "\t--learning_starts\tNumber of steps played with uniformly random actions before training starts, default: 1000\n"
+            << "\t--train_freq\tNumber of vectorized env steps between two training phases, default: 1\n"
+            << "\t--gradient_steps\tNumber of gradient steps of each training phase, default: 1\n"
+            << "\t--log_interval\tNumber of timesteps between two log lines, default: 1000\n"
+            << "\t--gamma\tGamma value, default: 0.99\n"
+            << "\t--tau\tSoft update coefficient of the target critics, default: 0.005\n"
+            << "\t--lr\tLearning rate of the actor, critics and entropy coefficient, default: 0.0003\n"
+            << "\t--init_ent_coef\tInitial value of the entropy coefficient, default: 1.0\n"
+            << "\t--auto_ent_coef\tIf true, the entropy coefficient is learned to reach an entropy of -action_size, default: true\n"
+            << "\t--action_scale\tActions are squashed in [-action_scale, action_scale], default: 1.0\n"
+            << "\t--prioritized_replay\tIf true, transitions are sampled proportionally to their TD error instead of uniformly, default: false\n"
+            << "\t--per_alpha\tPrioritization exponent of the prioritized replay, default: 0.6\n"
+            << "\t--per_beta\tInitial importance sampling exponent of the prioritized replay, annealed to 1 during training, default: 0.4\n"
+            << "\t--replay_storage\tIf not empty, the replay buffer is stored in this memory-mapped file instead of RAM, and resumed from it if it exists, default: \"\"\n";
+
+        return s.str();
+    }
+
+    void ParseArgs(char argc, char* argv[])
+    {
+        // First, parse parents args
+        Args::ParseArgs(argc, argv);
+
+        // Then parse self args
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help")
+            {
+                std::cout << GenerateHelp(argv[0], false) << std::endl;
+            }
+            else if (arg == "--buffer_size")
+            {
+                if (i + 1 < argc)
+                {
+                    buffer_size = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--buffer_size requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--batch_size")
+            {
+                if (i + 1 < argc)
+                {
+                    batch_size = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--batch_size requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--learning_starts")
+            {
+                if (i + 1 < argc)
+                {
+                    learning_starts = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--learning_starts requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--train_freq")
+            {
+                if (i + 1 < argc)
+                {
+                    train_freq = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--train_freq requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--gradient_steps")
+            {
+                if (i + 1 < argc)
+                {
+                    gradient_steps = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--gradient_steps requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--log_interval")
+            {
+                if (i + 1 < argc)
+                {
+                    log_interval = std::stoull(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--log_interval requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--gamma")
+            {
+                if (i + 1 < argc)
+                {
+                    gamma = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--gamma requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--tau")
+            {
+                if (i + 1 < argc)
+                {
+                    tau = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--tau requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--lr")
+            {
+                if (i + 1 < argc)
+                {
+                    lr = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--lr requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--init_ent_coef")
+            {
+                if (i + 1 < argc)
+                {
+                    init_ent_coef = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--init_ent_coef requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--auto_ent_coef")
+            {
+                if (i + 1 < argc)
+                {
+                    auto_ent_coef = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--auto_ent_coef requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--action_scale")
+            {
+                if (i + 1 < argc)
+                {
+                    action_scale = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--action_scale requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--prioritized_replay")
+            {
+                if (i + 1 < argc)
+                {
+                    prioritized_replay = std::stoi(argv[++i]) != 0;
+                }
+                else
+                {
+                    std::cerr << "--prioritized_replay requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--per_alpha")
+            {
+                if (i + 1 < argc)
+                {
+                    per_alpha = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--per_alpha requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--per_beta")
+            {
+                if (i + 1 < argc)
+                {
+                    per_beta = std::stof(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--per_beta requires an argument" << std::endl;
+                    return;
+                }
+            }
+            else if (arg == "--replay_storage")
+            {
+                if (i + 1 < argc)
+                {
+                    replay_storage = argv[++i];
+                }
+                else
+                {
+                    std::cerr << "--replay_storage requires an argument" << std::endl;
+                    return;
+                }
+            }
+        }
+    }
+};
@@ -48,10 +48,21 @@ public:
     /// @return the observation resulting from the new state
     torch::Tensor Reset();
 
+    /// @brief Reset the environment in a new state, writing the observation in place
+    /// @param obs_out GetObservationSize() array to write the observation in
+    void Reset(float* obs_out);
+
     /// @brief Perform action on the env, reset if ends up in a terminal state
     /// @param action the action to perform
     /// @return A step result object
     StepResult Step(const torch::Tensor& action);
+
+    /// @brief Perform action on the env writing the observations in place, reset if ends up in a terminal state
+    /// @param action GetActionSize() array with the action to perform
+    /// @param obs_out GetObservationSize() array to write the new observation in
+    /// @param new_episode_obs_out GetObservationSize() array to write the obs after reset in, only written if the episode ended
+    /// @return A step result object, with undefined obs and new_episode_obs tensors
+    StepResult Step(const float* action, float* obs_out, float* new_episode_obs_out);
     
     /// @brief Render the env
     /// @param wait_ms time to wait in ms after the render is complete
@@ -61,10 +72,19 @@ public:
     /// @return a tensor of size {1, GetObservationSize()}
     virtual torch::Tensor GetObs() const = 0;
 
+    /// @brief Write the current observation of the env in place. Default implementation
+    /// copies GetObs(), envs can override it to avoid allocating a tensor
+    /// @param obs_out GetObservationSize() array to write the observation in
+    virtual void WriteObs(float* obs_out) const;
+
 protected:
     virtual void ResetImpl() = 0;
     virtual void RenderImpl() = 0;
     virtual StepResult StepImpl(const torch::Tensor& action) = 0;
+    /// @brief Perform action on the env, writing the new observation in obs_out. Default
+    /// implementation wraps StepImpl, envs can override it to avoid allocating tensors
+    /// @return A step result object, obs is ignored
+    virtual StepResult StepInPlaceImpl(const float* action, float* obs_out);
 
 protected:
     std::mt19937 random_engine;
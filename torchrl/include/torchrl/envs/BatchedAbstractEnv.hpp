@@ -0,0 +1,69 @@
+#pragma once
+
+#include "torch/torch.h"
+#include <random>
+#include <vector>
+
+/// @brief Abstract base class for envs advancing N independent
+/// instances at once. Data are exchanged as contiguous row-major
+/// float arrays instead of one tensor per env, avoiding tensor
+/// allocations and dispatcher calls for small envs
+class BatchedAbstractEnv
+{
+public:
+    /// @brief Base abstract constructor for all batched envs
+    /// @param num_envs_ Number of envs in the batch
+    /// @param seed Random seed, env i is seeded with seed + i. If 0, will be randomly generated
+    BatchedAbstractEnv(const int64_t num_envs_, const unsigned int seed = 0);
+    virtual ~BatchedAbstractEnv();
+
+    /// @brief Number of envs getter
+    int64_t GetNumEnvs() const;
+    /// @brief Observation dim getter
+    /// @return the flatten obs dimension of one env
+    virtual int64_t GetObservationSize() const = 0;
+    /// @brief Action space dim getter
+    /// @return the flatten action dimension of one env
+    virtual int64_t GetActionSize() const = 0;
+
+    /// @brief Reset all the envs in a new state
+    /// @param obs_out {N, GetObservationSize()} array to write the new observations in
+    void Reset(float* obs_out);
+
+    /// @brief Perform one step for each env, reset the ones ending up in a terminal state
+    /// @param actions {N, GetActionSize()} actions to perform
+    /// @param obs_out {N, GetObservationSize()} array to write the observations after the step in
+    /// @param rewards_out {N} array to write the rewards in
+    /// @param terminal_out {N} array to write the TerminalState of each env in
+    /// @param new_episode_obs_out {N, GetObservationSize()} array, for terminal envs, the row is set to the obs after reset (other rows are untouched)
+    /// @param tot_rewards_out {N} array, total reward of the episode for terminal envs, else 0
+    /// @param tot_steps_out {N} array, total number of steps of the episode for terminal envs, else 0
+    void Step(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out,
+        float* new_episode_obs_out, float* tot_rewards_out, uint64_t* tot_steps_out);
+
+    /// @brief Render the envs
+    /// @param wait_ms time to wait in ms after the render is complete
+    void Render(const uint64_t wait_ms = 0);
+
+    /// @brief Get the current observation of the envs
+    /// @param obs_out {N, GetObservationSize()} array to write the observations in
+    virtual void GetObs(float* obs_out) const = 0;
+
+protected:
+    /// @brief Reset env index in a new state
+    virtual void ResetImpl(const int64_t index) = 0;
+    /// @brief Get the current observation of env index
+    /// @param obs_out GetObservationSize() array to write the observation in
+    virtual void GetEnvObs(const int64_t index, float* obs_out) const = 0;
+    virtual void RenderImpl() = 0;
+    /// @brief Step all envs, without resetting the terminal ones
+    virtual void StepBatch(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out) = 0;
+
+protected:
+    int64_t num_envs;
+    /// @brief One random engine per env, so results don't depend on the batch size
+    std::vector<std::mt19937> random_engines;
+
+    std::vector<uint64_t> current_episode_length;
+    std::vector<float> current_episode_reward;
+};
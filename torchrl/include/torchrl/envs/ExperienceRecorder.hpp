@@ -0,0 +1,158 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "torch/torch.h"
+
+#include "torchrl/envs/AbstractEnv.hpp"
+
+/// @brief Magic numbers at the start of experience files and of their chunks
+constexpr char experience_file_magic[8] = { 'T', 'R', 'L', 'E', 'X', 'P', '0', '1' };
+constexpr char experience_chunk_magic[8] = { 'T', 'R', 'L', 'C', 'H', 'N', 'K', '1' };
+
+/// @brief Header at the start of an experience file
+struct ExperienceFileHeader
+{
+    char magic[8];
+    int64_t obs_size;
+    int64_t act_size;
+    int64_t padding[5];
+};
+
+/// @brief Header before each chunk of an experience file
+struct ExperienceChunkHeader
+{
+    char magic[8];
+    int64_t num_rows;
+    /// @brief Number of bytes of the columns following this header
+    int64_t payload_size;
+    int64_t padding[5];
+};
+
+/// @brief Offsets in bytes of the columns of a chunk from the end of its header.
+/// Each column is padded to a multiple of 64 bytes, so they all start on a cache line
+struct ExperienceChunkLayout
+{
+    ExperienceChunkLayout(const int64_t num_rows, const int64_t obs_size, const int64_t act_size);
+
+    /// @brief {num_rows, obs_size} float
+    int64_t obs;
+    /// @brief {num_rows, act_size} float
+    int64_t action;
+    /// @brief {num_rows} float
+    int64_t reward;
+    /// @brief {num_rows, obs_size} float
+    int64_t next_obs;
+    /// @brief {num_rows} int64
+    int64_t env_id;
+    /// @brief {num_rows} uint8 TerminalState
+    int64_t terminal_state;
+    /// @brief Total size of the columns
+    int64_t payload_size;
+};
+
+/// @brief Check whether a chunk header read at offset in an experience file is the header of
+/// a complete chunk, so a chunk partially written (by a running or crashed recorder) is skipped
+/// @param file_size Size of the file in bytes
+bool IsCompleteChunk(const ExperienceChunkHeader& header, const int64_t offset, const int64_t file_size,
+    const int64_t obs_size, const int64_t act_size);
+
+/// @brief Tee the transitions of a VectorizedEnv (see VectorizedEnv::SetRecorder) into an
+/// append-only experience file, to replay them later with an ExperienceReader. Rows are
+/// buffered in columnar chunks of chunk_size transitions:
+/// [obs | action | reward | next obs | env id | terminal state]
+/// and full chunks are written by a background thread, so recording doesn't block the
+/// env loop on disk writes. Transitions of each env are in order, and its episodes
+/// end at the rows with a terminal state other than NotTerminal
+class ExperienceRecorder
+{
+public:
+    /// @param path_ File to record in. If it exists with the same layout, new chunks are appended
+    /// after its last complete one, a partially written chunk (from a crash) is discarded
+    /// @param chunk_size_ Number of transitions in each chunk
+    /// @param max_pending_chunks_ Number of full chunks waiting to be written before Record blocks
+    ExperienceRecorder(const std::string& path_, const int64_t obs_size_, const int64_t act_size_,
+        const int64_t chunk_size_ = 4096, const int64_t max_pending_chunks_ = 4);
+    ~ExperienceRecorder();
+
+    ExperienceRecorder(const ExperienceRecorder&) = delete;
+    ExperienceRecorder& operator=(const ExperienceRecorder&) = delete;
+
+    /// @brief Record one transition for each row of the tensors
+    /// @param obs {N, obs_size} observations the actions were chosen on
+    /// @param action {N, act_size} actions
+    /// @param reward {N} rewards
+    /// @param next_obs {N, obs_size} observations after the actions (before the reset if the episode ended)
+    /// @param terminal_states Terminal state of each transition
+    /// @param env_ids Env of each transition
+    void Record(const torch::Tensor& obs, const torch::Tensor& action, const torch::Tensor& reward,
+        const torch::Tensor& next_obs, const std::vector<TerminalState>& terminal_states,
+        const std::vector<int64_t>& env_ids);
+
+    /// @brief Write the buffered transitions (in a partial chunk if needed) and wait for all the chunks to be on disk
+    void Flush();
+
+    /// @brief Get the number of transitions recorded since this recorder was created
+    int64_t GetNumRecorded() const;
+    int64_t GetObservationSize() const;
+    int64_t GetActionSize() const;
+
+private:
+    struct Chunk
+    {
+        int64_t num_rows = 0;
+        std::vector<float> obs;
+        std::vector<float> action;
+        std::vector<float> reward;
+        std::vector<float> next_obs;
+        std::vector<int64_t> env_id;
+        std::vector<uint8_t> terminal_state;
+    };
+
+    /// @brief Get an empty chunk, reusing the written ones
+    std::unique_ptr<Chunk> GetFreeChunk();
+
+    /// @brief Queue the current chunk to be written, if not empty
+    void SubmitChunk();
+
+    /// @brief Write one chunk at the end of the file
+    void WriteChunk(const Chunk& chunk);
+
+    /// @brief Background thread writing the queued chunks
+    void WriterLoop();
+
+    /// @brief Rethrow the exception of the writer thread, if any
+    void CheckWriter();
+
+private:
+    std::string path;
+    int64_t obs_size;
+    int64_t act_size;
+    int64_t chunk_size;
+    int64_t max_pending_chunks;
+    int64_t num_recorded;
+
+    std::ofstream file;
+    /// @brief Chunk being filled by Record
+    std::unique_ptr<Chunk> current;
+
+    /// @brief Full chunks waiting to be written, in order
+    std::deque<std::unique_ptr<Chunk>> pending;
+    /// @brief Written chunks, reused so recording doesn't allocate in steady state
+    std::vector<std::unique_ptr<Chunk>> free_chunks;
+    /// @brief True while the writer thread is writing a chunk it popped from pending
+    bool writing;
+    bool stop;
+    std::exception_ptr writer_exception;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread writer;
+};
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "torch/torch.h"
 
 /// @brief Compute the running mean and std using this algorithm:
 /// https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm
+/// Statistics are accumulated in double precision so the count stays exact
+/// for long runs, and independent accumulators (one per thread or process)
+/// can be combined with Merge or Reduce
 
 class RunningMeanStd
 {
@@ -13,13 +17,57 @@ public:
     RunningMeanStd(const c10::IntArrayRef shape = {}, const float epsilon = 1e-4f);
     ~RunningMeanStd();
 
-    const torch::Tensor& GetMean() const;
-    const torch::Tensor& GetVar() const;
+    /// @brief Get the current mean as a float tensor of the statistics shape
+    torch::Tensor GetMean() const;
+    /// @brief Get the current variance as a float tensor of the statistics shape
+    torch::Tensor GetVar() const;
+    /// @brief Get the (weighted) number of samples these statistics have seen
+    double GetCount() const;
 
     /// @brief Update the mean and var from a batch of size { Nx... }
     /// @param batch The batch of data
     void Update(const torch::Tensor& batch);
 
+    /// @brief Update the mean and var from N contiguous samples without creating any tensor
+    /// @param batch Pointer to N * GetMean().numel() floats
+    /// @param N Number of samples in batch
+    void Update(const float* batch, const int64_t N);
+
+    /// @brief Add the statistics of another accumulator of the same shape to this one,
+    /// as if all its samples had been passed to Update
+    /// @param other Statistics to merge in this object
+    void Merge(const RunningMeanStd& other);
+
+    /// @brief Merge several accumulators pairwise in a tree, which keeps
+    /// the rounding errors in O(log n) instead of O(n) for a serial merge
+    /// @param stats Accumulators to merge, all with the same shape
+    /// @return An accumulator with the statistics of all the samples seen by stats
+    static RunningMeanStd Reduce(const std::vector<RunningMeanStd>& stats);
+
+    /// @brief Get the whole state as a flat double tensor: count, mean, var
+    /// @return A tensor of size {2 * GetMean().numel() + 1}
+    torch::Tensor GetState() const;
+
+    /// @brief Set the whole state from a flat double tensor as returned by GetState
+    void SetState(const torch::Tensor& state);
+
+    /// @brief Remove the samples summarized by base from the statistics in state.
+    /// This is the inverse of Merge, used to get what an accumulator saw since some previous state
+    /// @param state GetState() of statistics that include base
+    /// @param base GetState() of some previous statistics
+    /// @return GetState() of the samples added since base (count 0 if none)
+    static torch::Tensor SubtractState(const torch::Tensor& state, const torch::Tensor& base);
+
+    /// @brief Normalize N contiguous samples in place in a single pass, computing
+    /// clamp((x - mean) / sqrt(var + epsilon), -clip, clip). 1 / sqrt(var + epsilon)
+    /// is cached and only recomputed when the statistics or epsilon change
+    /// @param batch Pointer to N * GetMean().numel() floats
+    /// @param N Number of samples in batch
+    /// @param epsilon Added to the variance
+    /// @param clip Normalized values are clamped in [-clip, clip]
+    /// @param center If false, the mean is not subtracted (x is only scaled)
+    void Normalize(float* batch, const int64_t N, const float epsilon, const float clip, const bool center = true) const;
+
     /// @brief Dump this object to a file
     /// @param path Binary file to write the data
     void Save(const std::string& path) const;
@@ -29,7 +77,22 @@ public:
     void Load(const std::string& path);
 
 private:
-    torch::Tensor mean;
-    torch::Tensor var;
-    float count;
+    /// @brief Combine the statistics of other_count samples into this object (Chan et al.)
+    void Combine(const double* other_mean, const double* other_var, const double other_count);
+
+private:
+    std::vector<int64_t> shape;
+    std::vector<double> mean;
+    std::vector<double> var;
+    double count;
+
+    /// @brief Batch statistics used by the raw pointer Update, kept to avoid reallocation
+    std::vector<double> batch_mean;
+    std::vector<double> batch_var;
+
+    /// @brief Cached float mean and 1 / sqrt(var + inv_std_epsilon), valid if !cache_dirty
+    mutable std::vector<float> cached_mean;
+    mutable std::vector<float> inv_std;
+    mutable float inv_std_epsilon;
+    mutable bool cache_dirty;
 };
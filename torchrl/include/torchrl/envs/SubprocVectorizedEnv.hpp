@@ -0,0 +1,86 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "torchrl/envs/VectorizedEnv.hpp"
+
+/// @brief A vectorized env running its envs in separate worker
+/// processes, so non thread-safe envs are isolated from each
+/// other and from the training process. Each worker hosts a
+/// contiguous slice of the envs and exchanges actions and
+/// observations with this process through shared memory.
+/// If a worker crashes, it's restarted with new envs. Envs
+/// of this worker are then reported as Terminal with a reward
+/// and an episode length of 0, as their lost episodes can't be
+/// bootstrapped. Workers are forked by a single threaded spawner
+/// process, itself forked when the envs are created, so they must
+/// be created before any other thread is started in the process
+/// (e.g. by libtorch or SetNumThreads). Only available on Linux.
+class SubprocVectorizedEnv : public VectorizedEnv
+{
+public:
+	SubprocVectorizedEnv(
+		const bool norm_obs_ = true, const bool norm_reward_ = true,
+		const float max_obs_ = 10.0f, const float max_reward_ = 10.0f,
+		const float discount_factor_ = 0.99f, const float epsilon_ = 1e-8f
+	);
+	virtual ~SubprocVectorizedEnv();
+
+	/// @brief Populate the vectorized env with N env of type Env split in num_workers processes
+	/// @tparam Env An Env deriving from AbstractEnv
+	/// @param N Number of environments
+	/// @param num_workers Number of worker processes
+	/// @param seed Base random seed. Will be incremented for each env. If 0 a random one is chosen.
+	template<class Env>
+	void CreateEnvs(const int N, const int num_workers, unsigned int seed = 0)
+	{
+		if (N == 0)
+		{
+			throw std::runtime_error("Cannot create 0 env in SubprocVectorizedEnv");
+		}
+
+		if (seed == 0)
+		{
+			seed = std::random_device()();
+		}
+
+		StartWorkers([](const unsigned int s) -> std::unique_ptr<AbstractEnv> { return std::make_unique<Env>(s); }, N, num_workers, seed);
+	}
+
+	/// @brief Get the number of times a crashed worker has been restarted
+	uint64_t GetNumRestarts() const;
+
+protected:
+	virtual void ResetEnvs(torch::Tensor& obs) override;
+	virtual void StepEnvs(const torch::Tensor& action, VectorizedStepResult& result) override;
+	virtual void StepEnvsAsync(const torch::Tensor& action, const std::vector<int64_t>& env_ids) override;
+	virtual void GetEnvsObs(torch::Tensor& obs) const override;
+	virtual void RenderEnvs() override;
+
+private:
+	struct Worker;
+
+	void StartWorkers(const std::function<std::unique_ptr<AbstractEnv>(const unsigned int)>& env_factory_,
+		const int N, const int num_workers, const unsigned int seed_);
+	void StopWorkers();
+
+	/// @brief Start the process for worker w, forked by the spawner
+	void Spawn(Worker& w) const;
+	/// @brief Loop of the spawner process, forking the workers requested
+	/// on socket and reporting their death in their shared memory
+	void SpawnerMain(const int socket) const;
+	/// @brief Send the same command to all workers and wait for them
+	/// @return for each worker, true if it crashed and had to be restarted
+	std::vector<bool> RunCommand(const uint32_t command) const;
+
+private:
+	std::function<std::unique_ptr<AbstractEnv>(const unsigned int)> env_factory;
+	unsigned int seed;
+	/// @brief mutable as crashed workers are restarted even during const calls
+	mutable std::vector<Worker> workers;
+	mutable uint64_t num_restarts;
+	/// @brief Process forking the workers, and socket to send it requests
+	int spawner_pid;
+	int spawner_socket;
+};
@@ -1,9 +1,17 @@
 #pragma once
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 #include <memory>
 
 #include "torchrl/envs/AbstractEnv.hpp"
+#include "torchrl/envs/BatchedAbstractEnv.hpp"
 #include "torchrl/envs/RunningMeanStd.hpp"
+#include "torchrl/utils/ThreadPool.hpp"
+
+class ExperienceRecorder;
 
 struct VectorizedStepResult
 {
@@ -13,12 +21,18 @@ struct VectorizedStepResult
 	torch::Tensor rewards;
 	/// @brief termination state of the episode for each env
 	std::vector<TerminalState> terminal_states;
-	/// @brief if terminal_state != NotTerminal, new obs after a reset operation, else empty (for each env)
-	std::vector<torch::Tensor> new_episode_obs;
+	/// @brief true for each env with terminal_state != NotTerminal, bool tensor of shape {N}
+	torch::Tensor terminal_mask;
+	/// @brief indices (rows in this result) of the envs with terminal_state != NotTerminal
+	std::vector<int64_t> terminated_envs;
+	/// @brief shape {N, o}, if terminal_state != NotTerminal, new obs after a reset operation, else unspecified
+	torch::Tensor new_episode_obs;
 	/// @brief if terminal_state != NotTerminal, total reward got during the episode, else 0 (for each env)
 	std::vector<float> episodes_tot_reward;
 	/// @brief if terminal_state != NotTerminal, total number of steps during the episode, else 0 (for each env)
 	std::vector<uint64_t> episodes_tot_length;
+	/// @brief ids of the envs in this result, only filled by Recv (Step results contain all envs in order)
+	std::vector<int64_t> env_ids;
 };
 
 /// @brief A vectorized env runs multiple envs, allowing batch
@@ -31,22 +45,72 @@ public:
 		const float max_obs_ = 10.0f, const float max_reward_ = 10.0f,
 		const float discount_factor_ = 0.99f, const float epsilon_ = 1e-8f
 	);
-	~VectorizedEnv();
+	virtual ~VectorizedEnv();
 
 	void SetTraining(const bool b);
 
+	/// @brief If true, Step writes its results in buffers owned by this env and reused
+	/// at each step (pinned if CUDA is available), so stepping envs implementing the
+	/// in place interface doesn't allocate. Results are then overwritten by the next Step
+	/// @param b True to reuse the buffers, false to get fresh ones at each step
+	void SetReuseBuffers(const bool b);
+
+	/// @brief Tee the transitions of all the following Step and Recv into an experience file.
+	/// Must be called while no env is stepping, the recorder must outlive the recording
+	/// @param recorder_ Recorder to write the transitions with, nullptr to stop recording
+	/// @param record_normalized_ If true, obs and rewards are recorded as returned by Step
+	/// and Recv (normalized if enabled), otherwise as returned by the envs
+	void SetRecorder(ExperienceRecorder* recorder_, const bool record_normalized_ = false);
+
+	/// @brief Set the number of threads used to step/reset the envs
+	/// Envs are split in contiguous shards, one per thread. As each env
+	/// has its own random engine, results are the same as in serial mode
+	/// @param n Number of threads (including the calling one), 1 to run serially
+	void SetNumThreads(const int n);
+	int GetNumThreads() const;
+
 	int64_t GetNumEnvs() const;
 	int64_t GetObservationSize() const;
 	int64_t GetActionSize() const;
 
+	/// @brief Get the statistics used to normalize the obs, e.g. to synchronize them with other processes
+	RunningMeanStd& GetObsNormalizer();
+	const RunningMeanStd& GetObsNormalizer() const;
+	/// @brief Whether the obs are normalized, with clamp((obs - mean) / sqrt(var + GetEpsilon()), -GetMaxObs(), GetMaxObs())
+	bool GetNormObs() const;
+	float GetMaxObs() const;
+	float GetEpsilon() const;
+	/// @brief Get the statistics of the discounted returns used to normalize the rewards
+	RunningMeanStd& GetRewardNormalizer();
+
 	/// @brief Reset all envs
 	/// @return a {N, GetObservationSize()} tensor with all envs obs
 	torch::Tensor Reset();
 
 	/// @brief Perform one step for each env
 	/// @param action a {N, GetActionSize()} tensor with actions for each env
-	/// @return VectorizedStepResult object with results for each env
-	VectorizedStepResult Step(const torch::Tensor& action);
+	/// @return VectorizedStepResult object with results for each env, valid until the next
+	/// call to Step if buffers are reused (see SetReuseBuffers). It belongs to this env, its
+	/// tensors must not be modified in place (copy them first)
+	const VectorizedStepResult& Step(const torch::Tensor& action);
+
+	/// @brief Start stepping some envs without waiting for the results, which
+	/// are then retrieved with Recv. Envs are stepped on the thread pool if any,
+	/// or immediately in the calling thread in serial mode. Reset, Step and GetObs
+	/// must not be called while some envs are stepping
+	/// @param action a {env_ids.size(), GetActionSize()} tensor with actions for each env
+	/// @param env_ids ids of the envs to step, they must not be already stepping
+	void StepAsync(const torch::Tensor& action, const std::vector<int64_t>& env_ids);
+
+	/// @brief Wait for envs launched with StepAsync to be done. If an env step threw, the
+	/// exception is rethrown and the failed envs are not stepping anymore, the other ones
+	/// can still be received
+	/// @param min_batch Minimum number of envs to wait for
+	/// @return VectorizedStepResult object with results for all the envs done so far (at least min_batch), env_ids is set
+	VectorizedStepResult Recv(const int64_t min_batch);
+
+	/// @brief Get the number of envs launched with StepAsync and not received yet
+	int64_t GetNumStepping() const;
 
 	/// @brief Render each envs
 	/// @param wait_ms time to wait in ms after the render is complete
@@ -65,7 +129,8 @@ public:
 	void Load(const std::string& path);
 
 	/// @brief Populate the vectorized env with N env of type Env
-	/// @tparam Env An Env deriving from AbstractEnv
+	/// @tparam Env An Env deriving from AbstractEnv, or from BatchedAbstractEnv to step all the envs at once
+	/// (in this case envs are not sharded on the thread pool and StepAsync is not available)
 	/// @param N Number of environments
 	/// @param seed Base random seed. Will be incremented for each env. If 0 a random one is chosen.
 	template<class Env>
@@ -81,36 +146,137 @@ public:
 			seed = std::random_device()();
 		}
 
-		envs.clear();
-		envs.reserve(N);
-		for (int i = 0; i < N; ++i)
+		if (num_stepping > 0)
 		{
-			envs.push_back(std::make_unique<Env>(seed + i));
+			throw std::runtime_error("Cannot create envs while some are still stepping in VectorizedEnv");
 		}
 
-		num_envs = envs.size();
-		obs_size = envs[0]->GetObservationSize();
-		act_size = envs[0]->GetActionSize();
-
-		if (norm_obs)
+		envs.clear();
+		batched_env.reset();
+		if constexpr (std::is_base_of_v<BatchedAbstractEnv, Env>)
 		{
-			obs_rms = RunningMeanStd({ obs_size });
+			batched_env = std::make_unique<Env>(N, seed);
+			Init(N, batched_env->GetObservationSize(), batched_env->GetActionSize());
 		}
-		if (norm_reward)
+		else
 		{
-			returns = torch::zeros({ N }).set_requires_grad(false);
-			ret_rms = RunningMeanStd({  });
+			envs.reserve(N);
+			for (int i = 0; i < N; ++i)
+			{
+				envs.push_back(std::make_unique<Env>(seed + i));
+			}
+
+			Init(envs.size(), envs[0]->GetObservationSize(), envs[0]->GetActionSize());
 		}
 	}
 
+protected:
+	/// @brief Set the envs dimensions and (re)create the normalizers
+	void Init(const int64_t num_envs_, const int64_t obs_size_, const int64_t act_size_);
+
+	// Functions actually running the envs, can be overriden to run them differently
+
+	/// @brief Reset all envs
+	/// @param obs {N, o} contiguous tensor to write the (not normalized) obs of each env in
+	virtual void ResetEnvs(torch::Tensor& obs);
+	/// @brief Step all envs, writing obs, rewards, terminal_states, new_episode_obs
+	/// and episodes totals in the preallocated result
+	virtual void StepEnvs(const torch::Tensor& action, VectorizedStepResult& result);
+	/// @brief Start stepping some envs, each env i then has to be pushed to ready_envs with its result in step_results[i]
+	virtual void StepEnvsAsync(const torch::Tensor& action, const std::vector<int64_t>& env_ids);
+	/// @brief Get the obs of all envs
+	/// @param obs {N, o} contiguous tensor to write the (not normalized) obs of each env in
+	virtual void GetEnvsObs(torch::Tensor& obs) const;
+	/// @brief Render all envs
+	virtual void RenderEnvs();
+
+	/// @brief Write one env step result in row k of a vectorized result
+	void WriteResult(const StepResult& res, const int64_t k, VectorizedStepResult& result) const;
+
 private:
-	torch::Tensor NormalizeObs(const torch::Tensor& obs) const;
-	torch::Tensor NormalizeReward(const torch::Tensor& reward) const;
-	void UpdateObs(const torch::Tensor& obs);
-	void UpdateReward(const torch::Tensor& reward);
+	/// @brief Run f on all envs, sharded on the thread pool if any
+	/// @param f Function processing envs in [begin, end)
+	void ForEachEnv(const std::function<void(const int64_t, const int64_t)>& f);
+
+	/// @brief Allocate all the fields of a result for N envs
+	void AllocateResult(VectorizedStepResult& result, const int64_t N, const bool pinned) const;
+
+	/// @brief Step envs [begin, end) with step_actions, writing the results in step_output
+	void StepEnvsRange(const int64_t begin, const int64_t end);
+
+	/// @brief Step all the envs of batched_env at once
+	void StepBatchedEnv(const torch::Tensor& action, VectorizedStepResult& result);
+
+	/// @brief Step env i with the action stored for it by StepAsync
+	void StepAsyncEnv(const int64_t i);
+
+	/// @brief Fill the terminated envs fields, update the normalizers and normalize a vectorized result in place
+	/// @param normalizer_obs {N, o} tensor used to store the obs the normalizer is updated with
+	/// @param all_envs If true, result contains all the envs in order, otherwise result.env_ids is used
+	void NormalizeResult(VectorizedStepResult& result, torch::Tensor& normalizer_obs, const bool all_envs);
+
+	/// @brief Record the transitions of a result and update the recorded obs of its envs
+	/// @param action Actions of the envs in result if all_envs, of all the envs by id otherwise
+	/// @param all_envs If true, result contains all the envs in order, otherwise result.env_ids is used
+	void RecordResult(const torch::Tensor& action, const VectorizedStepResult& result, const bool all_envs);
+
+	/// @brief Normalize and clip N contiguous obs in place
+	void NormalizeObs(float* obs, const int64_t N) const;
+	/// @brief Scale and clip N rewards in place
+	void NormalizeReward(float* reward, const int64_t N) const;
+	/// @brief Update the obs normalizer with N contiguous obs
+	void UpdateObs(const float* obs, const int64_t N);
+	/// @brief Update the discounted returns and their normalizer with N rewards
+	/// @param env_ids Env of each reward, nullptr if rewards are for all the envs in order
+	void UpdateReward(const float* reward, const int64_t N, const std::vector<int64_t>* env_ids = nullptr);
 
 protected:
 	std::vector<std::unique_ptr<AbstractEnv>> envs;
+	/// @brief All the envs if they implement the batched interface, nullptr otherwise
+	std::unique_ptr<BatchedAbstractEnv> batched_env;
+	/// @brief Batched env terminal states, converted to TerminalState in VectorizedStepResult
+	std::vector<uint8_t> batched_terminal_states;
+
+	bool reuse_buffers;
+	/// @brief Result of the last Step
+	VectorizedStepResult step_result;
+	/// @brief Obs used to update the obs normalizer in Step, and in Recv (first rows)
+	torch::Tensor step_normalizer_obs;
+	/// @brief Actions and result of the current StepEnvs, actions are contiguous float
+	torch::Tensor step_actions;
+	VectorizedStepResult* step_output;
+	/// @brief Pool task stepping envs in range, persistent so Step doesn't allocate
+	std::function<void(const int64_t, const int64_t)> step_task;
+	/// @brief Worker threads used to step the envs, nullptr in serial mode
+	std::unique_ptr<ThreadPool> thread_pool;
+
+	/// @brief Last result of each env stepped with StepAsync, not normalized
+	std::vector<StepResult> step_results;
+	/// @brief Actions sent to each env with StepAsync
+	std::vector<torch::Tensor> async_actions;
+	/// @brief Whether each env has been launched with StepAsync and not received yet
+	std::vector<bool> stepping;
+	int64_t num_stepping;
+	/// @brief Pool task stepping env begin, persistent so submitting it doesn't allocate
+	std::function<void(const int64_t, const int64_t)> async_step_task;
+	ThreadPool::TaskGroup async_tasks;
+	/// @brief Envs done stepping and not received yet
+	std::vector<int64_t> ready_envs;
+	/// @brief Envs whose step threw, released by Recv when it rethrows async_exception
+	std::vector<int64_t> failed_envs;
+	std::exception_ptr async_exception;
+	std::mutex ready_mutex;
+	std::condition_variable ready_condition;
+
+	/// @brief If not nullptr, transitions are recorded with it
+	ExperienceRecorder* recorder;
+	bool record_normalized;
+	/// @brief {N, o} obs each env chose its current action on, as recorded
+	torch::Tensor recorder_obs;
+	/// @brief {N, a} actions sent to each env with StepAsync, as recorded
+	torch::Tensor recorder_actions;
+	/// @brief Ids of all the envs in order, to record Step results
+	std::vector<int64_t> recorder_env_ids;
 
 	int64_t num_envs;
 	int64_t obs_size;
@@ -128,4 +294,6 @@ protected:
 	RunningMeanStd ret_rms;
 	/// @brief reward normalization is done with the discounted reward
 	torch::Tensor returns;
+	/// @brief Returns of the envs of a Recv result, to update ret_rms without allocating
+	std::vector<float> env_returns;
 };
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include "torch/torch.h"
+
+/// @brief Same as torch::nn::utils::clip_grad_norm_, without reading the total norm
+/// back. Gradients are always scaled by min(1, max_norm / norm), which is exactly 1
+/// when they don't need to be clipped
+/// @param parameters Parameters whose gradients are clipped in place
+/// @param max_norm Max norm of all the gradients together
+void ClipGradNorm(const std::vector<torch::Tensor>& parameters, const float max_norm);
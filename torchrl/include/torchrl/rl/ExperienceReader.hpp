@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "torch/torch.h"
+
+#include "torchrl/envs/AbstractEnv.hpp"
+#include "torchrl/rl/Policy.hpp"
+
+class ReplayBuffer;
+class RolloutBuffer;
+
+/// @brief Consecutive transitions of an experience file. Tensors are read-only views
+/// of the file mapping, only valid while the ExperienceReader they come from is alive
+struct ExperienceBatch
+{
+    /// @brief {N, obs_size} observations the actions were chosen on
+    torch::Tensor obs;
+    /// @brief {N, act_size}
+    torch::Tensor action;
+    /// @brief {N}
+    torch::Tensor reward;
+    /// @brief {N, obs_size} observations after the actions (before the reset if the episode ended)
+    torch::Tensor next_obs;
+    /// @brief {N} long
+    torch::Tensor env_id;
+    /// @brief {N} uint8 TerminalState
+    torch::Tensor terminal_state;
+
+    /// @brief Get the ids of the envs as a vector
+    std::vector<int64_t> GetEnvIds() const;
+    /// @brief Get the terminal states as a vector
+    std::vector<TerminalState> GetTerminalStates() const;
+};
+
+/// @brief Stream the transitions of an experience file written by an ExperienceRecorder.
+/// The file is memory-mapped and read sequentially, and batches are zero-copy views of
+/// its chunk columns, so replaying a log only costs the copies into the buffers fed with
+/// it. Only available on Linux
+class ExperienceReader
+{
+public:
+    /// @param path_ File to read, its complete chunks at the time of the call are indexed
+    ExperienceReader(const std::string& path_);
+    ~ExperienceReader();
+
+    ExperienceReader(const ExperienceReader&) = delete;
+    ExperienceReader& operator=(const ExperienceReader&) = delete;
+
+    int64_t GetObservationSize() const;
+    int64_t GetActionSize() const;
+    int64_t GetNumChunks() const;
+    /// @brief Get the total number of transitions in the file
+    int64_t GetNumTransitions() const;
+
+    /// @brief Get all the transitions of a chunk
+    ExperienceBatch GetChunk(const int64_t i) const;
+
+    /// @brief Get the next transitions in file order. A batch never spans two chunks,
+    /// so it can be smaller than max_size before the end of the file
+    /// @param max_size Max number of transitions to read
+    /// @param batch Output views
+    /// @return False if all the transitions have been read
+    bool Next(const int64_t max_size, ExperienceBatch& batch);
+
+    /// @brief Restart reading from the first transition
+    void Rewind();
+
+    /// @brief Add all the remaining transitions to a replay buffer, e.g. for offline RL
+    /// @return Number of transitions added
+    int64_t Fill(ReplayBuffer& buffer);
+
+    /// @brief Reset a rollout buffer and add the next rollout to it (n_steps transitions for
+    /// each of its envs), with the values and log probabilities of the recorded actions evaluated
+    /// by policy. The recorded envs must match the envs of the buffer, and the obs must be the
+    /// ones the policy was trained on (see VectorizedEnv::SetRecorder), e.g. to rerun PPO updates
+    /// on logged data deterministically. As in PPO, the rewards of timed out episodes are
+    /// bootstrapped with gamma * V(last obs). Throws before adding a batch of transitions if
+    /// an env would get more than n_steps steps
+    /// @param gamma Discount factor used for the bootstrap
+    /// @param last_values Output {n_envs, 1}, value of the next obs of the last step of each env
+    /// (0 if its episode ended), to pass to RolloutBuffer::ComputeReturnsAndAdvantage. Only set if
+    /// the rollout is complete
+    /// @return Number of transitions added, less than n_envs * n_steps at the end of the file
+    int64_t Fill(RolloutBuffer& buffer, Policy& policy, const float gamma, torch::Tensor& last_values);
+
+private:
+    struct ChunkInfo
+    {
+        /// @brief Address of the first column
+        const char* payload;
+        int64_t num_rows;
+    };
+
+    /// @brief View of rows [begin, begin + n) of a chunk
+    ExperienceBatch GetRows(const ChunkInfo& chunk, const int64_t begin, const int64_t n) const;
+
+private:
+    std::string path;
+    int64_t obs_size;
+    int64_t act_size;
+    int64_t num_transitions;
+    std::vector<ChunkInfo> chunks;
+
+    /// @brief Chunk and row of the next transition returned by Next
+    int64_t cursor_chunk;
+    int64_t cursor_row;
+
+    int fd;
+    void* mapping;
+    size_t mapping_size;
+};
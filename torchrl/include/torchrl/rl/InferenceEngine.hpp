@@ -0,0 +1,73 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "torch/torch.h"
+#include "torchrl/rl/Policy.hpp"
+
+/// @brief Inference only copy of a Policy, running its MLPs and the gaussian sampling
+/// with hand-written SIMD kernels (see SIMD.hpp) instead of libtorch ops. On the small
+/// batches used to collect rollouts, this avoids most of the per op dispatch overhead.
+/// Weights are snapshotted by Update, which must be called again after each policy update
+class InferenceEngine
+{
+public:
+    /// @param seed Seed of the random engine used to sample the actions
+    InferenceEngine(const unsigned int seed);
+    ~InferenceEngine();
+
+    /// @brief Copy the policy weights in packed aligned buffers
+    /// @param policy Policy to snapshot, with the architecture of PolicyImpl (tanh MLPs)
+    void Update(const Policy& policy);
+
+    /// @brief Same as PolicyImpl::forward, with the snapshotted weights
+    /// @param observations {N, obs_dim} observations
+    /// @param deterministic Whether to sample or use deterministic actions
+    /// @return A tuple <actions, values, log probabilities of the actions>
+    std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> Forward(const torch::Tensor& observations, const bool deterministic = false);
+
+    /// @brief Same as PolicyImpl::PredictValues, with the snapshotted weights
+    /// @param observations {N, obs_dim} observations
+    /// @return {N, 1} estimated values
+    torch::Tensor PredictValues(const torch::Tensor& observations);
+
+private:
+    struct Layer
+    {
+        int64_t in_size;
+        int64_t out_size;
+        /// @brief out_size rounded up to a multiple of the SIMD width
+        int64_t stride;
+        /// @brief Transposed weights {in_size, stride}, padded with zeros
+        float* weights;
+        /// @brief {stride} biases, padded with zeros
+        float* bias;
+    };
+
+    /// @brief Copy the weights of a MLP into layers, allocated from buffer
+    /// @return Number of floats used in buffer
+    size_t PackMLP(const MLP& mlp, std::vector<Layer>& layers, float* buffer);
+
+    /// @brief Run all the layers on N contiguous inputs
+    /// @return Pointer to the {N, stride of the last layer} outputs, in one of the hidden buffers
+    const float* RunMLP(const std::vector<Layer>& layers, const float* in, const int64_t N);
+
+    /// @brief Fill noise with at least count standard normal samples
+    void SampleNormal(const int64_t count);
+
+private:
+    /// @brief Cache line aligned weights of all layers are stored in this buffer
+    std::vector<float> storage;
+    std::vector<Layer> actor_layers;
+    std::vector<Layer> critic_layers;
+    std::vector<float> action_std;
+    /// @brief Log probability of the mean action
+    float mean_log_prob;
+
+    /// @brief Intermediate activations, grown to the largest batch seen
+    std::vector<float> hidden[2];
+    std::vector<float> uniform;
+    std::vector<float> noise;
+    std::mt19937 random_engine;
+};
@@ -12,6 +12,9 @@ public:
 
 	void InitOrtho(const float gain_backbone, const float gain_out);
 
+	/// @brief Get the linear layers, from input to output
+	std::vector<torch::nn::Linear> GetLayers() const;
+
 private:
 	torch::nn::Linear l1{ nullptr };
 	torch::nn::Linear l2{ nullptr };
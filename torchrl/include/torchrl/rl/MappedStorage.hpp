@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+
+#include "torch/torch.h"
+
+/// @brief Rollout or replay data stored in a memory-mapped file instead of RAM, so
+/// buffers can be larger than the memory: recently written rows stay resident and
+/// the OS pages the others in and out. The file starts with a page-sized header
+/// (layout and buffer state), followed by capacity fixed-stride rows of floats:
+/// [obs (obs_size) | action (act_size) | reward | terminal | value | log_prob | next obs (obs_size, optional)]
+/// Fields are exposed as strided tensor views of the mapping, so buffers use them
+/// as regular tensors. Opening an existing file with the same layout resumes it
+/// with its data and state. Only available on Linux
+class MappedStorage
+{
+public:
+    /// @param path_ File to map, created (sparse) if it doesn't exist
+    /// @param capacity_ Number of rows
+    /// @param store_next_obs_ If true, each row also has a next observation field
+    MappedStorage(const std::string& path_, const int64_t capacity_, const int64_t obs_size_, const int64_t act_size_, const bool store_next_obs_);
+    ~MappedStorage();
+
+    MappedStorage(const MappedStorage&) = delete;
+    MappedStorage& operator=(const MappedStorage&) = delete;
+
+    /// @brief True if the file already existed, with the data of a previous run
+    bool IsResumed() const;
+
+    /// @brief {capacity, obs_size} view of the observations
+    torch::Tensor GetObservations() const;
+    /// @brief {capacity, act_size} view of the actions
+    torch::Tensor GetActions() const;
+    /// @brief {capacity, 1} view of the rewards
+    torch::Tensor GetRewards() const;
+    /// @brief {capacity, 1} view of the terminal flags
+    torch::Tensor GetTerminals() const;
+    /// @brief {capacity, 1} view of the values
+    torch::Tensor GetValues() const;
+    /// @brief {capacity, 1} view of the log probabilities
+    torch::Tensor GetLogProbs() const;
+    /// @brief {capacity, obs_size} view of the next observations, undefined if they are not stored
+    torch::Tensor GetNextObservations() const;
+
+    /// @brief Number of floats between two rows
+    int64_t GetStride() const;
+    int64_t GetCapacity() const;
+
+    /// @brief Save the state of the buffer using this storage in the header, to resume it later
+    /// @param position Next row to write
+    /// @param size Number of valid rows
+    void SetState(const int64_t position, const int64_t size);
+    int64_t GetPosition() const;
+    int64_t GetSize() const;
+
+    /// @brief Schedule the write back of the modified pages to the file
+    /// @param blocking If true, wait for the write to be done
+    void Flush(const bool blocking = false);
+
+private:
+    /// @brief {capacity, n} view of n floats at offset in each row
+    torch::Tensor Field(const int64_t offset, const int64_t n) const;
+
+private:
+    std::string path;
+    int64_t capacity;
+    int64_t obs_size;
+    int64_t act_size;
+    bool store_next_obs;
+    int64_t stride;
+    bool resumed;
+
+    int fd;
+    void* mapping;
+    size_t mapping_size;
+    float* rows;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "torch/torch.h"
+
+#include "torchrl/rl/RolloutBuffer.hpp"
+#include "torchrl/utils/ThreadPool.hpp"
+
+/// @brief Iterate over shuffled minibatches of a RolloutBuffer. One permutation
+/// is drawn per epoch, and each minibatch is gathered straight from the buffer
+/// storage into tensors reused from one minibatch to the next. Optionally, the
+/// next minibatch is gathered on a helper thread while the current one is used
+class MinibatchSampler
+{
+public:
+    /// @param buffer_ Buffer to sample from, must outlive this object
+    /// @param batch_size_ Size of a minibatch, the last one of an epoch can be smaller
+    /// @param prefetch If true, gather the next minibatch on a helper thread
+    MinibatchSampler(const RolloutBuffer& buffer_, const int64_t batch_size_, const bool prefetch);
+    ~MinibatchSampler();
+
+    /// @brief Start a new epoch with a new permutation of all the samples in the buffer
+    void Reset();
+
+    /// @brief Get the next minibatch of the current epoch
+    /// @param batch Output minibatch, its tensors are valid until the next call
+    /// @return False if the epoch is over (batch is then unchanged)
+    bool Next(RolloutSample& batch);
+
+private:
+    /// @brief Gather the minibatch starting at position begin in gathered[slot]
+    void Gather(const int64_t begin, const int64_t slot);
+
+private:
+    const RolloutBuffer& buffer;
+    int64_t batch_size;
+
+    /// @brief Shuffled sample indices of the current epoch
+    torch::Tensor permutation;
+    int64_t num_samples;
+    /// @brief Start of the next minibatch returned by Next in permutation
+    int64_t position;
+
+    /// @brief Two sets of minibatch tensors, one being used while the other is filled
+    RolloutSample gathered[2];
+    int64_t current_slot;
+
+    /// @brief Single helper thread used to prefetch, nullptr if disabled
+    std::unique_ptr<ThreadPool> thread_pool;
+    /// @brief Prefetch task, persistent so submitting it doesn't allocate
+    std::function<void(const int64_t, const int64_t)> gather_task;
+    ThreadPool::TaskGroup prefetch_group;
+    bool prefetching;
+};
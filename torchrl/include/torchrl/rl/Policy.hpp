@@ -6,7 +6,9 @@
 class PolicyImpl : public torch::nn::Module
 {
 public:
-    PolicyImpl(const int64_t obs_dim, const int64_t action_dim, const bool ortho_init = true, const float init_log_std = 0.0f);
+    /// @param fused_ If true, inference without grad runs both networks at once with block-structured
+    /// weights packed from them (three GEMMs instead of six). Training and saved files are unchanged
+    PolicyImpl(const int64_t obs_dim, const int64_t action_dim, const bool ortho_init = true, const float init_log_std = 0.0f, const bool fused_ = false);
     ~PolicyImpl();
 
     /// @brief Forward pass in all the networks (actor and critic)
@@ -26,10 +28,32 @@ public:
     /// @return The estimated values
     torch::Tensor PredictValues(const torch::Tensor& observations);
 
+    const MLP& GetActorNet() const;
+    const MLP& GetCriticNet() const;
+    const torch::Tensor& GetLogStd() const;
+
+private:
+    /// @brief Run both networks with the packed weights, only valid in no grad mode
+    /// @return A tuple <action means, values>
+    std::tuple<torch::Tensor, torch::Tensor> FusedForward(const torch::Tensor& observations);
+
+    /// @brief Pack pi_net and v_net weights if they changed since the last call: first
+    /// layers are concatenated, hidden and output layers are block-diagonal
+    void UpdateFusedWeights();
+
 private:
     MLP pi_net{ nullptr };
     MLP v_net{ nullptr };
 
     torch::Tensor log_std;
+
+    bool fused;
+    /// @brief Transposed packed weights {in, out} and biases of each layer
+    std::vector<torch::Tensor> fused_weights;
+    std::vector<torch::Tensor> fused_biases;
+    /// @brief Parameters of the module, cached to check their versions at each forward
+    std::vector<torch::Tensor> fused_parameters;
+    /// @brief Version of each parameter when the packed weights were built
+    std::vector<int64_t> fused_versions;
 };
 TORCH_MODULE(Policy);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+#include "torchrl/rl/Policy.hpp"
+
+class VectorizedEnv;
+
+/// @brief Export the deterministic actor of a policy as a frozen TorchScript module,
+/// optimized with torch::jit::optimize_for_inference. The module takes raw (not normalized)
+/// {N, obs_dim} observations and returns the {N, action_dim} actions, applying the env
+/// obs normalization first if it's enabled. It can be loaded with torch::jit::load
+/// without torchrl or the Policy class
+/// @param policy Trained policy
+/// @param env Env the policy was trained in, its obs normalizer is embedded in the module
+/// @param path File to write the module to
+void ExportTorchScript(const Policy& policy, const VectorizedEnv& env, const std::string& path);
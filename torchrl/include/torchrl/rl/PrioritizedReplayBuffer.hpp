@@ -0,0 +1,54 @@
+#pragma once
+
+#include <mutex>
+#include <random>
+
+#include "torchrl/rl/ReplayBuffer.hpp"
+#include "torchrl/utils/SumTree.hpp"
+
+/// @brief ReplayBuffer sampling the transitions proportionally to priority^alpha
+/// (prioritized experience replay), with stratified sampling on a SumTree. New
+/// transitions get the max priority seen so far. All the methods lock the same
+/// mutex, so priorities can be updated by the learner while actors add transitions
+class PrioritizedReplayBuffer : public ReplayBuffer
+{
+public:
+    /// @param alpha_ Prioritization exponent, 0 is uniform sampling
+    /// @param seed Seed of the random engine used to sample
+    /// @param storage_path See ReplayBuffer
+    PrioritizedReplayBuffer(const int64_t capacity_, const int64_t obs_size, const int64_t act_size,
+        const float alpha_ = 0.6f, const unsigned int seed = 0, const std::string& storage_path = "");
+    virtual ~PrioritizedReplayBuffer();
+
+    virtual void Add(const torch::Tensor& obs, const torch::Tensor& action, const torch::Tensor& reward,
+        const torch::Tensor& next_obs, const std::vector<TerminalState>& terminal_states) override;
+
+    /// @brief Gather a batch of transitions sampled proportionally to their priorities.
+    /// batch.weight is set to the importance sampling weights (p_min / p)^beta, so the
+    /// largest possible weight is 1
+    virtual void Sample(const int64_t batch_size, ReplaySample& batch) override;
+
+    virtual void Reset() override;
+
+    /// @brief Set the priorities of sampled transitions, usually to their new TD errors
+    /// @param indices {B} long indices, as in ReplaySample::indices
+    /// @param priorities {B} or {B, 1} new priorities, made positive with abs and a small epsilon
+    void UpdatePriorities(const torch::Tensor& indices, const torch::Tensor& priorities);
+
+    /// @brief Set the importance sampling correction exponent, usually annealed to 1 during training
+    void SetBeta(const float beta_);
+
+private:
+    SumTree tree;
+    std::mutex mutex;
+    std::mt19937 random_engine;
+
+    float alpha;
+    float beta;
+    /// @brief Max priority (before the alpha exponent) given so far
+    float max_priority;
+
+    /// @brief Reused between calls
+    std::vector<int64_t> tree_indices;
+    std::vector<float> tree_priorities;
+};
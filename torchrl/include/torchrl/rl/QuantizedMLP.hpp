@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "torch/torch.h"
+#include "torchrl/rl/MLP.hpp"
+
+/// @brief Int8 copy of a MLP for inference only (post-training quantization).
+/// Weights of each Linear layer are quantized per output channel (symmetric,
+/// scale = max |w| / 127). Activations stay fp32 between layers and are only
+/// quantized at the input of each layer, so matrix products run on int8 with
+/// int32 accumulation
+class QuantizedMLP
+{
+public:
+    /// @param mlp Trained MLP to quantize
+    /// @param calibration_inputs {N, in} sample of inputs (e.g. obs recorded from a VectorizedEnv)
+    /// used to set a fixed quantization scale for the input of each layer. If undefined or empty,
+    /// inputs are quantized dynamically with the max of each row, at the cost of an extra pass
+    QuantizedMLP(const MLP& mlp, const torch::Tensor& calibration_inputs = torch::Tensor());
+    ~QuantizedMLP();
+
+    /// @brief Same as MLPImpl::forward, with the quantized weights
+    /// @param in {N, in} inputs
+    /// @return {N, out} outputs
+    torch::Tensor Forward(const torch::Tensor& in);
+
+    /// @brief Whether the input scales have been calibrated or are computed for each row
+    bool IsCalibrated() const;
+
+private:
+    struct Layer
+    {
+        int64_t in_size;
+        int64_t out_size;
+        /// @brief {out_size, in_size} quantized weights
+        std::vector<int8_t> weights;
+        /// @brief Dequantization scale of each output channel
+        std::vector<float> weight_scales;
+        std::vector<float> bias;
+        /// @brief Calibrated quantization scale of the inputs, 0 to compute it for each row
+        float input_scale;
+    };
+
+    std::vector<Layer> layers;
+
+    /// @brief Intermediate activations and quantized inputs, grown to the largest batch seen
+    std::vector<float> activations[2];
+    std::vector<int8_t> quantized_row;
+};
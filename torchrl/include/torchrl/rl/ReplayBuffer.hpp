@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "torch/torch.h"
+
+#include "torchrl/envs/AbstractEnv.hpp"
+
+class MappedStorage;
+
+struct ReplaySample
+{
+    torch::Tensor observation;
+    torch::Tensor action;
+    /// @brief {B, 1}
+    torch::Tensor reward;
+    torch::Tensor next_observation;
+    /// @brief {B, 1}, 1.0 if the episode terminated after this step (timeouts excluded), 0.0 otherwise
+    torch::Tensor done;
+    /// @brief {B} long indices of the sampled transitions in the buffer
+    torch::Tensor indices;
+    /// @brief {B, 1} importance sampling weights, only defined for prioritized sampling
+    torch::Tensor weight;
+};
+
+/// @brief Store transitions for off-policy algorithms in one preallocated
+/// {capacity, dim} tensor per field, used as a ring buffer. Once full, the
+/// oldest transitions are overwritten. Adding a step of all the envs is at most
+/// two slice copies per field, and batches are gathered with one index_select per field
+class ReplayBuffer
+{
+public:
+    /// @param storage_path If not empty, transitions are stored in this memory-mapped file
+    /// instead of RAM (see MappedStorage). If it exists, its transitions are reused
+    ReplayBuffer(const int64_t capacity_, const int64_t obs_size, const int64_t act_size, const std::string& storage_path = "");
+    virtual ~ReplayBuffer();
+
+    /// @brief Add one transition for each row of the tensors
+    /// @param obs {N, obs_size} observations the actions were chosen on
+    /// @param action {N, act_size} actions
+    /// @param reward {N} rewards
+    /// @param next_obs {N, obs_size} observations after the actions (before the reset if the episode ended)
+    /// @param terminal_states Terminal state of each transition
+    virtual void Add(const torch::Tensor& obs, const torch::Tensor& action, const torch::Tensor& reward,
+        const torch::Tensor& next_obs, const std::vector<TerminalState>& terminal_states);
+
+    /// @brief Gather a batch of uniformly sampled transitions
+    /// @param batch_size Number of transitions to sample (with replacement)
+    /// @param batch Output, each undefined field is allocated
+    virtual void Sample(const int64_t batch_size, ReplaySample& batch);
+
+    /// @brief Gather the transitions at some indices in existing tensors, which are resized if needed
+    /// @param indices Long tensor of indices in [0, size())
+    /// @param batch Output, each undefined field is allocated
+    void GetBatch(const torch::Tensor& indices, ReplaySample& batch) const;
+
+    virtual void Reset();
+
+    /// @brief Get the number of transitions stored
+    int64_t size() const;
+    int64_t GetCapacity() const;
+
+protected:
+    int64_t capacity;
+    /// @brief Index of the next transition to write
+    int64_t position;
+    bool full;
+
+    /// @brief If not nullptr, owns the memory the tensors are views of, so it's declared before them
+    std::unique_ptr<MappedStorage> storage;
+
+    torch::Tensor observations;
+    torch::Tensor actions;
+    torch::Tensor rewards;
+    torch::Tensor next_observations;
+    torch::Tensor dones;
+};
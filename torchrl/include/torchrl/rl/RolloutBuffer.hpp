@@ -1,10 +1,16 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "torch/torch.h"
 
 #include "torchrl/envs/VectorizedEnv.hpp"
 #include "torchrl/rl/Policy.hpp"
 
+class MappedStorage;
+
 struct RolloutSample
 {
     RolloutSample()
@@ -30,81 +36,102 @@ struct RolloutSample
 
     }
 
-    RolloutSample(
-        const torch::Tensor& observation_,
-        const torch::Tensor& action_,
-        const torch::Tensor& value_,
-        const torch::Tensor& log_prob_
-    ) :
-        observation(observation_),
-        action(action_),
-        value(value_),
-        log_prob(log_prob_)
-    {
-
-    }
-
     torch::Tensor observation;
     torch::Tensor action;
     torch::Tensor value;
     torch::Tensor log_prob;
     torch::Tensor advantage;
     torch::Tensor returns;
-};
 
-struct RolloutSampleBatchTransform : public torch::data::transforms::BatchTransform<std::vector<RolloutSample>, RolloutSample> 
-{
-    RolloutSample apply_batch(std::vector<RolloutSample> batch) override 
-    {
-        std::vector<torch::Tensor> observation, action, value, log_prob, advantage, returns;
-        observation.reserve(batch.size());
-        action.reserve(batch.size());
-        value.reserve(batch.size());
-        log_prob.reserve(batch.size());
-        advantage.reserve(batch.size());
-        returns.reserve(batch.size());
-
-        for (auto& d : batch)
-        {
-            observation.push_back(d.observation);
-            action.push_back(d.action);
-            value.push_back(d.value);
-            log_prob.push_back(d.log_prob);
-            advantage.push_back(d.advantage);
-            returns.push_back(d.returns);
-        }
-
-        return RolloutSample(
-            torch::stack(observation),
-            torch::stack(action),
-            torch::stack(value),
-            torch::stack(log_prob),
-            torch::stack(advantage),
-            torch::stack(returns)
-        );
-    }
+    /// @brief Scratch bfloat16 observations gathered by a compact RolloutBuffer before
+    /// being converted in observation, kept to be reused by the next gathers
+    torch::Tensor compact_observation;
 };
 
-class RolloutBuffer : public torch::data::Dataset<RolloutBuffer, RolloutSample>
+/// @brief Store the steps of a rollout in one preallocated {n_steps, n_envs, dim}
+/// tensor per field, written in place by Add. Sample index t * n_envs + i is
+/// the step t of env i, and minibatches are gathered with one index_select per field
+/// (see MinibatchSampler)
+class RolloutBuffer
 {
 public:
-    RolloutBuffer(const uint64_t num_envs, const uint64_t reserve = 0);
-
+    /// @param storage_path If not empty, steps are stored in this memory-mapped file instead
+    /// of RAM (see MappedStorage), advantages and returns are still in RAM. The file is only
+    /// scratch space: a rollout can't be resumed, so existing steps are discarded
+    /// @param compact_ If true, observations are stored as bfloat16 (converted back to float
+    /// when gathered) and episode ends as bits, to reduce the memory traffic of the gathers.
+    /// Can't be used with a storage_path
+    RolloutBuffer(const int64_t num_envs_, const int64_t n_steps_, const int64_t obs_size, const int64_t act_size, const std::string& storage_path = "", const bool compact_ = false);
+    ~RolloutBuffer();
+
+    /// @brief Add one step for all the envs
     void Add(const torch::Tensor& obs, const torch::Tensor& action,
         const torch::Tensor& value, const torch::Tensor& log_prob,
         const torch::Tensor& reward, const std::vector<TerminalState>& episode_end);
 
+    /// @brief Add one step for only some of the envs
+    /// @param env_ids Ids of the envs, each row of the other tensors is for one of them
+    void Add(const std::vector<int64_t>& env_ids,
+        const torch::Tensor& obs, const torch::Tensor& action,
+        const torch::Tensor& value, const torch::Tensor& log_prob,
+        const torch::Tensor& reward, const std::vector<TerminalState>& episode_end);
+
     void Reset();
 
-    RolloutSample get(uint64_t index) override;
+    /// @brief Gather a minibatch, all envs must have the same number of steps
+    /// @param indices Long tensor of sample indices in [0, size())
+    /// @return A RolloutSample with one row per index
+    RolloutSample GetBatch(const torch::Tensor& indices) const;
+
+    /// @brief Gather a minibatch in existing tensors, which are resized if needed
+    /// @param indices Long tensor of sample indices in [0, size())
+    /// @param batch Output, each undefined field is allocated
+    void GetBatch(const torch::Tensor& indices, RolloutSample& batch) const;
+
+    /// @brief Get the total number of steps stored
+    torch::optional<size_t> size() const;
+
+    int64_t GetNumEnvs() const;
+    /// @brief Get the max number of steps of each env
+    int64_t GetNumSteps() const;
 
-    torch::optional<uint64_t> size() const override;
+    /// @brief Get the number of bytes used to store the steps
+    /// @param full_precision If true, get the size this buffer would use without compact storage
+    size_t GetMemorySize(const bool full_precision = false) const;
 
-    void ComputeReturnsAndAdvantage(const torch::Tensor& value, 
+    /// @brief Compute the returns and GAE advantages, all envs must have the same number of steps
+    /// @param value {n_envs, 1} estimated value after the last step of each env
+    void ComputeReturnsAndAdvantage(const torch::Tensor& value,
         const float gamma, const float lambda_gae);
 
 private:
-    std::vector<std::vector<RolloutSample> > data;
-    std::vector<std::vector<float> > rewards;
-    std::vector<std::vector<bool> > episode_ends;
+    /// @brief Set whether the episode ended at sample k
+    void SetEpisodeEnd(const int64_t k, const bool ended);
+
+private:
+    int64_t num_envs;
+    int64_t n_steps;
+    /// @brief Number of steps added for each env
+    std::vector<int64_t> positions;
+
+    /// @brief If not nullptr, owns the memory some tensors are views of, so it's declared before them
+    std::unique_ptr<MappedStorage> storage;
+    /// @brief Number of floats between two consecutive samples in values, rewards and
+    /// episode_ends: 1 in RAM, the row stride of the storage if mapped
+    int64_t sample_stride;
+
+    torch::Tensor observations;
+    torch::Tensor actions;
+    torch::Tensor values;
+    torch::Tensor log_probs;
+    torch::Tensor advantages;
+    torch::Tensor returns;
+    /// @brief {n_steps, n_envs}
+    torch::Tensor rewards;
+    /// @brief {n_steps, n_envs}, 1.0 if the episode ended at this step, 0.0 otherwise. Undefined if compact
+    torch::Tensor episode_ends;
+
+    bool compact;
+    /// @brief Bit k is set if the episode ended at sample k, only used if compact
+    std::vector<uint64_t> episode_end_bits;
 };
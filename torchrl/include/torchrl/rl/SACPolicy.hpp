@@ -0,0 +1,45 @@
+#pragma once
+
+#include "torch/torch.h"
+#include "torchrl/rl/MLP.hpp"
+
+/// @brief Gaussian policy whose samples are squashed by a tanh and scaled to
+/// [-action_scale, action_scale], as used by SAC. The MLP outputs both the means
+/// and the (clamped) log std of the pre-squash gaussian
+class SquashedGaussianActorImpl : public torch::nn::Module
+{
+public:
+    SquashedGaussianActorImpl(const int64_t obs_dim, const int64_t action_dim_, const float action_scale_ = 1.0f);
+    ~SquashedGaussianActorImpl();
+
+    /// @brief Sample actions with the reparameterization trick, so gradients flow through them
+    /// @param observations Observations
+    /// @param deterministic Whether to sample or use the squashed means
+    /// @return A pair <actions, log probabilities of the squashed actions>
+    std::pair<torch::Tensor, torch::Tensor> forward(const torch::Tensor& observations, const bool deterministic = false);
+
+    const MLP& GetNet() const;
+    float GetActionScale() const;
+
+private:
+    MLP net{ nullptr };
+    int64_t action_dim;
+    float action_scale;
+};
+TORCH_MODULE(SquashedGaussianActor);
+
+/// @brief Two independent Q(obs, action) MLPs, the minimum of both is used to reduce overestimation
+class TwinQNetworkImpl : public torch::nn::Module
+{
+public:
+    TwinQNetworkImpl(const int64_t obs_dim, const int64_t action_dim);
+    ~TwinQNetworkImpl();
+
+    /// @return A pair <Q1, Q2> of {N, 1} values
+    std::pair<torch::Tensor, torch::Tensor> forward(const torch::Tensor& observations, const torch::Tensor& actions);
+
+private:
+    MLP q1{ nullptr };
+    MLP q2{ nullptr };
+};
+TORCH_MODULE(TwinQNetwork);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include "torch/torch.h"
+
+/// @brief Blocking client of an InferenceServer, sending one observation at a
+/// time. Can be used from another process or as a loopback client in the server
+/// one. Not thread-safe, each thread should have its own client. Only available on Linux
+class InferenceClient
+{
+public:
+    /// @param socket_path Path of the socket the server listens on
+    InferenceClient(const std::string& socket_path);
+    ~InferenceClient();
+
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    int64_t GetObservationSize() const;
+    int64_t GetActionSize() const;
+
+    /// @brief Send an observation and wait for the action
+    /// @param obs GetObservationSize() floats
+    /// @param action GetActionSize() floats written by the server answer
+    void Act(const float* obs, float* action);
+
+    /// @brief Same as Act with tensors
+    /// @param obs {GetObservationSize()} observation
+    /// @return {GetActionSize()} action
+    torch::Tensor Act(const torch::Tensor& obs);
+
+private:
+    int fd;
+    int64_t obs_size;
+    int64_t action_size;
+};
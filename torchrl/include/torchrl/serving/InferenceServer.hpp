@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "torchrl/rl/Policy.hpp"
+
+/// @brief Latency and batching statistics of an InferenceServer
+struct InferenceServerStats
+{
+    uint64_t num_requests = 0;
+    uint64_t num_batches = 0;
+    /// @brief Percentiles of the time between the reception of a request and its answer, in microseconds,
+    /// read from a fixed size histogram with a relative error below 3%
+    float latency_p50_us = 0.0f;
+    float latency_p99_us = 0.0f;
+    /// @brief Number of batches of each size (index 0 is unused)
+    std::vector<uint64_t> batch_size_histogram;
+};
+
+/// @brief Serve a policy to clients in other processes (or threads) through a Unix
+/// domain socket. Observations sent by all the clients are queued and run in dynamic
+/// batches: a batch is run as soon as it's full or its oldest request has waited for
+/// the latency budget, so many clients don't each pay the cost of a batch of 1.
+///
+/// Protocol (native endianness): on connection, the server sends the observation
+/// and action sizes as two uint32. Then each request is one observation (obs_size
+/// floats, as seen by the policy, i.e. normalized if the env was) and is answered
+/// with one action (action_size floats). A client must wait for the answer before
+/// sending its next request, see InferenceClient. Only available on Linux
+class InferenceServer
+{
+public:
+    /// @param policy_ Policy to serve, only used by the server thread once started
+    /// @param socket_path_ Path of the socket the clients connect to, replaced if it exists
+    /// @param max_batch_size_ A batch is run as soon as it has this number of requests...
+    /// @param max_wait_us_ ... or when its oldest request has waited this long
+    /// @param deterministic_ Whether to answer with the mean actions or to sample them
+    InferenceServer(Policy policy_, const std::string& socket_path_,
+        const int64_t max_batch_size_ = 64, const int64_t max_wait_us_ = 200,
+        const bool deterministic_ = true);
+    ~InferenceServer();
+
+    /// @brief Open the socket and start serving on a new thread
+    void Start();
+    /// @brief Stop serving and close all connections, pending requests are dropped
+    void Stop();
+
+    int64_t GetObservationSize() const;
+    int64_t GetActionSize() const;
+
+    /// @brief Get the statistics of the requests answered since the start or the last ResetStats
+    InferenceServerStats GetStats() const;
+    void ResetStats();
+
+private:
+    struct Client
+    {
+        /// @brief Observation being received
+        std::vector<float> obs;
+        size_t received_bytes = 0;
+        /// @brief True if the observation is complete and waits in the current batch
+        bool pending = false;
+    };
+
+    /// @brief Server thread loop
+    void Run();
+    /// @brief Accept all the waiting connections
+    void Accept();
+    /// @brief Read what's available from a client, adding its request to the batch once complete
+    /// @return false if the client disconnected or has to be dropped
+    bool Receive(const int fd, Client& client);
+    /// @brief Run the policy on the current batch and answer all its requests
+    void RunBatch();
+    void CloseClient(const int fd);
+
+private:
+    Policy policy;
+    std::string socket_path;
+    int64_t max_batch_size;
+    int64_t max_wait_us;
+    bool deterministic;
+    int64_t obs_size;
+    int64_t action_size;
+
+    std::thread thread;
+    std::atomic<bool> running;
+    int listen_fd;
+    /// @brief Written to by Stop to wake the server thread up
+    int wake_pipe[2];
+
+    std::map<int, Client> clients;
+    /// @brief Client, reception time and observation of each request of the current batch
+    std::vector<int> batch_fds;
+    std::vector<std::chrono::steady_clock::time_point> batch_times;
+    std::vector<float> batch_obs;
+    std::vector<float> batch_latencies_us;
+    /// @brief Offset of the first client read after each poll, rotated for fairness
+    size_t receive_start;
+
+    mutable std::mutex stats_mutex;
+    /// @brief Number of requests for each latency bucket, see LatencyBucket
+    std::vector<uint64_t> latency_histogram;
+    std::vector<uint64_t> batch_size_histogram;
+    uint64_t num_requests;
+    uint64_t num_batches;
+};
@@ -11,6 +11,8 @@ struct Args
     unsigned int seed = std::random_device()();
     /// @brief number of parallel environment collecting data
     uint64_t n_envs = 4;
+    /// @brief number of threads used to step the environments (1 to step them serially)
+    int n_env_threads = 1;
     /// @brief path to save (resp. load) model weights after (resp. before) training (resp. inference) 
     std::string exp_path = "exp";
     /// @brief whether or not the env observations should be normalized
@@ -26,6 +28,7 @@ struct Args
             << "\t-h, --help\tShow this help message\n"
             << "\t--seed\tRandom seed for envs and libtorch, default: random\n"
             << "\t--n_envs\tNumber of identical environments in the vectorized env, default: 4\n"
+            << "\t--n_env_threads\tNumber of threads used to step the environments (1 to step them serially), default: 1\n"
             << "\t--exp_path\tPath to save (resp. load) model weights after (resp. before) training (resp. inference), default: \"exp\"\n"
             << "\t--normalize_env_obs\tWhether or not the env observations should be normalized default: 0\n"
             << "\t--normalize_env_reward\tWhether or not the env rewards should be normalized default: 0\n";
@@ -66,6 +69,18 @@ struct Args
                     return;
                 }
             }
+            else if (arg == "--n_env_threads")
+            {
+                if (i + 1 < argc)
+                {
+                    n_env_threads = std::stoi(argv[++i]);
+                }
+                else
+                {
+                    std::cerr << "--n_env_threads requires an argument" << std::endl;
+                    return;
+                }
+            }
             else if (arg == "--exp_path")
             {
                 if (i + 1 < argc)
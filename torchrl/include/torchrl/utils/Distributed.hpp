@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "torch/torch.h"
+
+class RunningMeanStd;
+
+/// @brief Group of local processes training together, communicating
+/// with c10d gloo backend (CPU only, no network needed). Processes find
+/// each other through a file they all have access to. Only available
+/// if compiled with TORCHRL_DISTRIBUTED, otherwise only a group of one
+/// process can be created
+class Distributed
+{
+public:
+    /// @brief Join the group, blocks until all the processes have joined
+    /// @param rank_ Rank of this process, in [0, world_size_)
+    /// @param world_size_ Number of processes in the group
+    /// @param store_path File used by the processes to find each other, must be the same for all of them and not exist before the first process starts
+    Distributed(const int rank_, const int world_size_, const std::string& store_path);
+    ~Distributed();
+
+    int GetRank() const;
+    int GetWorldSize() const;
+
+    /// @brief Sum tensors across all the processes, in place
+    /// @param tensors Contiguous CPU tensors, same shapes on all processes
+    void AllReduceSum(std::vector<torch::Tensor>& tensors) const;
+
+    /// @brief Copy tensors of process root to all the other processes, in place
+    /// @param tensors Contiguous CPU tensors, same shapes on all processes
+    /// @param root Rank of the process sending its tensors
+    void Broadcast(std::vector<torch::Tensor>& tensors, const int root = 0) const;
+
+    /// @brief Average the gradients of some parameters across all the processes with a single
+    /// all-reduce. Parameters without gradients must be the same on all processes
+    /// @param parameters Parameters of a model, usually module->parameters()
+    void AverageGradients(const std::vector<torch::Tensor>& parameters) const;
+
+    /// @brief Copy the values of some parameters of process root to all the other processes
+    void BroadcastParameters(const std::vector<torch::Tensor>& parameters, const int root = 0) const;
+
+    /// @brief Combine statistics updated independently by each process since the last
+    /// synchronization, so all processes end up with the statistics of all the samples
+    /// seen by any of them
+    /// @param rms Statistics to synchronize, same shape on all processes
+    /// @param last_synced State of rms after the previous call, updated. If undefined, all
+    /// the current samples are considered new (rms should then start from the same state on
+    /// all processes, e.g. just constructed)
+    void SyncRunningMeanStd(RunningMeanStd& rms, torch::Tensor& last_synced) const;
+
+private:
+    int rank;
+    int world_size;
+
+    /// @brief Holds the gloo process group, defined even without WITH_DISTRIBUTED so .hpp is always the same
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
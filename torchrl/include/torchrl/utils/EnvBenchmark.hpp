@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "torch/torch.h"
+
+#include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/utils/SIMD.hpp"
+
+/// @brief Env steps/s benchmark of a BatchedAbstractEnv against the
+/// scalar AbstractEnv it vectorizes, shared by the examples
+namespace env_benchmark
+{
+    /// @brief Set the state of env i of a batched env from an obs of its scalar version
+    template<class BatchedEnv>
+    using SetStateFunction = std::function<void(BatchedEnv&, const int64_t, const float*)>;
+
+    /// @brief Check that BatchedEnv gives the same results as Env. The batched envs are
+    /// synchronized with the scalar ones before each step, so float differences don't
+    /// accumulate (e.g. in chaotic dynamics) and change the terminal steps
+    /// @param name Name of Env in the output
+    /// @param max_action Actions are sampled in [-max_action, max_action]
+    /// @param set_state Function synchronizing a batched env with an obs of the scalar one
+    /// @return true if all the results are within tolerance
+    template<class Env, class BatchedEnv>
+    bool CheckAccuracy(const std::string& name, const int64_t N, const int num_steps, const unsigned int seed,
+        const float max_action, const SetStateFunction<BatchedEnv>& set_state)
+    {
+        std::vector<std::unique_ptr<Env>> envs;
+        for (int64_t i = 0; i < N; ++i)
+        {
+            envs.push_back(std::make_unique<Env>(seed + i));
+        }
+        BatchedEnv batched_env(N, seed);
+        const int64_t obs_size = batched_env.GetObservationSize();
+        const int64_t act_size = batched_env.GetActionSize();
+
+        std::vector<float> obs(N * obs_size);
+        std::vector<float> batched_obs(N * obs_size);
+        std::vector<float> batched_new_obs(N * obs_size);
+        std::vector<float> batched_rewards(N);
+        std::vector<uint8_t> batched_terminals(N);
+        std::vector<float> batched_tot_rewards(N);
+        std::vector<uint64_t> batched_tot_steps(N);
+        std::vector<float> actions(N * act_size);
+
+        // Same seeds, initial states should be the same
+        float max_obs_diff = 0.0f;
+        float max_reward_diff = 0.0f;
+        int64_t terminal_mismatches = 0;
+        batched_env.Reset(batched_obs.data());
+        for (int64_t i = 0; i < N; ++i)
+        {
+            envs[i]->Reset(obs.data() + i * obs_size);
+        }
+        for (int64_t k = 0; k < N * obs_size; ++k)
+        {
+            max_obs_diff = std::max(max_obs_diff, std::abs(obs[k] - batched_obs[k]));
+        }
+
+        std::mt19937 random_engine(seed);
+        std::uniform_real_distribution<float> action_distribution(-max_action, max_action);
+        std::vector<float> env_obs(obs_size);
+        std::vector<float> env_new_obs(obs_size);
+        for (int s = 0; s < num_steps; ++s)
+        {
+            for (int64_t i = 0; i < N; ++i)
+            {
+                set_state(batched_env, i, obs.data() + i * obs_size);
+                for (int64_t k = 0; k < act_size; ++k)
+                {
+                    actions[i * act_size + k] = action_distribution(random_engine);
+                }
+            }
+
+            batched_env.Step(actions.data(), batched_obs.data(), batched_rewards.data(), batched_terminals.data(),
+                batched_new_obs.data(), batched_tot_rewards.data(), batched_tot_steps.data());
+
+            for (int64_t i = 0; i < N; ++i)
+            {
+                const StepResult res = envs[i]->Step(actions.data() + i * act_size, env_obs.data(), env_new_obs.data());
+                for (int64_t k = 0; k < obs_size; ++k)
+                {
+                    max_obs_diff = std::max(max_obs_diff, std::abs(env_obs[k] - batched_obs[i * obs_size + k]));
+                }
+                max_reward_diff = std::max(max_reward_diff, std::abs(res.reward - batched_rewards[i]));
+                terminal_mismatches += static_cast<uint8_t>(res.terminal_state) != batched_terminals[i];
+
+                const std::vector<float>& next_obs = res.terminal_state == TerminalState::NotTerminal ? env_obs : env_new_obs;
+                std::copy(next_obs.begin(), next_obs.end(), obs.data() + i * obs_size);
+            }
+        }
+
+        const bool ok = max_obs_diff < 1e-4f && max_reward_diff < 1e-3f && terminal_mismatches == 0;
+        std::cout << "Accuracy vs " << name << " (" << N << " envs, " << num_steps << " steps): "
+            << "max obs diff " << max_obs_diff << ", max reward diff " << max_reward_diff
+            << ", terminal mismatches " << terminal_mismatches
+            << (ok ? " [OK]" : " [FAILED]") << std::endl;
+
+        return ok;
+    }
+
+    /// @brief Run f num_steps times and print the number of env steps per second
+    template<class F>
+    void Benchmark(const std::string& name, const int64_t N, const int num_steps, F f)
+    {
+        // Warmup
+        f();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int s = 0; s < num_steps; ++s)
+        {
+            f();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::setw(50) << std::left << name
+            << std::setw(15) << std::right << std::fixed << std::setprecision(0) << N * num_steps / seconds
+            << " env steps/s" << std::endl;
+    }
+
+    /// @brief Check BatchedEnv against Env, then measure the env steps/s of Env and BatchedEnv
+    /// in a VectorizedEnv and of BatchedEnv on raw arrays, single threaded.
+    /// Command line arguments are the number of envs and of steps
+    /// @param env_name Name of Env in the output
+    /// @param batched_env_name Name of BatchedEnv in the output
+    /// @param max_action Benchmark actions are sampled in [-max_action, max_action]
+    /// @param check_max_action Range of the actions of the accuracy check, bigger than
+    /// max_action to check the clamping
+    /// @param set_state Function synchronizing a batched env with an obs of the scalar one
+    /// @return The exit code of the benchmark, 0 if the accuracy check passed
+    template<class Env, class BatchedEnv>
+    int Run(int argc, char* argv[], const std::string& env_name, const std::string& batched_env_name,
+        const float max_action, const float check_max_action, const SetStateFunction<BatchedEnv>& set_state)
+    {
+        try
+        {
+            const int64_t N = argc > 1 ? std::stoll(argv[1]) : 1024;
+            const int num_steps = argc > 2 ? std::stoi(argv[2]) : 1000;
+            const unsigned int seed = 12345;
+
+            torch::manual_seed(seed);
+            // Single threaded, to get the throughput per core
+            torch::set_num_threads(1);
+
+            std::cout << "SIMD instruction set: " << simd::GetInstructionSet() << std::endl;
+
+            const bool ok = CheckAccuracy<Env, BatchedEnv>(env_name, std::min<int64_t>(N, 256), 1000, seed, check_max_action, set_state);
+
+            VectorizedEnv env(false, false);
+            env.SetReuseBuffers(true);
+            env.CreateEnvs<Env>(N, seed);
+            env.Reset();
+            const torch::Tensor actions = (torch::rand({ N, env.GetActionSize() }) * 2.0f - 1.0f) * max_action;
+            Benchmark("VectorizedEnv<" + env_name + ">", N, num_steps, [&]() { env.Step(actions); });
+
+            VectorizedEnv batched_vec_env(false, false);
+            batched_vec_env.SetReuseBuffers(true);
+            batched_vec_env.CreateEnvs<BatchedEnv>(N, seed);
+            batched_vec_env.Reset();
+            Benchmark("VectorizedEnv<" + batched_env_name + ">", N, num_steps, [&]() { batched_vec_env.Step(actions); });
+
+            BatchedEnv batched_env(N, seed);
+            const int64_t obs_size = batched_env.GetObservationSize();
+            std::vector<float> obs(N * obs_size);
+            std::vector<float> new_obs(N * obs_size);
+            std::vector<float> rewards(N);
+            std::vector<uint8_t> terminals(N);
+            std::vector<float> tot_rewards(N);
+            std::vector<uint64_t> tot_steps(N);
+            batched_env.Reset(obs.data());
+            const float* actions_data = actions.data_ptr<float>();
+            Benchmark(batched_env_name + " (raw arrays)", N, num_steps, [&]()
+                {
+                    batched_env.Step(actions_data, obs.data(), rewards.data(), terminals.data(), new_obs.data(), tot_rewards.data(), tot_steps.data());
+                }
+            );
+
+            return ok ? 0 : 1;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+
+        return 1;
+    }
+}
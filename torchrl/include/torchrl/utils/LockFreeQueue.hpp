@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+/// @brief Bounded multi-producer multi-consumer queue that never takes
+/// a lock (Dmitry Vyukov's algorithm). Each cell has a sequence number
+/// telling whether it's ready to be written or read for a given position,
+/// so producers and consumers only contend on one atomic increment
+template<class T>
+class LockFreeQueue
+{
+public:
+    /// @param capacity Max number of elements in the queue, rounded up to a power of 2
+    LockFreeQueue(const size_t capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::runtime_error("LockFreeQueue capacity must be positive");
+        }
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        mask = size - 1;
+        cells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    ~LockFreeQueue()
+    {
+
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    /// @brief Get the max number of elements in the queue
+    size_t GetCapacity() const
+    {
+        return mask + 1;
+    }
+
+    /// @brief Try to add an element at the end of the queue
+    /// @param value Element to add, only moved from if the push succeeds
+    /// @return False if the queue is full
+    bool TryPush(T& value)
+    {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = cells[pos & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            // This cell has not been read yet since the last lap
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Try to get the element at the front of the queue
+    /// @param value Output element
+    /// @return False if the queue is empty
+    bool TryPop(T& value)
+    {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = cells[pos & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            // This cell has not been written yet
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    /// @brief On separate cache lines so producers and consumers don't false share
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+};
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define TORCHRL_SIMD_WIDTH 16
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define TORCHRL_SIMD_WIDTH 8
+#else
+#define TORCHRL_SIMD_WIDTH 1
+#endif
+
+/// @brief Minimal set of SIMD float operations, using AVX-512 or AVX2+FMA
+/// if enabled at compile time (see TORCHRL_NATIVE_ARCH cmake option).
+/// All functions are also available on scalar floats with the same
+/// algorithms, so kernels can be written once as templates and used
+/// for full vectors and remaining scalar elements
+namespace simd
+{
+    /// @brief Number of floats in a vector
+    constexpr int width = TORCHRL_SIMD_WIDTH;
+
+#if TORCHRL_SIMD_WIDTH == 16
+    using vfloat = __m512;
+    using vmask = __mmask16;
+    inline const char* GetInstructionSet() { return "AVX-512"; }
+#elif TORCHRL_SIMD_WIDTH == 8
+    using vfloat = __m256;
+    using vmask = __m256;
+    inline const char* GetInstructionSet() { return "AVX2"; }
+#else
+    using vfloat = float;
+    using vmask = bool;
+    inline const char* GetInstructionSet() { return "Scalar"; }
+#endif
+
+    // Cephes sinf/cosf constants, three parts Cody-Waite reduction by pi/4
+    constexpr float four_over_pi = 1.27323954473516f;
+    constexpr float dp1 = 0.78515625f;
+    constexpr float dp2 = 2.4187564849853515625e-4f;
+    constexpr float dp3 = 3.77489497744594108e-8f;
+    constexpr float sin_c0 = -1.9515295891e-4f;
+    constexpr float sin_c1 = 8.3321608736e-3f;
+    constexpr float sin_c2 = -1.6666654611e-1f;
+    constexpr float cos_c0 = 2.443315711809948e-5f;
+    constexpr float cos_c1 = -1.388731625493765e-3f;
+    constexpr float cos_c2 = 4.166664568298827e-2f;
+
+    // Cephes expf/logf/tanhf constants
+    constexpr float log2e = 1.44269504088896341f;
+    constexpr float ln2_hi = 0.693359375f;
+    constexpr float ln2_lo = -2.12194440e-4f;
+    constexpr float exp_min = -87.0f;
+    constexpr float exp_max = 88.0f;
+    constexpr float exp_c0 = 1.9875691500e-4f;
+    constexpr float exp_c1 = 1.3981999507e-3f;
+    constexpr float exp_c2 = 8.3334519073e-3f;
+    constexpr float exp_c3 = 4.1665795894e-2f;
+    constexpr float exp_c4 = 1.6666665459e-1f;
+    constexpr float exp_c5 = 5.0000001201e-1f;
+    constexpr float sqrt_half = 0.707106781186547524f;
+    constexpr float log_c0 = 7.0376836292e-2f;
+    constexpr float log_c1 = -1.1514610310e-1f;
+    constexpr float log_c2 = 1.1676998740e-1f;
+    constexpr float log_c3 = -1.2420140846e-1f;
+    constexpr float log_c4 = 1.4249322787e-1f;
+    constexpr float log_c5 = -1.6668057665e-1f;
+    constexpr float log_c6 = 2.0000714765e-1f;
+    constexpr float log_c7 = -2.4999993993e-1f;
+    constexpr float log_c8 = 3.3333331174e-1f;
+    constexpr float tanh_small = 0.625f;
+    constexpr float tanh_c0 = -5.70498872745e-3f;
+    constexpr float tanh_c1 = 2.06390887954e-2f;
+    constexpr float tanh_c2 = -5.37397155531e-2f;
+    constexpr float tanh_c3 = 1.33314422036e-1f;
+    constexpr float tanh_c4 = -3.33332819422e-1f;
+
+    template<class T> T Load(const float* p);
+    template<class T> T Set1(const float f);
+
+    //////////////////////////////////////////////
+    /////////////////// Scalar ///////////////////
+    //////////////////////////////////////////////
+    template<> inline float Load<float>(const float* p) { return *p; }
+    template<> inline float Set1<float>(const float f) { return f; }
+    inline void Store(float* p, const float v) { *p = v; }
+    inline float Add(const float a, const float b) { return a + b; }
+    inline float Sub(const float a, const float b) { return a - b; }
+    inline float Mul(const float a, const float b) { return a * b; }
+    inline float Div(const float a, const float b) { return a / b; }
+    /// @brief a * b + c
+    inline float Fma(const float a, const float b, const float c) { return a * b + c; }
+    inline float Min(const float a, const float b) { return a < b ? a : b; }
+    inline float Max(const float a, const float b) { return a > b ? a : b; }
+    inline float Clamp(const float x, const float lo, const float hi) { return Min(hi, Max(lo, x)); }
+    inline float Abs(const float x) { return std::abs(x); }
+    /// @brief Round to nearest, ties to even
+    inline float Round(const float x) { return std::nearbyint(x); }
+    inline bool Less(const float a, const float b) { return a < b; }
+    inline bool LessEqual(const float a, const float b) { return a <= b; }
+    inline bool And(const bool a, const bool b) { return a && b; }
+    /// @brief m ? a : b
+    inline float Select(const bool m, const float a, const float b) { return m ? a : b; }
+    inline float Sqrt(const float x) { return std::sqrt(x); }
+    /// @brief 2^n for an integer valued n in [-126, 127]
+    inline float Pow2i(const float n)
+    {
+        const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+        float out;
+        std::memcpy(&out, &bits, sizeof(float));
+        return out;
+    }
+    /// @brief Split a positive normal x into m * 2^e with m in [0.5, 1)
+    inline float Frexp(const float x, float& e)
+    {
+        int32_t bits;
+        std::memcpy(&bits, &x, sizeof(float));
+        e = static_cast<float>((bits >> 23) - 126);
+        bits = (bits & 0x807fffff) | 0x3f000000;
+        float m;
+        std::memcpy(&m, &bits, sizeof(float));
+        return m;
+    }
+
+    /// @brief Compute both sin(x) and cos(x), accurate for |x| < 8192
+    inline void SinCos(const float x, float& s, float& c)
+    {
+        const float ax = std::abs(x);
+        // Even multiple of pi/4 closest to x, as cephes does
+        int32_t j = static_cast<int32_t>(ax * four_over_pi);
+        j = (j + 1) & ~1;
+        const float y = static_cast<float>(j);
+        const float r = ((ax - y * dp1) - y * dp2) - y * dp3;
+        const float z = r * r;
+
+        const float ps = ((sin_c0 * z + sin_c1) * z + sin_c2) * z * r + r;
+        const float pc = ((cos_c0 * z + cos_c1) * z + cos_c2) * z * z - 0.5f * z + 1.0f;
+
+        const bool swap = (j & 2) != 0;
+        const float sr = swap ? pc : ps;
+        const float cr = swap ? ps : pc;
+
+        s = ((j & 4) != 0) != (x < 0.0f) ? -sr : sr;
+        c = ((j + 2) & 4) != 0 ? -cr : cr;
+    }
+
+#if TORCHRL_SIMD_WIDTH == 16
+    //////////////////////////////////////////////
+    ////////////////// AVX-512 ///////////////////
+    //////////////////////////////////////////////
+    template<> inline __m512 Load<__m512>(const float* p) { return _mm512_loadu_ps(p); }
+    template<> inline __m512 Set1<__m512>(const float f) { return _mm512_set1_ps(f); }
+    inline void Store(float* p, const __m512 v) { _mm512_storeu_ps(p, v); }
+    inline __m512 Add(const __m512 a, const __m512 b) { return _mm512_add_ps(a, b); }
+    inline __m512 Sub(const __m512 a, const __m512 b) { return _mm512_sub_ps(a, b); }
+    inline __m512 Mul(const __m512 a, const __m512 b) { return _mm512_mul_ps(a, b); }
+    inline __m512 Div(const __m512 a, const __m512 b) { return _mm512_div_ps(a, b); }
+    inline __m512 Fma(const __m512 a, const __m512 b, const __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+    inline __m512 Min(const __m512 a, const __m512 b) { return _mm512_min_ps(a, b); }
+    inline __m512 Max(const __m512 a, const __m512 b) { return _mm512_max_ps(a, b); }
+    inline __m512 Clamp(const __m512 x, const __m512 lo, const __m512 hi) { return Min(hi, Max(lo, x)); }
+    inline __m512 Abs(const __m512 x) { return _mm512_abs_ps(x); }
+    inline __m512 Round(const __m512 x) { return _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    inline __mmask16 Less(const __m512 a, const __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    inline __mmask16 LessEqual(const __m512 a, const __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    inline __mmask16 And(const __mmask16 a, const __mmask16 b) { return static_cast<__mmask16>(a & b); }
+    inline __m512 Select(const __mmask16 m, const __m512 a, const __m512 b) { return _mm512_mask_blend_ps(m, b, a); }
+    inline __m512 Sqrt(const __m512 x) { return _mm512_sqrt_ps(x); }
+    inline __m512 Pow2i(const __m512 n) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23)); }
+    inline __m512 Frexp(const __m512 x, __m512& e)
+    {
+        const __m512i bits = _mm512_castps_si512(x);
+        e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+        return _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)), _mm512_set1_epi32(0x3f000000)));
+    }
+
+    inline void SinCos(const __m512 x, __m512& s, __m512& c)
+    {
+        const __m512i sign_mask = _mm512_set1_epi32(0x80000000);
+        const __m512i sin_sign = _mm512_and_si512(_mm512_castps_si512(x), sign_mask);
+        __m512 r = _mm512_abs_ps(x);
+
+        __m512i j = _mm512_cvttps_epi32(_mm512_mul_ps(r, _mm512_set1_ps(four_over_pi)));
+        j = _mm512_and_si512(_mm512_add_epi32(j, _mm512_set1_epi32(1)), _mm512_set1_epi32(~1));
+        const __m512 y = _mm512_cvtepi32_ps(j);
+        r = _mm512_fnmadd_ps(y, _mm512_set1_ps(dp1), r);
+        r = _mm512_fnmadd_ps(y, _mm512_set1_ps(dp2), r);
+        r = _mm512_fnmadd_ps(y, _mm512_set1_ps(dp3), r);
+        const __m512 z = _mm512_mul_ps(r, r);
+
+        __m512 ps = _mm512_fmadd_ps(_mm512_set1_ps(sin_c0), z, _mm512_set1_ps(sin_c1));
+        ps = _mm512_fmadd_ps(ps, z, _mm512_set1_ps(sin_c2));
+        ps = _mm512_fmadd_ps(_mm512_mul_ps(ps, z), r, r);
+
+        __m512 pc = _mm512_fmadd_ps(_mm512_set1_ps(cos_c0), z, _mm512_set1_ps(cos_c1));
+        pc = _mm512_fmadd_ps(pc, z, _mm512_set1_ps(cos_c2));
+        pc = _mm512_fmadd_ps(_mm512_mul_ps(pc, z), z, _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), z, _mm512_set1_ps(1.0f)));
+
+        const __mmask16 swap = _mm512_test_epi32_mask(j, _mm512_set1_epi32(2));
+        const __m512 sr = _mm512_mask_blend_ps(swap, ps, pc);
+        const __m512 cr = _mm512_mask_blend_ps(swap, pc, ps);
+
+        // Move bit 2 of the quadrant to the sign bit
+        const __m512i s_flip = _mm512_xor_si512(_mm512_slli_epi32(_mm512_and_si512(j, _mm512_set1_epi32(4)), 29), sin_sign);
+        const __m512i c_flip = _mm512_slli_epi32(_mm512_and_si512(_mm512_add_epi32(j, _mm512_set1_epi32(2)), _mm512_set1_epi32(4)), 29);
+        s = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(sr), s_flip));
+        c = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(cr), c_flip));
+    }
+#elif TORCHRL_SIMD_WIDTH == 8
+    //////////////////////////////////////////////
+    /////////////////// AVX2 /////////////////////
+    //////////////////////////////////////////////
+    template<> inline __m256 Load<__m256>(const float* p) { return _mm256_loadu_ps(p); }
+    template<> inline __m256 Set1<__m256>(const float f) { return _mm256_set1_ps(f); }
+    inline void Store(float* p, const __m256 v) { _mm256_storeu_ps(p, v); }
+    inline __m256 Add(const __m256 a, const __m256 b) { return _mm256_add_ps(a, b); }
+    inline __m256 Sub(const __m256 a, const __m256 b) { return _mm256_sub_ps(a, b); }
+    inline __m256 Mul(const __m256 a, const __m256 b) { return _mm256_mul_ps(a, b); }
+    inline __m256 Div(const __m256 a, const __m256 b) { return _mm256_div_ps(a, b); }
+    inline __m256 Fma(const __m256 a, const __m256 b, const __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    inline __m256 Min(const __m256 a, const __m256 b) { return _mm256_min_ps(a, b); }
+    inline __m256 Max(const __m256 a, const __m256 b) { return _mm256_max_ps(a, b); }
+    inline __m256 Clamp(const __m256 x, const __m256 lo, const __m256 hi) { return Min(hi, Max(lo, x)); }
+    inline __m256 Abs(const __m256 x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+    inline __m256 Round(const __m256 x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    inline __m256 Less(const __m256 a, const __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline __m256 LessEqual(const __m256 a, const __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    inline __m256 And(const __m256 a, const __m256 b) { return _mm256_and_ps(a, b); }
+    inline __m256 Select(const __m256 m, const __m256 a, const __m256 b) { return _mm256_blendv_ps(b, a, m); }
+    inline __m256 Sqrt(const __m256 x) { return _mm256_sqrt_ps(x); }
+    inline __m256 Pow2i(const __m256 n) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23)); }
+    inline __m256 Frexp(const __m256 x, __m256& e)
+    {
+        const __m256i bits = _mm256_castps_si256(x);
+        e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+        return _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)), _mm256_set1_epi32(0x3f000000)));
+    }
+
+    inline void SinCos(const __m256 x, __m256& s, __m256& c)
+    {
+        const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+        const __m256 sin_sign = _mm256_and_ps(x, sign_mask);
+        __m256 r = _mm256_andnot_ps(sign_mask, x);
+
+        __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(r, _mm256_set1_ps(four_over_pi)));
+        j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+        const __m256 y = _mm256_cvtepi32_ps(j);
+        r = _mm256_fnmadd_ps(y, _mm256_set1_ps(dp1), r);
+        r = _mm256_fnmadd_ps(y, _mm256_set1_ps(dp2), r);
+        r = _mm256_fnmadd_ps(y, _mm256_set1_ps(dp3), r);
+        const __m256 z = _mm256_mul_ps(r, r);
+
+        __m256 ps = _mm256_fmadd_ps(_mm256_set1_ps(sin_c0), z, _mm256_set1_ps(sin_c1));
+        ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(sin_c2));
+        ps = _mm256_fmadd_ps(_mm256_mul_ps(ps, z), r, r);
+
+        __m256 pc = _mm256_fmadd_ps(_mm256_set1_ps(cos_c0), z, _mm256_set1_ps(cos_c1));
+        pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(cos_c2));
+        pc = _mm256_fmadd_ps(_mm256_mul_ps(pc, z), z, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_set1_ps(1.0f)));
+
+        const __m256i two = _mm256_set1_epi32(2);
+        const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, two), two));
+        const __m256 sr = _mm256_blendv_ps(ps, pc, swap);
+        const __m256 cr = _mm256_blendv_ps(pc, ps, swap);
+
+        // Move bit 2 of the quadrant to the sign bit
+        const __m256 s_flip = _mm256_xor_ps(_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)), sin_sign);
+        const __m256 c_flip = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(j, two), _mm256_set1_epi32(4)), 29));
+        s = _mm256_xor_ps(sr, s_flip);
+        c = _mm256_xor_ps(cr, c_flip);
+    }
+#endif
+
+    template<class T>
+    inline T Sin(const T x)
+    {
+        T s, c;
+        SinCos(x, s, c);
+        return s;
+    }
+
+    template<class T>
+    inline T Cos(const T x)
+    {
+        T s, c;
+        SinCos(x, s, c);
+        return c;
+    }
+
+    /// @brief exp(x), x is clamped to [-87, 88] so the result is always a normal float
+    template<class T>
+    inline T Exp(T x)
+    {
+        x = Clamp(x, Set1<T>(exp_min), Set1<T>(exp_max));
+        // x = n * ln(2) + r, with |r| <= ln(2) / 2
+        const T n = Round(Mul(x, Set1<T>(log2e)));
+        T r = Sub(x, Mul(n, Set1<T>(ln2_hi)));
+        r = Sub(r, Mul(n, Set1<T>(ln2_lo)));
+        const T z = Mul(r, r);
+
+        T p = Fma(Set1<T>(exp_c0), r, Set1<T>(exp_c1));
+        p = Fma(p, r, Set1<T>(exp_c2));
+        p = Fma(p, r, Set1<T>(exp_c3));
+        p = Fma(p, r, Set1<T>(exp_c4));
+        p = Fma(p, r, Set1<T>(exp_c5));
+        p = Add(Fma(p, z, r), Set1<T>(1.0f));
+
+        return Mul(p, Pow2i(n));
+    }
+
+    /// @brief log(x) for positive normal x
+    template<class T>
+    inline T Log(const T x)
+    {
+        T e;
+        T m = Frexp(x, e);
+        // Bring m in [sqrt(0.5), sqrt(2)) and get m - 1
+        const auto small = Less(m, Set1<T>(sqrt_half));
+        e = Select(small, Sub(e, Set1<T>(1.0f)), e);
+        m = Sub(Select(small, Add(m, m), m), Set1<T>(1.0f));
+        const T z = Mul(m, m);
+
+        T p = Fma(Set1<T>(log_c0), m, Set1<T>(log_c1));
+        p = Fma(p, m, Set1<T>(log_c2));
+        p = Fma(p, m, Set1<T>(log_c3));
+        p = Fma(p, m, Set1<T>(log_c4));
+        p = Fma(p, m, Set1<T>(log_c5));
+        p = Fma(p, m, Set1<T>(log_c6));
+        p = Fma(p, m, Set1<T>(log_c7));
+        p = Fma(p, m, Set1<T>(log_c8));
+        T y = Mul(Mul(p, m), z);
+        y = Fma(e, Set1<T>(ln2_lo), y);
+        y = Fma(Set1<T>(-0.5f), z, y);
+
+        return Fma(e, Set1<T>(ln2_hi), Add(m, y));
+    }
+
+    /// @brief tanh(x), with a polynomial for small |x| and 1 - 2 / (exp(2|x|) + 1) otherwise
+    template<class T>
+    inline T Tanh(const T x)
+    {
+        const T ax = Abs(x);
+        const T z = Mul(x, x);
+
+        T p = Fma(Set1<T>(tanh_c0), z, Set1<T>(tanh_c1));
+        p = Fma(p, z, Set1<T>(tanh_c2));
+        p = Fma(p, z, Set1<T>(tanh_c3));
+        p = Fma(p, z, Set1<T>(tanh_c4));
+        const T small = Fma(Mul(p, z), x, x);
+
+        T large = Sub(Set1<T>(1.0f), Div(Set1<T>(2.0f), Add(Exp(Add(ax, ax)), Set1<T>(1.0f))));
+        large = Select(Less(x, Set1<T>(0.0f)), Sub(Set1<T>(0.0f), large), large);
+
+        return Select(Less(ax, Set1<T>(tanh_small)), small, large);
+    }
+
+    /// @brief Dot product of two int8 arrays, accumulated in int32
+    inline int32_t DotInt8(const int8_t* a, const int8_t* b, const int64_t n)
+    {
+        int64_t k = 0;
+        int32_t sum = 0;
+#if TORCHRL_SIMD_WIDTH > 1
+        // Widen 16 values to int16, then multiply and add pairs to 8 int32
+        __m256i acc = _mm256_setzero_si256();
+        for (; k + 16 <= n; k += 16)
+        {
+            const __m256i a16 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k)));
+            const __m256i b16 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a16, b16));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_cvtsi128_si32(s);
+#endif
+        for (; k < n; ++k)
+        {
+            sum += static_cast<int32_t>(a[k]) * static_cast<int32_t>(b[k]);
+        }
+        return sum;
+    }
+}
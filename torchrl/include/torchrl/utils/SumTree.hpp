@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/// @brief Sum and min segment trees over capacity non-negative priorities, stored
+/// as implicit binary heaps in two flat arrays (node k has children 2k and 2k+1,
+/// leaves start at the number of leaves rounded up to a power of two). No per node
+/// allocation, and batched operations walk all their queries level by level so the
+/// loads of independent queries overlap instead of chasing one path at a time.
+/// Not thread-safe, see PrioritizedReplayBuffer for a locked user
+class SumTree
+{
+public:
+    SumTree(const int64_t capacity_);
+    ~SumTree();
+
+    /// @brief Set the priorities of some leaves, duplicated indices keep the last value
+    /// @param indices n leaf indices in [0, capacity)
+    /// @param priorities n priorities >= 0
+    void Update(const int64_t* indices, const float* priorities, const int64_t n);
+
+    /// @brief For each value, find the leaf where the prefix sum of the priorities reaches it
+    /// @param values n values in [0, GetTotal())
+    /// @param indices_out n leaf indices, leaves with a priority of 0 are never returned if the total is > 0
+    void Find(const float* values, const int64_t n, int64_t* indices_out) const;
+
+    /// @brief Stratified sampling: split [0, GetTotal()) in n equal segments and sample
+    /// one leaf in each, proportionally to the priorities
+    /// @param indices_out n leaf indices
+    /// @param priorities_out If not nullptr, n priorities of the sampled leaves
+    void Sample(const int64_t n, std::mt19937& random_engine, int64_t* indices_out, float* priorities_out = nullptr) const;
+
+    float Get(const int64_t index) const;
+    /// @brief Sum of all the priorities
+    float GetTotal() const;
+    /// @brief Min of all the priorities > 0, +inf if there is none
+    float GetMin() const;
+    int64_t GetCapacity() const;
+
+    /// @brief Set all the priorities to 0
+    void Clear();
+
+private:
+    int64_t capacity;
+    /// @brief capacity rounded up to a power of two
+    int64_t num_leaves;
+    int depth;
+
+    /// @brief 2 * num_leaves nodes, index 0 is unused
+    std::vector<float> sums;
+    /// @brief Same as sums, with +inf for empty leaves
+    std::vector<float> mins;
+    /// @brief Sorted copy of the updated indices, reused between calls
+    std::vector<int64_t> sorted;
+};
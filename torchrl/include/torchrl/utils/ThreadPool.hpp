@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Persistent pool of worker threads. Threads are created
+/// once and then wait for tasks, so dispatching work to them is
+/// cheap enough to be done at every env step
+class ThreadPool
+{
+public:
+    /// @brief A group of submitted tasks that can be waited on
+    class TaskGroup
+    {
+    public:
+        TaskGroup();
+        ~TaskGroup();
+
+        /// @brief Block until all the tasks of this group are done
+        /// If one of them threw an exception, it is rethrown here
+        void Wait();
+
+    private:
+        friend class ThreadPool;
+        void Add();
+        void Done(const std::exception_ptr& exception);
+
+    private:
+        int64_t pending;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    /// @brief Create a pool of workers
+    /// @param num_threads Number of worker threads to create
+    ThreadPool(const int num_threads);
+    ~ThreadPool();
+
+    /// @brief Get the number of worker threads
+    /// @return The number of threads in the pool (not counting the caller one)
+    int GetNumThreads() const;
+
+    /// @brief Queue f(begin, end) to be run by one of the workers
+    /// @param f Function to call, must stay alive until the task is done
+    /// @param begin First argument of f
+    /// @param end Second argument of f
+    /// @param group Task group the task is added to
+    void Submit(const std::function<void(const int64_t, const int64_t)>& f,
+        const int64_t begin, const int64_t end, TaskGroup& group);
+
+    /// @brief Split [0, N) in contiguous shards and run f(begin, end) on each of them.
+    /// The calling thread processes the first shard and then blocks until all are done
+    /// @param N Size of the range to process
+    /// @param f Function to call on each shard
+    void ParallelFor(const int64_t N, const std::function<void(const int64_t, const int64_t)>& f);
+
+private:
+    struct Task
+    {
+        const std::function<void(const int64_t, const int64_t)>* f = nullptr;
+        int64_t begin = 0;
+        int64_t end = 0;
+        TaskGroup* group = nullptr;
+    };
+
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread> workers;
+
+    /// @brief Ring buffer of pending tasks, only grows
+    /// so submitting does not allocate in steady state
+    std::vector<Task> tasks;
+    size_t tasks_head;
+    size_t num_tasks;
+    bool stop;
+    std::mutex tasks_mutex;
+    std::condition_variable tasks_condition;
+};
@@ -0,0 +1,463 @@
+#include <filesystem>
+
+#include "torchrl/algorithms/impala/IMPALA.hpp"
+#include "torchrl/algorithms/impala/IMPALAArgs.hpp"
+#include "torchrl/algorithms/impala/VTrace.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/rl/ClipGradNorm.hpp"
+#include "torchrl/utils/Logger.hpp"
+#include "torchrl/utils/ThreadPool.hpp"
+
+IMPALA::IMPALA(const std::vector<VectorizedEnv*>& envs_, const IMPALAArgs& args_) : envs(envs_), args(args_), queue(args_.queue_capacity)
+{
+    if (envs.empty())
+    {
+        throw std::runtime_error("IMPALA needs at least one env");
+    }
+    for (const VectorizedEnv* e : envs)
+    {
+        if (e->GetNumEnvs() != envs[0]->GetNumEnvs() || e->GetObservationSize() != envs[0]->GetObservationSize() || e->GetActionSize() != envs[0]->GetActionSize())
+        {
+            throw std::runtime_error("All the envs of IMPALA must have the same dimensions");
+        }
+    }
+
+    policy = Policy(envs[0]->GetObservationSize(), envs[0]->GetActionSize(), args.ortho_init, args.init_sampling_log_std, args.fused_policy);
+    published_version = 0;
+    stop = false;
+}
+
+IMPALA::~IMPALA()
+{
+
+}
+
+void IMPALA::Learn(const uint64_t total_timesteps, const bool log_console, const bool draw_curves)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::path exp_path = args.exp_path;
+    if (!std::filesystem::exists(exp_path))
+    {
+        std::filesystem::create_directories(exp_path);
+    }
+
+    Logger logger((exp_path / "training_logs.csv").string(), log_console, draw_curves);
+
+    torch::optim::Adam optimizer(policy->parameters(), torch::optim::AdamOptions(args.lr));
+
+    // All the envs start from the statistics of the first one (e.g. loaded from a previous training)
+    shared_obs_rms = envs[0]->GetObsNormalizer();
+    shared_ret_rms = envs[0]->GetRewardNormalizer();
+    synced_obs_states = std::vector<torch::Tensor>(envs.size());
+    synced_ret_states = std::vector<torch::Tensor>(envs.size());
+    for (size_t i = 0; i < envs.size(); ++i)
+    {
+        envs[i]->GetObsNormalizer() = shared_obs_rms;
+        envs[i]->GetRewardNormalizer() = shared_ret_rms;
+        synced_obs_states[i] = shared_obs_rms.GetState();
+        synced_ret_states[i] = shared_ret_rms.GetState();
+        envs[i]->SetTraining(true);
+        envs[i]->Reset();
+    }
+
+    PublishWeights();
+    stop = false;
+    actor_exception = nullptr;
+
+    // Declared before the pool so the actors are joined first if the learner throws
+    ThreadPool::TaskGroup actors;
+    const std::function<void(const int64_t, const int64_t)> actor_task = [this](const int64_t i, const int64_t) { ActorLoop(i); };
+    ThreadPool actor_threads(envs.size());
+    for (size_t i = 0; i < envs.size(); ++i)
+    {
+        actor_threads.Submit(actor_task, i, i + 1, actors);
+    }
+
+    const int64_t T = args.unroll_length;
+    uint64_t timestep = 0;
+    uint64_t iteration = 0;
+    uint64_t next_log = args.log_interval;
+    std::vector<std::unique_ptr<TrajectorySegment>> batch;
+
+    // Accumulated on device until the next log, to avoid a sync per update
+    torch::Tensor policy_loss_sum = torch::zeros({});
+    torch::Tensor value_loss_sum = torch::zeros({});
+    torch::Tensor entropy_loss_sum = torch::zeros({});
+    uint64_t num_updates = 0;
+    float total_reward = 0.0f;
+    uint64_t total_steps = 0;
+    uint64_t total_episodes = 0;
+    batch.reserve(args.batch_size);
+
+    policy->train(true);
+    try
+    {
+        while (timestep < total_timesteps)
+        {
+            // Wait for enough segments, unless an actor failed
+            batch.clear();
+            while (batch.size() < args.batch_size && !stop)
+            {
+                std::unique_ptr<TrajectorySegment> segment;
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    queue_condition.wait(lock, [&] { return stop || queue.TryPop(segment); });
+                }
+                if (segment != nullptr)
+                {
+                    batch.push_back(std::move(segment));
+                    // Wake up the actors waiting for a free slot
+                    queue_condition.notify_all();
+                }
+            }
+            if (stop)
+            {
+                break;
+            }
+
+            // Stack all the segments envs together, {T(+1), B, ...}
+            std::vector<torch::Tensor> observations, actions, behaviour_log_probs, rewards, discounts;
+            for (const auto& s : batch)
+            {
+                observations.push_back(s->observations);
+                actions.push_back(s->actions);
+                behaviour_log_probs.push_back(s->behaviour_log_probs);
+                rewards.push_back(s->rewards);
+                discounts.push_back(s->discounts);
+                total_reward += s->total_reward;
+                total_steps += s->total_steps;
+                total_episodes += s->total_episodes;
+            }
+            const torch::Tensor batch_observations = torch::cat(observations, 1);
+            const int64_t B = batch_observations.size(1);
+
+            auto [values, log_probs, entropy] = policy->EvaluateActions(
+                batch_observations.slice(0, 0, T).reshape({ T * B, -1 }),
+                torch::cat(actions, 1).reshape({ T * B, -1 })
+            );
+            values = values.view({ T, B });
+            log_probs = log_probs.view({ T, B });
+
+            torch::Tensor bootstrap_value;
+            {
+                torch::NoGradGuard no_grad;
+                bootstrap_value = policy->PredictValues(batch_observations[T]).view({ B });
+            }
+
+            // Correct the lag between the actors and the learner policies
+            const VTraceReturns vtrace = ComputeVTrace(log_probs - torch::cat(behaviour_log_probs, 1),
+                torch::cat(discounts, 1), torch::cat(rewards, 1), values, bootstrap_value,
+                args.rho_bar, args.c_bar, args.rho_bar);
+
+            torch::Tensor policy_loss = -(log_probs * vtrace.pg_advantages).mean();
+            torch::Tensor value_loss = torch::mse_loss(values, vtrace.vs);
+            torch::Tensor entropy_loss = -torch::mean(entropy);
+            torch::Tensor loss = policy_loss + args.entropy_loss_weight * entropy_loss + args.val_loss_weight * value_loss;
+
+            optimizer.zero_grad();
+            loss.backward();
+            if (args.max_grad_norm > 0.0f)
+            {
+                ClipGradNorm(policy->parameters(), args.max_grad_norm);
+            }
+            optimizer.step();
+            PublishWeights();
+
+            policy_loss_sum.add_(policy_loss.detach());
+            value_loss_sum.add_(value_loss.detach());
+            entropy_loss_sum.add_(entropy_loss.detach());
+            num_updates += 1;
+
+            timestep += T * B;
+            iteration += 1;
+
+            if (timestep >= next_log || timestep >= total_timesteps)
+            {
+                next_log += args.log_interval * ((timestep - next_log) / args.log_interval + 1);
+                const float train_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0f;
+
+                logger.Log(timestep, iteration, train_time,
+                    {
+                        { "Loss policy", policy_loss_sum.item<float>() / num_updates },
+                        { "Loss value", value_loss_sum.item<float>() / num_updates },
+                        { "Loss entropy", entropy_loss_sum.item<float>() / num_updates }
+                    }
+                );
+                policy_loss_sum.zero_();
+                value_loss_sum.zero_();
+                entropy_loss_sum.zero_();
+                num_updates = 0;
+
+                if (total_episodes > 0)
+                {
+                    logger.Log(timestep, iteration, train_time,
+                        {
+                            {"Reward episode", total_reward / total_episodes },
+                            {"Reward step", total_reward / total_steps },
+                            {"Steps per episode", static_cast<float>(total_steps) / total_episodes }
+                        }
+                    );
+                    total_reward = 0.0f;
+                    total_steps = 0;
+                    total_episodes = 0;
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        Stop();
+        actors.Wait();
+        throw;
+    }
+
+    Stop();
+    actors.Wait();
+    // Discard what the actors produced after the end of the training
+    std::unique_ptr<TrajectorySegment> segment;
+    while (queue.TryPop(segment))
+    {
+
+    }
+
+    if (actor_exception)
+    {
+        std::exception_ptr e = actor_exception;
+        actor_exception = nullptr;
+        std::rethrow_exception(e);
+    }
+
+    // Actors are done, merge their last updates. The first env is synced
+    // again to get the updates of the others before being saved
+    for (size_t i = 0; i < envs.size(); ++i)
+    {
+        SyncNormalizers(i);
+    }
+    SyncNormalizers(0);
+
+    torch::save(policy, (exp_path / "policy.pt").string());
+    envs[0]->Save(exp_path.string());
+}
+
+std::vector<std::pair<uint64_t, float> > IMPALA::Play(const uint64_t num_episode, const bool render)
+{
+    torch::NoGradGuard no_grad;
+
+    std::vector<std::pair<uint64_t, float> > output;
+    output.reserve(num_episode);
+
+    std::filesystem::path exp_path = args.exp_path;
+    if (!std::filesystem::exists(exp_path))
+    {
+        std::cerr << "Error, can't find trained files in " << exp_path << std::endl;
+        return {};
+    }
+
+    VectorizedEnv& env = *envs[0];
+    torch::load(policy, (exp_path / "policy.pt").string());
+    env.Load(exp_path.string());
+
+    policy->train(false);
+    env.SetTraining(false);
+    env.Reset();
+
+    torch::Tensor obs = env.GetObs();
+
+    while (output.size() < num_episode)
+    {
+        if (render)
+        {
+            env.Render(50);
+        }
+
+        // Use policy to deterministically predict an action
+        auto [action, value, log_prob] = policy(obs, true);
+
+        const VectorizedStepResult& step_result = env.Step(action);
+
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+        for (const int64_t i : step_result.terminated_envs)
+        {
+            if (render)
+            {
+                std::cout << "Episode done! Reward: " << step_result.episodes_tot_reward[i]
+                    << " Length: " << step_result.episodes_tot_length[i] << std::endl;
+            }
+            output.push_back({ step_result.episodes_tot_length[i], step_result.episodes_tot_reward[i] });
+        }
+    }
+
+    output.resize(num_episode);
+    return output;
+}
+
+void IMPALA::ActorLoop(const int64_t i)
+{
+    try
+    {
+        VectorizedEnv& env = *envs[i];
+        const int64_t T = args.unroll_length;
+        const int64_t N = env.GetNumEnvs();
+
+        Policy actor_policy(env.GetObservationSize(), env.GetActionSize(), args.ortho_init, args.init_sampling_log_std, args.fused_policy);
+        actor_policy->train(false);
+        uint64_t version = 0;
+
+        torch::Tensor obs = env.GetObs();
+
+        while (!stop)
+        {
+            const uint64_t previous_version = version;
+            PullWeights(actor_policy, version);
+            if (version != previous_version)
+            {
+                SyncNormalizers(i);
+            }
+
+            std::unique_ptr<TrajectorySegment> segment = std::make_unique<TrajectorySegment>();
+            segment->observations = torch::zeros({ T + 1, N, env.GetObservationSize() });
+            segment->actions = torch::zeros({ T, N, env.GetActionSize() });
+            segment->behaviour_log_probs = torch::zeros({ T, N });
+            segment->rewards = torch::zeros({ T, N });
+            segment->discounts = torch::zeros({ T, N });
+
+            for (int64_t t = 0; t < T; ++t)
+            {
+                torch::NoGradGuard no_grad;
+
+                auto [action, value, log_prob] = actor_policy(obs);
+                const VectorizedStepResult& step_result = env.Step(action);
+
+                // As in PPO, approx the future rewards of the timed out episodes using
+                // policy estimation on their last obs, for all the envs at once
+                torch::Tensor rewards = step_result.rewards;
+                torch::Tensor timeout_mask = torch::zeros({ N }, torch::kBool);
+                bool* timeout_mask_data = timeout_mask.data_ptr<bool>();
+                bool has_env_timeout = false;
+                for (const int64_t k : step_result.terminated_envs)
+                {
+                    timeout_mask_data[k] = step_result.terminal_states[k] == TerminalState::Timeout;
+                    has_env_timeout = has_env_timeout || timeout_mask_data[k];
+                }
+                if (has_env_timeout)
+                {
+                    const torch::Tensor terminal_value = actor_policy->PredictValues(step_result.obs).view({ -1 });
+                    // Adding 0 to the other envs rewards leaves them unchanged
+                    rewards = step_result.rewards + (args.gamma * terminal_value).masked_fill_(timeout_mask.logical_not(), 0.0f);
+                }
+
+                segment->observations[t].copy_(obs);
+                segment->actions[t].copy_(action);
+                segment->behaviour_log_probs[t].copy_(log_prob.view({ N }));
+                segment->rewards[t].copy_(rewards);
+                segment->discounts[t].copy_(step_result.terminal_mask.logical_not().to(torch::kFloat) * args.gamma);
+
+                obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+                for (const int64_t k : step_result.terminated_envs)
+                {
+                    // Episodes interrupted by an env failure have a length of 0
+                    if (step_result.episodes_tot_length[k] > 0)
+                    {
+                        segment->total_reward += step_result.episodes_tot_reward[k];
+                        segment->total_steps += step_result.episodes_tot_length[k];
+                        segment->total_episodes += 1;
+                    }
+                }
+            }
+            segment->observations[T].copy_(obs);
+
+            // Wait for the learner if it's lagging behind
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_condition.wait(lock, [&] { return stop || queue.TryPush(segment); });
+            }
+            if (segment != nullptr)
+            {
+                return;
+            }
+            queue_condition.notify_all();
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(actor_exception_mutex);
+        if (!actor_exception)
+        {
+            actor_exception = std::current_exception();
+        }
+        Stop();
+    }
+}
+
+void IMPALA::Stop()
+{
+    {
+        // Under the lock, so no thread can miss it between checking stop and waiting
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stop = true;
+    }
+    queue_condition.notify_all();
+}
+
+void IMPALA::PublishWeights()
+{
+    torch::NoGradGuard no_grad;
+
+    const std::vector<torch::Tensor> parameters = policy->parameters();
+    std::lock_guard<std::mutex> lock(published_mutex);
+    if (published_weights.empty())
+    {
+        for (const torch::Tensor& p : parameters)
+        {
+            published_weights.push_back(p.detach().clone());
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < parameters.size(); ++i)
+        {
+            published_weights[i].copy_(parameters[i]);
+        }
+    }
+    published_version += 1;
+}
+
+void IMPALA::SyncNormalizers(const int64_t i)
+{
+    VectorizedEnv& env = *envs[i];
+    const std::pair<RunningMeanStd*, RunningMeanStd*> normalizers[] = {
+        { &env.GetObsNormalizer(), &shared_obs_rms },
+        { &env.GetRewardNormalizer(), &shared_ret_rms }
+    };
+    torch::Tensor* synced_states[] = { &synced_obs_states[i], &synced_ret_states[i] };
+
+    std::lock_guard<std::mutex> lock(normalizers_mutex);
+    for (int k = 0; k < 2; ++k)
+    {
+        auto [env_rms, shared_rms] = normalizers[k];
+        // Only the samples seen by this env since its last sync are added, so none is counted twice
+        RunningMeanStd update = *shared_rms;
+        update.SetState(RunningMeanStd::SubtractState(env_rms->GetState(), *synced_states[k]));
+        shared_rms->Merge(update);
+        *env_rms = *shared_rms;
+        *synced_states[k] = shared_rms->GetState();
+    }
+}
+
+void IMPALA::PullWeights(Policy& actor_policy, uint64_t& version)
+{
+    if (published_version.load() == version)
+    {
+        return;
+    }
+
+    torch::NoGradGuard no_grad;
+
+    std::vector<torch::Tensor> parameters = actor_policy->parameters();
+    std::lock_guard<std::mutex> lock(published_mutex);
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        parameters[i].copy_(published_weights[i]);
+    }
+    version = published_version.load();
+}
@@ -0,0 +1,37 @@
+#include "torchrl/algorithms/impala/VTrace.hpp"
+
+VTraceReturns ComputeVTrace(const torch::Tensor& log_rhos, const torch::Tensor& discounts,
+    const torch::Tensor& rewards, const torch::Tensor& values, const torch::Tensor& bootstrap_value,
+    const float rho_bar, const float c_bar, const float pg_rho_bar)
+{
+    torch::NoGradGuard no_grad;
+
+    const int64_t T = values.size(0);
+
+    const torch::Tensor rhos = torch::exp(log_rhos.detach());
+    const torch::Tensor clipped_rhos = torch::clamp_max(rhos, rho_bar);
+    const torch::Tensor cs = torch::clamp_max(rhos, c_bar);
+
+    const torch::Tensor detached_values = values.detach();
+    const torch::Tensor detached_bootstrap = bootstrap_value.detach();
+    // V(x_{t+1})
+    const torch::Tensor values_t_plus_1 = torch::cat({ detached_values.slice(0, 1), detached_bootstrap.unsqueeze(0) }, 0);
+    const torch::Tensor deltas = clipped_rhos * (rewards + discounts * values_t_plus_1 - detached_values);
+
+    // vs_t - V(x_t) = delta_t + gamma_t * c_t * (vs_{t+1} - V(x_{t+1}))
+    torch::Tensor vs_minus_v = torch::zeros_like(detached_values);
+    torch::Tensor acc = torch::zeros_like(detached_bootstrap);
+    for (int64_t t = T - 1; t > -1; --t)
+    {
+        acc = deltas[t] + discounts[t] * cs[t] * acc;
+        vs_minus_v[t].copy_(acc);
+    }
+
+    VTraceReturns output;
+    output.vs = vs_minus_v + detached_values;
+
+    const torch::Tensor vs_t_plus_1 = torch::cat({ output.vs.slice(0, 1), detached_bootstrap.unsqueeze(0) }, 0);
+    output.pg_advantages = torch::clamp_max(rhos, pg_rho_bar) * (rewards + discounts * vs_t_plus_1 - detached_values);
+
+    return output;
+}
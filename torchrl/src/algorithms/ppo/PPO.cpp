@@ -1,14 +1,51 @@
 #include <filesystem>
+#include <numeric>
 
 #include "torchrl/algorithms/ppo/PPO.hpp"
 #include "torchrl/algorithms/ppo/PPOArgs.hpp"
+#include "torchrl/rl/ClipGradNorm.hpp"
+#include "torchrl/rl/InferenceEngine.hpp"
+#include "torchrl/rl/MinibatchSampler.hpp"
+#include "torchrl/rl/PolicyExport.hpp"
 #include "torchrl/rl/RolloutBuffer.hpp"
 #include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/utils/Distributed.hpp"
 #include "torchrl/utils/Logger.hpp"
+#include "torchrl/utils/ThreadPool.hpp"
 
-PPO::PPO(VectorizedEnv& env_, const PPOArgs& args_) : env(env_), args(args_)
+namespace
 {
-    policy = Policy(env.GetObservationSize(), env.GetActionSize(), args.ortho_init, args.init_sampling_log_std);
+    /// @brief Get a {N} bool tensor, true for the envs with a given terminal state
+    /// @param terminal_states Terminal state of each env
+    /// @param timeout_only If true, only Timeout states are set, otherwise all but NotTerminal
+    torch::Tensor TerminalMask(const std::vector<TerminalState>& terminal_states, const bool timeout_only)
+    {
+        torch::Tensor mask = torch::empty({ static_cast<int64_t>(terminal_states.size()) }, torch::kBool);
+        bool* mask_data = mask.data_ptr<bool>();
+        for (size_t i = 0; i < terminal_states.size(); ++i)
+        {
+            mask_data[i] = timeout_only ? terminal_states[i] == TerminalState::Timeout : terminal_states[i] != TerminalState::NotTerminal;
+        }
+        return mask;
+    }
+}
+
+PPO::PPO(VectorizedEnv& env_, const PPOArgs& args_, Distributed* distributed_) : env(env_), args(args_), distributed(distributed_)
+{
+    if (distributed != nullptr && args.pipelined)
+    {
+        // Both threads would issue collective operations in different orders on each process
+        throw std::runtime_error("PPO pipelined mode can't be used with distributed training");
+    }
+
+    policy = Policy(env.GetObservationSize(), env.GetActionSize(), args.ortho_init, args.init_sampling_log_std, args.fused_policy);
+    // Without pipelining, rollouts are collected with the trained policy itself
+    actor_policy = args.pipelined ? Policy(env.GetObservationSize(), env.GetActionSize(), args.ortho_init, args.init_sampling_log_std, args.fused_policy) : policy;
+
+    if (args.inference_engine)
+    {
+        inference_engine = std::make_unique<InferenceEngine>(args.seed + args.rank);
+    }
 }
 
 PPO::~PPO()
@@ -25,10 +62,54 @@ void PPO::Learn(const uint64_t total_timesteps, const bool log_console, const bo
         std::filesystem::create_directories(exp_path);
     }
 
-    Logger logger((exp_path / "training_logs.csv").string(), log_console, draw_curves);
+    // Only the first process logs in console and saves the trained files
+    const bool is_main_process = distributed == nullptr || distributed->GetRank() == 0;
+    const int world_size = distributed == nullptr ? 1 : distributed->GetWorldSize();
+    Logger logger((exp_path / (is_main_process ? "training_logs.csv" : "training_logs_rank" + std::to_string(distributed->GetRank()) + ".csv")).string(),
+        log_console && is_main_process, draw_curves && is_main_process);
 
     torch::optim::Adam optimizer(policy->parameters(), torch::optim::AdamOptions(args.lr));
-    RolloutBuffer rollout_buffer(env.GetNumEnvs(), args.n_steps);
+    // All processes start from the same weights
+    torch::Tensor obs_rms_synced, ret_rms_synced;
+    if (distributed != nullptr)
+    {
+        distributed->BroadcastParameters(policy->parameters());
+    }
+
+    // In pipelined mode, the actor collects rollouts in one buffer
+    // while the learner is trained on the other one
+    const int num_buffers = args.pipelined ? 2 : 1;
+    std::vector<std::unique_ptr<RolloutBuffer>> rollout_buffers;
+    std::vector<std::unique_ptr<MinibatchSampler>> samplers;
+    if (!args.rollout_storage.empty() && !std::filesystem::exists(args.rollout_storage))
+    {
+        std::filesystem::create_directories(args.rollout_storage);
+    }
+    for (int i = 0; i < num_buffers; ++i)
+    {
+        // One file per buffer and per process
+        const std::string storage_path = args.rollout_storage.empty() ? "" :
+            (std::filesystem::path(args.rollout_storage) / ("rollouts_" + std::to_string(args.rank) + "_" + std::to_string(i) + ".bin")).string();
+        rollout_buffers.push_back(std::make_unique<RolloutBuffer>(env.GetNumEnvs(), args.n_steps, env.GetObservationSize(), env.GetActionSize(), storage_path, args.compact_rollouts));
+        samplers.push_back(std::make_unique<MinibatchSampler>(*rollout_buffers[i], args.batch_size, args.prefetch_minibatches));
+    }
+    if (args.compact_rollouts && log_console && is_main_process)
+    {
+        const size_t compact_size = rollout_buffers[0]->GetMemorySize() * num_buffers;
+        const size_t full_size = rollout_buffers[0]->GetMemorySize(true) * num_buffers;
+        std::cout << "Compact rollout storage: " << compact_size / 1048576.0 << " MB instead of " << full_size / 1048576.0
+            << " MB (" << 100.0 * (full_size - compact_size) / full_size << "% saved)" << std::endl;
+    }
+
+    // Collection task run on the actor thread in pipelined mode
+    std::tuple<float, uint64_t, uint64_t> collected_stats;
+    const std::function<void(const int64_t, const int64_t)> collect = [&](const int64_t buffer_index, const int64_t)
+    {
+        collected_stats = args.async_batch_size > 0 ? CollectRolloutsAsync(*rollout_buffers[buffer_index]) : CollectRollouts(*rollout_buffers[buffer_index]);
+    };
+    // Declared after the group so the thread is joined first if an exception is thrown
+    ThreadPool::TaskGroup collection;
+    std::unique_ptr<ThreadPool> actor_thread = args.pipelined ? std::make_unique<ThreadPool>(1) : nullptr;
 
     env.SetTraining(true);
     env.Reset();
@@ -36,27 +117,57 @@ void PPO::Learn(const uint64_t total_timesteps, const bool log_console, const bo
     uint64_t timestep = 0;
     uint64_t iteration = 0;
     bool has_average = false;
+    int current_buffer = 0;
+
+    if (args.pipelined)
+    {
+        SyncActorPolicy();
+        collect(current_buffer, 0);
+    }
 
     while (timestep < total_timesteps)
     {
-        auto [total_reward, total_steps, total_episodes] = CollectRollouts(rollout_buffer);
+        RolloutBuffer& rollout_buffer = *rollout_buffers[current_buffer];
+        MinibatchSampler& sampler = *samplers[current_buffer];
 
-        has_average = total_episodes > 0;
+        // In pipelined mode, this buffer was filled during the previous iteration
+        if (!args.pipelined)
+        {
+            collect(current_buffer, 0);
+        }
+        if (distributed != nullptr)
+        {
+            distributed->SyncRunningMeanStd(env.GetObsNormalizer(), obs_rms_synced);
+            distributed->SyncRunningMeanStd(env.GetRewardNormalizer(), ret_rms_synced);
+        }
+        auto [total_reward, total_steps, total_episodes] = collected_stats;
 
-        auto dataset = rollout_buffer.map(RolloutSampleBatchTransform());
-        timestep += dataset.size().value();
+        // Start collecting the next rollouts with a snapshot of the current weights while
+        // training on this one. The actor then lags one update behind the learner, which
+        // is corrected by the PPO ratio as the log probs of the actor are stored
+        if (args.pipelined && timestep + rollout_buffer.size().value() < total_timesteps)
+        {
+            SyncActorPolicy();
+            actor_thread->Submit(collect, 1 - current_buffer, 0, collection);
+        }
+
+        has_average = total_episodes > 0;
 
-        auto dataloader = torch::data::make_data_loader<torch::data::samplers::RandomSampler>(std::move(dataset), torch::data::DataLoaderOptions().batch_size(args.batch_size));
+        timestep += rollout_buffer.size().value() * world_size;
 
-        float policy_loss_val = 0.0f;
-        float value_loss_val = 0.0f;
-        float entropy_loss_val = 0.0f;
+        // Losses are accumulated in tensors and only read once all the epochs
+        // are done, so the optimization loop never waits for their values
+        torch::Tensor policy_loss_sum = torch::zeros({});
+        torch::Tensor value_loss_sum = torch::zeros({});
+        torch::Tensor entropy_loss_sum = torch::zeros({});
         int num_batches = 0;
 
         policy->train(true);
+        RolloutSample rollout_data;
         for (uint64_t i = 0; i < args.n_epochs; ++i)
         {
-            for (auto& rollout_data : *dataloader)
+            sampler.Reset();
+            while (sampler.Next(rollout_data))
             {
                 auto [values, log_probs, entropy] = policy->EvaluateActions(rollout_data.observation, rollout_data.action);
 
@@ -71,36 +182,46 @@ void PPO::Learn(const uint64_t total_timesteps, const bool log_console, const bo
                 torch::Tensor surrogate_loss_1 = advantages * ratio;
                 torch::Tensor surrogate_loss_2 = advantages * torch::clamp(ratio, 1.0f - args.clip_value, 1.0f + args.clip_value);
                 torch::Tensor policy_loss = -torch::min(surrogate_loss_1, surrogate_loss_2).mean();
-                policy_loss_val += policy_loss.item<float>();
+                policy_loss_sum.add_(policy_loss.detach());
 
                 // Value loss with TD(lambda)
                 torch::Tensor value_loss = torch::mse_loss(rollout_data.returns, values);
-                value_loss_val += value_loss.item<float>();
+                value_loss_sum.add_(value_loss.detach());
 
                 // Entropy loss
                 torch::Tensor entropy_loss = -torch::mean(entropy);
-                entropy_loss_val += entropy_loss.item<float>();
+                entropy_loss_sum.add_(entropy_loss.detach());
 
                 torch::Tensor loss = policy_loss + args.entropy_loss_weight * entropy_loss + args.val_loss_weight * value_loss;
 
                 optimizer.zero_grad();
                 loss.backward();
+                if (distributed != nullptr)
+                {
+                    distributed->AverageGradients(policy->parameters());
+                }
                 if (args.max_grad_norm > 0.0f)
                 {
-                    torch::nn::utils::clip_grad_norm_(policy->parameters(), args.max_grad_norm);
+                    ClipGradNorm(policy->parameters(), args.max_grad_norm);
                 }
                 optimizer.step();
                 num_batches += 1;
             }
         }
         iteration += num_batches;
+
+        if (args.pipelined)
+        {
+            collection.Wait();
+            current_buffer = 1 - current_buffer;
+        }
         const float train_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0f;
 
         logger.Log(timestep, iteration, train_time,
             {
-                { "Loss policy", policy_loss_val / num_batches },
-                { "Loss value", value_loss_val / num_batches },
-                { "Loss entropy", entropy_loss_val / num_batches }
+                { "Loss policy", policy_loss_sum.item<float>() / num_batches },
+                { "Loss value", value_loss_sum.item<float>() / num_batches },
+                { "Loss entropy", entropy_loss_sum.item<float>() / num_batches }
             }
         );
         if (has_average)
@@ -115,8 +236,39 @@ void PPO::Learn(const uint64_t total_timesteps, const bool log_console, const bo
         }
     }
 
-    torch::save(policy, (exp_path / "policy.pt").string());
-    env.Save(exp_path.string());
+    if (is_main_process)
+    {
+        torch::save(policy, (exp_path / "policy.pt").string());
+        env.Save(exp_path.string());
+        if (args.export_torchscript)
+        {
+            ExportTorchScript(policy, env, (exp_path / "policy_script.pt").string());
+        }
+    }
+}
+
+void PPO::SyncActorPolicy()
+{
+    torch::NoGradGuard no_grad;
+
+    const std::vector<torch::Tensor> src = policy->parameters();
+    std::vector<torch::Tensor> dst = actor_policy->parameters();
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        dst[i].copy_(src[i]);
+    }
+}
+
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> PPO::ActorForward(const torch::Tensor& observations)
+{
+    torch::NoGradGuard no_grad;
+    return inference_engine != nullptr ? inference_engine->Forward(observations) : actor_policy(observations);
+}
+
+torch::Tensor PPO::ActorPredictValues(const torch::Tensor& observations)
+{
+    torch::NoGradGuard no_grad;
+    return inference_engine != nullptr ? inference_engine->PredictValues(observations) : actor_policy->PredictValues(observations);
 }
 
 std::vector<std::pair<uint64_t, float> > PPO::Play(const uint64_t num_episode, const bool render)
@@ -140,10 +292,13 @@ std::vector<std::pair<uint64_t, float> > PPO::Play(const uint64_t num_episode, c
     env.Load(exp_path.string());
 
     policy->train(false);
+    if (inference_engine != nullptr)
+    {
+        inference_engine->Update(policy);
+    }
     env.SetTraining(false);
     env.Reset();
 
-    VectorizedStepResult step_result;
     torch::Tensor obs = env.GetObs();
 
     uint64_t episode_index = 0;
@@ -156,13 +311,13 @@ std::vector<std::pair<uint64_t, float> > PPO::Play(const uint64_t num_episode, c
         }
         
         // Use policy to deterministically predict an action
-        auto [action, value, log_prob] = policy(obs, true);
+        auto [action, value, log_prob] = inference_engine != nullptr ? inference_engine->Forward(obs, true) : policy(obs, true);
 
         // Perform action in the env
-        step_result = env.Step(action);
+        const VectorizedStepResult& step_result = env.Step(action);
 
-        // Set the observation for the next step
-        obs = step_result.obs;
+        // Set the observation for the next step (new obs after reset for terminated envs)
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
         for (uint64_t i = 0; i < step_result.terminal_states.size(); ++i)
         {
             if (step_result.terminal_states[i] != TerminalState::NotTerminal)
@@ -185,9 +340,6 @@ std::vector<std::pair<uint64_t, float> > PPO::Play(const uint64_t num_episode, c
 
                 episode_index += 1;
 
-                // Update obs with new one
-                obs[i] = step_result.new_episode_obs[i];
-
                 if (num_episode == 0)
                 {
                     char type;
@@ -213,14 +365,20 @@ std::vector<std::pair<uint64_t, float> > PPO::Play(const uint64_t num_episode, c
 
 std::tuple<float, uint64_t, uint64_t> PPO::CollectRollouts(RolloutBuffer& buffer)
 {
-    policy->train(false);
+    actor_policy->train(false);
+    // Policy weights only change between two collections
+    if (inference_engine != nullptr)
+    {
+        inference_engine->Update(actor_policy);
+    }
     buffer.Reset();
 
     uint64_t t = 0;
     float total_reward = 0.0f;
     uint64_t total_steps = 0;
     uint64_t total_end_episodes = 0;
-    VectorizedStepResult step_result;
+    // Terminal state of the last step of each env
+    std::vector<TerminalState> last_terminal_states;
 
     // Get current observation
     torch::Tensor obs = env.GetObs();
@@ -228,14 +386,10 @@ std::tuple<float, uint64_t, uint64_t> PPO::CollectRollouts(RolloutBuffer& buffer
     while (t < args.n_steps)
     {
         // Use policy to predict an action
-        torch::Tensor action, value, log_prob;
-        {
-            torch::NoGradGuard no_grad;
-            std::tie(action, value, log_prob) = policy(obs);
-        }
+        auto [action, value, log_prob] = ActorForward(obs);
 
         // Perform action in the env
-        step_result = env.Step(action);
+        const VectorizedStepResult& step_result = env.Step(action);
 
         bool has_env_timeout = false;
         for (uint64_t i = 0; i < step_result.terminal_states.size(); ++i)
@@ -243,34 +397,32 @@ std::tuple<float, uint64_t, uint64_t> PPO::CollectRollouts(RolloutBuffer& buffer
             has_env_timeout = has_env_timeout || step_result.terminal_states[i] == TerminalState::Timeout;
         }
         // In case at least one of the envs timeout, approx potential future reward
-        // using policy estimation and add it to the reward for these envs
+        // using policy estimation and add it to the reward for these envs.
+        // On a copy, as the result belongs to the env (and to its recorder)
+        torch::Tensor rewards = step_result.rewards;
         if (has_env_timeout)
         {
-            torch::NoGradGuard no_grad;
-            torch::Tensor terminal_value = policy->PredictValues(step_result.obs);
-            for (uint64_t i = 0; i < step_result.terminal_states.size(); ++i)
-            {
-                if (step_result.terminal_states[i] == TerminalState::Timeout)
-                {
-                    step_result.rewards[i] += args.gamma * terminal_value[i].item<float>();
-                }
-            }
+            torch::Tensor terminal_value = ActorPredictValues(step_result.obs).view({ -1 });
+            // Adding 0 to the other envs rewards leaves them unchanged
+            rewards = step_result.rewards + (args.gamma * terminal_value).masked_fill_(TerminalMask(step_result.terminal_states, true).logical_not(), 0.0f);
         }
 
-        buffer.Add(obs, action, value, log_prob, step_result.rewards, step_result.terminal_states);
+        buffer.Add(obs, action, value, log_prob, rewards, step_result.terminal_states);
 
-        // Set the observation for the next step
-        obs = step_result.obs;
-        for (uint64_t i = 0; i < step_result.terminal_states.size(); ++i)
+        // Set the observation for the next step (new obs after reset for terminated envs).
+        // This is a new tensor, so it's still valid if the env reuses its buffers
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+        for (const int64_t i : step_result.terminated_envs)
         {
-            if (step_result.terminal_states[i] != TerminalState::NotTerminal)
+            // Episodes interrupted by an env failure have a length of 0
+            if (step_result.episodes_tot_length[i] > 0)
             {
-                obs[i] = step_result.new_episode_obs[i];
                 total_reward += step_result.episodes_tot_reward[i];
                 total_steps += step_result.episodes_tot_length[i];
                 total_end_episodes += 1;
             }
         }
+        last_terminal_states = step_result.terminal_states;
         t += 1;
     }
 
@@ -280,14 +432,122 @@ std::tuple<float, uint64_t, uint64_t> PPO::CollectRollouts(RolloutBuffer& buffer
     torch::Tensor future_value;
     {
         torch::NoGradGuard no_grad;
-        future_value = policy->PredictValues(obs);
-        for (uint64_t i = 0; i < future_value.size(0); ++i)
+        future_value = ActorPredictValues(obs);
+        future_value.masked_fill_(TerminalMask(last_terminal_states, false).unsqueeze(1), 0.0f);
+    }
+
+    buffer.ComputeReturnsAndAdvantage(future_value, args.gamma, args.lambda_gae);
+    return { total_reward, total_steps, total_end_episodes };
+}
+
+std::tuple<float, uint64_t, uint64_t> PPO::CollectRolloutsAsync(RolloutBuffer& buffer)
+{
+    actor_policy->train(false);
+    // Policy weights only change between two collections
+    if (inference_engine != nullptr)
+    {
+        inference_engine->Update(actor_policy);
+    }
+    buffer.Reset();
+
+    const int64_t num_envs = env.GetNumEnvs();
+    float total_reward = 0.0f;
+    uint64_t total_steps = 0;
+    uint64_t total_end_episodes = 0;
+
+    // Number of steps collected for each env
+    std::vector<uint64_t> env_steps(num_envs, 0);
+    // Terminal state of the last step of each env
+    std::vector<TerminalState> last_terminal_states(num_envs, TerminalState::NotTerminal);
+
+    // Current observation of each env, and what the policy
+    // predicted on it for the envs currently stepping
+    torch::Tensor obs = env.GetObs();
+    torch::Tensor actions = torch::zeros({ num_envs, env.GetActionSize() });
+    torch::Tensor values = torch::zeros({ num_envs, 1 });
+    torch::Tensor log_probs = torch::zeros({ num_envs, 1 });
+
+    // Use policy to predict an action for some envs and start stepping them
+    auto send = [&](const std::vector<int64_t>& env_ids)
+    {
+        const torch::Tensor ids = torch::tensor(env_ids, torch::kLong);
+        auto [action, value, log_prob] = ActorForward(obs.index_select(0, ids));
+        actions.index_copy_(0, ids, action);
+        values.index_copy_(0, ids, value);
+        log_probs.index_copy_(0, ids, log_prob);
+
+        env.StepAsync(action, env_ids);
+    };
+
+    std::vector<int64_t> all_envs(num_envs);
+    std::iota(all_envs.begin(), all_envs.end(), 0);
+    send(all_envs);
+
+    while (env.GetNumStepping() > 0)
+    {
+        // Wait for the first envs to be done, the others keep stepping
+        VectorizedStepResult step_result = env.Recv(std::min<int64_t>(args.async_batch_size, env.GetNumStepping()));
+        const torch::Tensor ids = torch::tensor(step_result.env_ids, torch::kLong);
+
+        bool has_env_timeout = false;
+        for (uint64_t k = 0; k < step_result.terminal_states.size(); ++k)
         {
-            if (step_result.terminal_states[i] != TerminalState::NotTerminal)
+            has_env_timeout = has_env_timeout || step_result.terminal_states[k] == TerminalState::Timeout;
+        }
+        // In case at least one of the envs timeout, approx potential future reward
+        // using policy estimation and add it to the reward for these envs
+        if (has_env_timeout)
+        {
+            torch::Tensor terminal_value = ActorPredictValues(step_result.obs).view({ -1 });
+            // Adding 0 to the other envs rewards leaves them unchanged
+            step_result.rewards.add_((args.gamma * terminal_value).masked_fill_(TerminalMask(step_result.terminal_states, true).logical_not(), 0.0f));
+        }
+
+        buffer.Add(step_result.env_ids, obs.index_select(0, ids), actions.index_select(0, ids),
+            values.index_select(0, ids), log_probs.index_select(0, ids),
+            step_result.rewards, step_result.terminal_states);
+
+        // Set the observation for the next step
+        torch::Tensor next_obs = step_result.obs;
+        std::vector<int64_t> next_env_ids;
+        for (uint64_t k = 0; k < step_result.terminal_states.size(); ++k)
+        {
+            const int64_t i = step_result.env_ids[k];
+            if (step_result.terminal_states[k] != TerminalState::NotTerminal)
+            {
+                next_obs[k] = step_result.new_episode_obs[k];
+                // Episodes interrupted by an env failure have a length of 0
+                if (step_result.episodes_tot_length[k] > 0)
+                {
+                    total_reward += step_result.episodes_tot_reward[k];
+                    total_steps += step_result.episodes_tot_length[k];
+                    total_end_episodes += 1;
+                }
+            }
+            last_terminal_states[i] = step_result.terminal_states[k];
+            env_steps[i] += 1;
+            if (env_steps[i] < args.n_steps)
             {
-                future_value[i] = 0.0f;
+                next_env_ids.push_back(i);
             }
         }
+        obs.index_copy_(0, ids, next_obs);
+
+        // Send back the envs that still need to collect steps
+        if (!next_env_ids.empty())
+        {
+            send(next_env_ids);
+        }
+    }
+
+    // As the last episode might not be complete,
+    // approx potential future rewards using
+    // policy estimation
+    torch::Tensor future_value;
+    {
+        torch::NoGradGuard no_grad;
+        future_value = ActorPredictValues(obs);
+        future_value.masked_fill_(TerminalMask(last_terminal_states, false).unsqueeze(1), 0.0f);
     }
 
     buffer.ComputeReturnsAndAdvantage(future_value, args.gamma, args.lambda_gae);
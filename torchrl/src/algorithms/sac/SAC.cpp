@@ -0,0 +1,329 @@
+#include <filesystem>
+#include <iomanip>
+
+#include "torchrl/algorithms/sac/SAC.hpp"
+#include "torchrl/algorithms/sac/SACArgs.hpp"
+#include "torchrl/rl/PrioritizedReplayBuffer.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/utils/Logger.hpp"
+
+SAC::SAC(VectorizedEnv& env_, const SACArgs& args_) : env(env_), args(args_)
+{
+    actor = SquashedGaussianActor(env.GetObservationSize(), env.GetActionSize(), args.action_scale);
+    critic = TwinQNetwork(env.GetObservationSize(), env.GetActionSize());
+    critic_target = TwinQNetwork(env.GetObservationSize(), env.GetActionSize());
+
+    // Target starts with the same weights as the critics and is never trained directly
+    {
+        torch::NoGradGuard no_grad;
+        const std::vector<torch::Tensor> src = critic->parameters();
+        std::vector<torch::Tensor> dst = critic_target->parameters();
+        for (size_t i = 0; i < src.size(); ++i)
+        {
+            dst[i].copy_(src[i]);
+            dst[i].set_requires_grad(false);
+        }
+    }
+
+    log_ent_coef = torch::full({ 1 }, std::log(args.init_ent_coef)).requires_grad_(args.auto_ent_coef);
+    target_entropy = -static_cast<float>(env.GetActionSize());
+}
+
+SAC::~SAC()
+{
+
+}
+
+void SAC::Learn(const uint64_t total_timesteps, const bool log_console, const bool draw_curves)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::path exp_path = args.exp_path;
+    if (!std::filesystem::exists(exp_path))
+    {
+        std::filesystem::create_directories(exp_path);
+    }
+
+    Logger logger((exp_path / "training_logs.csv").string(), log_console, draw_curves);
+
+    torch::optim::Adam actor_optimizer(actor->parameters(), torch::optim::AdamOptions(args.lr));
+    torch::optim::Adam critic_optimizer(critic->parameters(), torch::optim::AdamOptions(args.lr));
+    std::unique_ptr<torch::optim::Adam> ent_coef_optimizer = args.auto_ent_coef ?
+        std::make_unique<torch::optim::Adam>(std::vector<torch::Tensor>{ log_ent_coef }, torch::optim::AdamOptions(args.lr)) : nullptr;
+
+    const int64_t num_envs = env.GetNumEnvs();
+    std::unique_ptr<ReplayBuffer> replay_buffer;
+    PrioritizedReplayBuffer* prioritized_buffer = nullptr;
+    if (args.prioritized_replay)
+    {
+        std::unique_ptr<PrioritizedReplayBuffer> buffer = std::make_unique<PrioritizedReplayBuffer>(args.buffer_size, env.GetObservationSize(), env.GetActionSize(), args.per_alpha, args.seed, args.replay_storage);
+        prioritized_buffer = buffer.get();
+        replay_buffer = std::move(buffer);
+    }
+    else
+    {
+        replay_buffer = std::make_unique<ReplayBuffer>(args.buffer_size, env.GetObservationSize(), env.GetActionSize(), args.replay_storage);
+    }
+    ReplaySample batch;
+
+    env.SetTraining(true);
+    torch::Tensor obs = env.Reset();
+
+    uint64_t timestep = 0;
+    uint64_t iteration = 0;
+    uint64_t env_step = 0;
+    uint64_t next_log = args.log_interval;
+
+    float total_reward = 0.0f;
+    uint64_t total_steps = 0;
+    uint64_t total_episodes = 0;
+    // Losses are accumulated in tensors and only read when logged,
+    // so the training loop never waits for their values
+    torch::Tensor critic_loss_sum = torch::zeros({});
+    torch::Tensor actor_loss_sum = torch::zeros({});
+    torch::Tensor ent_coef_sum = torch::zeros({});
+    int num_batches = 0;
+
+    while (timestep < total_timesteps)
+    {
+        // Uniformly random actions until there is enough data to start training,
+        // which can already be the case if the replay buffer was resumed from a file
+        torch::Tensor action;
+        if (replay_buffer->size() < static_cast<int64_t>(args.learning_starts))
+        {
+            action = (torch::rand({ num_envs, env.GetActionSize() }) * 2.0f - 1.0f) * args.action_scale;
+        }
+        else
+        {
+            torch::NoGradGuard no_grad;
+            actor->train(false);
+            action = actor(obs).first;
+        }
+
+        const VectorizedStepResult& step_result = env.Step(action);
+
+        // The next obs of ended episodes is the last one, not the one after the reset
+        replay_buffer->Add(obs, action, step_result.rewards, step_result.obs, step_result.terminal_states);
+
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+        for (const int64_t i : step_result.terminated_envs)
+        {
+            // Episodes interrupted by an env failure have a length of 0
+            if (step_result.episodes_tot_length[i] > 0)
+            {
+                total_reward += step_result.episodes_tot_reward[i];
+                total_steps += step_result.episodes_tot_length[i];
+                total_episodes += 1;
+            }
+        }
+
+        timestep += num_envs;
+        env_step += 1;
+
+        if (replay_buffer->size() >= static_cast<int64_t>(args.learning_starts) && env_step % args.train_freq == 0)
+        {
+            actor->train(true);
+            if (prioritized_buffer != nullptr)
+            {
+                prioritized_buffer->SetBeta(args.per_beta + (1.0f - args.per_beta) * std::min(1.0f, static_cast<float>(timestep) / total_timesteps));
+            }
+            for (uint64_t g = 0; g < args.gradient_steps; ++g)
+            {
+                replay_buffer->Sample(args.batch_size, batch);
+                auto [critic_loss, actor_loss, ent_coef, td_errors] = Train(batch, actor_optimizer, critic_optimizer, ent_coef_optimizer.get());
+                if (prioritized_buffer != nullptr)
+                {
+                    prioritized_buffer->UpdatePriorities(batch.indices, td_errors);
+                }
+                critic_loss_sum.add_(critic_loss);
+                actor_loss_sum.add_(actor_loss);
+                ent_coef_sum.add_(ent_coef);
+                num_batches += 1;
+            }
+            iteration += args.gradient_steps;
+        }
+
+        if (timestep >= next_log || timestep >= total_timesteps)
+        {
+            next_log += args.log_interval * ((timestep - next_log) / args.log_interval + 1);
+            const float train_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0f;
+
+            if (num_batches > 0)
+            {
+                logger.Log(timestep, iteration, train_time,
+                    {
+                        { "Loss critic", critic_loss_sum.item<float>() / num_batches },
+                        { "Loss actor", actor_loss_sum.item<float>() / num_batches },
+                        { "Entropy coef", ent_coef_sum.item<float>() / num_batches }
+                    }
+                );
+                critic_loss_sum.zero_();
+                actor_loss_sum.zero_();
+                ent_coef_sum.zero_();
+                num_batches = 0;
+            }
+            if (total_episodes > 0)
+            {
+                logger.Log(timestep, iteration, train_time,
+                    {
+                        {"Reward episode", total_reward / total_episodes },
+                        {"Reward step", total_reward / total_steps },
+                        {"Steps per episode", static_cast<float>(total_steps) / total_episodes }
+                    }
+                );
+                total_reward = 0.0f;
+                total_steps = 0;
+                total_episodes = 0;
+            }
+        }
+    }
+
+    torch::save(actor, (exp_path / "actor.pt").string());
+    torch::save(critic, (exp_path / "critic.pt").string());
+    env.Save(exp_path.string());
+}
+
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor> SAC::Train(const ReplaySample& batch,
+    torch::optim::Optimizer& actor_optimizer, torch::optim::Optimizer& critic_optimizer,
+    torch::optim::Optimizer* ent_coef_optimizer)
+{
+    const torch::Tensor ent_coef = log_ent_coef.detach().exp();
+
+    // Soft TD target with the min of the target critics on actions of the current actor
+    torch::Tensor target_q;
+    {
+        torch::NoGradGuard no_grad;
+        auto [next_actions, next_log_probs] = actor(batch.next_observation);
+        auto [next_q1, next_q2] = critic_target(batch.next_observation, next_actions);
+        const torch::Tensor next_q = torch::min(next_q1, next_q2) - ent_coef * next_log_probs;
+        target_q = batch.reward + (1.0f - batch.done) * args.gamma * next_q;
+    }
+
+    auto [q1, q2] = critic(batch.observation, batch.action);
+    const torch::Tensor squared_errors = 0.5f * ((q1 - target_q).pow(2) + (q2 - target_q).pow(2));
+    // Importance sampling weights correct the bias of prioritized sampling
+    const torch::Tensor critic_loss = batch.weight.defined() ? (batch.weight * squared_errors).mean() : squared_errors.mean();
+    critic_optimizer.zero_grad();
+    critic_loss.backward();
+    critic_optimizer.step();
+
+    // Critic parameters also get gradients from the actor loss, but they are
+    // zeroed before the next critic step, so they never update the critics
+    auto [actions, log_probs] = actor(batch.observation);
+    auto [pi_q1, pi_q2] = critic(batch.observation, actions);
+    const torch::Tensor actor_loss = (ent_coef * log_probs - torch::min(pi_q1, pi_q2)).mean();
+    actor_optimizer.zero_grad();
+    actor_loss.backward();
+    actor_optimizer.step();
+
+    if (ent_coef_optimizer != nullptr)
+    {
+        const torch::Tensor ent_coef_loss = -(log_ent_coef * (log_probs.detach() + target_entropy)).mean();
+        ent_coef_optimizer->zero_grad();
+        ent_coef_loss.backward();
+        ent_coef_optimizer->step();
+    }
+
+    UpdateTarget();
+
+    const torch::Tensor td_errors = 0.5f * ((q1 - target_q).abs() + (q2 - target_q).abs()).detach().view({ -1 });
+
+    return { critic_loss.detach(), actor_loss.detach(), ent_coef.sum(), td_errors };
+}
+
+void SAC::UpdateTarget()
+{
+    torch::NoGradGuard no_grad;
+
+    const std::vector<torch::Tensor> src = critic->parameters();
+    std::vector<torch::Tensor> dst = critic_target->parameters();
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        dst[i].lerp_(src[i], args.tau);
+    }
+}
+
+std::vector<std::pair<uint64_t, float> > SAC::Play(const uint64_t num_episode, const bool render)
+{
+    torch::NoGradGuard no_grad;
+
+    std::vector<std::pair<uint64_t, float> > output;
+    if (num_episode > 0)
+    {
+        output.reserve(num_episode);
+    }
+
+    std::filesystem::path exp_path = args.exp_path;
+    if (!std::filesystem::exists(exp_path))
+    {
+        std::cerr << "Error, can't find trained files in " << exp_path << std::endl;
+        return {};
+    }
+
+    torch::load(actor, (exp_path / "actor.pt").string());
+    env.Load(exp_path.string());
+
+    actor->train(false);
+    env.SetTraining(false);
+    env.Reset();
+
+    torch::Tensor obs = env.GetObs();
+
+    uint64_t episode_index = 0;
+    bool run = true;
+    while ((num_episode == 0 && run) || episode_index < num_episode)
+    {
+        if (render)
+        {
+            env.Render(50);
+        }
+
+        // Use the squashed means as deterministic actions
+        const torch::Tensor action = actor(obs, true).first;
+
+        const VectorizedStepResult& step_result = env.Step(action);
+
+        obs = torch::where(step_result.terminal_mask.unsqueeze(1), step_result.new_episode_obs, step_result.obs);
+        for (uint64_t i = 0; i < step_result.terminal_states.size(); ++i)
+        {
+            if (step_result.terminal_states[i] != TerminalState::NotTerminal)
+            {
+                if (render)
+                {
+                    // Log result
+                    std::cout
+                        << std::setw(13) << std::fixed << "Episode done!"
+                        << std::setw(10) << std::fixed << "Reward"
+                        << std::setw(10) << std::fixed << "Length"
+                        << "\n"
+                        << std::setw(13) << std::fixed << ""
+                        << std::setw(10) << std::fixed << std::setprecision(2) << step_result.episodes_tot_reward[i]
+                        << std::setw(10) << std::fixed << std::setprecision(4) << step_result.episodes_tot_length[i]
+                        << std::endl;
+                }
+
+                output.push_back({ step_result.episodes_tot_length[i], step_result.episodes_tot_reward[i] });
+
+                episode_index += 1;
+
+                if (num_episode == 0)
+                {
+                    char type;
+                    do
+                    {
+                        std::cout << "Keep playing? [y/n]" << std::flush;
+                        std::cin >> type;
+                    } while (!std::cin.fail() && type != 'y' && type != 'Y' && type != 'n' && type != 'N');
+
+                    if (type == 'n' || type == 'N')
+                    {
+                        std::cout << "Good bye!" << std::endl;
+                        run = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return output;
+}
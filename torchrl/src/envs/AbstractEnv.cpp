@@ -1,5 +1,15 @@
 #include "torchrl/envs/AbstractEnv.hpp"
 
+namespace
+{
+    /// @brief Copy a flat observation tensor in a float array
+    void CopyObs(const torch::Tensor& obs, float* obs_out)
+    {
+        const torch::Tensor o = obs.to(torch::kFloat).contiguous();
+        std::copy(o.data_ptr<float>(), o.data_ptr<float>() + o.numel(), obs_out);
+    }
+}
+
 AbstractEnv::AbstractEnv(const unsigned int seed)
 {
     if (seed == 0)
@@ -29,6 +39,15 @@ torch::Tensor AbstractEnv::Reset()
     return GetObs();
 }
 
+void AbstractEnv::Reset(float* obs_out)
+{
+    current_episode_length = 0;
+    current_episode_reward = 0.0f;
+    ResetImpl();
+
+    WriteObs(obs_out);
+}
+
 StepResult AbstractEnv::Step(const torch::Tensor& action)
 {
     current_episode_length += 1;
@@ -44,6 +63,34 @@ StepResult AbstractEnv::Step(const torch::Tensor& action)
     return result;
 }
 
+StepResult AbstractEnv::Step(const float* action, float* obs_out, float* new_episode_obs_out)
+{
+    current_episode_length += 1;
+    StepResult result = StepInPlaceImpl(action, obs_out);
+    current_episode_reward += result.reward;
+
+    if (result.terminal_state != TerminalState::NotTerminal)
+    {
+        result.tot_reward = current_episode_reward;
+        result.tot_steps = current_episode_length;
+        Reset(new_episode_obs_out);
+    }
+    return result;
+}
+
+void AbstractEnv::WriteObs(float* obs_out) const
+{
+    CopyObs(GetObs(), obs_out);
+}
+
+StepResult AbstractEnv::StepInPlaceImpl(const float* action, float* obs_out)
+{
+    StepResult result = StepImpl(torch::from_blob(const_cast<float*>(action), { GetActionSize() }));
+    CopyObs(result.obs, obs_out);
+    result.obs = torch::Tensor();
+    return result;
+}
+
 void AbstractEnv::Render(const uint64_t wait_ms)
 {
     RenderImpl();
@@ -0,0 +1,81 @@
+#include "torchrl/envs/BatchedAbstractEnv.hpp"
+#include "torchrl/envs/AbstractEnv.hpp"
+
+BatchedAbstractEnv::BatchedAbstractEnv(const int64_t num_envs_, const unsigned int seed)
+{
+    num_envs = num_envs_;
+
+    const unsigned int base_seed = seed == 0 ? std::random_device()() : seed;
+    random_engines.reserve(num_envs);
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        random_engines.emplace_back(base_seed + static_cast<unsigned int>(i));
+    }
+
+    current_episode_length = std::vector<uint64_t>(num_envs, 0);
+    current_episode_reward = std::vector<float>(num_envs, 0.0f);
+}
+
+BatchedAbstractEnv::~BatchedAbstractEnv()
+{
+
+}
+
+int64_t BatchedAbstractEnv::GetNumEnvs() const
+{
+    return num_envs;
+}
+
+void BatchedAbstractEnv::Reset(float* obs_out)
+{
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        current_episode_length[i] = 0;
+        current_episode_reward[i] = 0.0f;
+        ResetImpl(i);
+    }
+
+    GetObs(obs_out);
+}
+
+void BatchedAbstractEnv::Step(const float* actions, float* obs_out, float* rewards_out, uint8_t* terminal_out,
+    float* new_episode_obs_out, float* tot_rewards_out, uint64_t* tot_steps_out)
+{
+    // Lengths are updated first, so StepBatch can use them to detect timeouts
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        current_episode_length[i] += 1;
+    }
+
+    StepBatch(actions, obs_out, rewards_out, terminal_out);
+
+    const int64_t obs_size = GetObservationSize();
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        current_episode_reward[i] += rewards_out[i];
+
+        if (static_cast<TerminalState>(terminal_out[i]) != TerminalState::NotTerminal)
+        {
+            tot_rewards_out[i] = current_episode_reward[i];
+            tot_steps_out[i] = current_episode_length[i];
+            current_episode_length[i] = 0;
+            current_episode_reward[i] = 0.0f;
+            ResetImpl(i);
+            GetEnvObs(i, new_episode_obs_out + i * obs_size);
+        }
+        else
+        {
+            tot_rewards_out[i] = 0.0f;
+            tot_steps_out[i] = 0;
+        }
+    }
+}
+
+void BatchedAbstractEnv::Render(const uint64_t wait_ms)
+{
+    RenderImpl();
+    if (wait_ms > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+    }
+}
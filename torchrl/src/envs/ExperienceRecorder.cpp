@@ -0,0 +1,350 @@
+#include "torchrl/envs/ExperienceRecorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    constexpr int64_t column_alignment = 64;
+
+    static_assert(sizeof(ExperienceFileHeader) % column_alignment == 0, "Experience file header must keep the chunks aligned");
+    static_assert(sizeof(ExperienceChunkHeader) % column_alignment == 0, "Experience chunk header must keep the columns aligned");
+
+    int64_t AlignedSize(const int64_t n)
+    {
+        return (n + column_alignment - 1) / column_alignment * column_alignment;
+    }
+
+    /// @brief Get the size of the complete chunks at the start of an existing experience file
+    /// @return The offset after the last complete chunk
+    int64_t ScanChunks(std::ifstream& in, const int64_t file_size, const int64_t obs_size, const int64_t act_size)
+    {
+        int64_t offset = sizeof(ExperienceFileHeader);
+        ExperienceChunkHeader header;
+        while (offset + static_cast<int64_t>(sizeof(header)) <= file_size)
+        {
+            in.seekg(offset);
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                !IsCompleteChunk(header, offset, file_size, obs_size, act_size))
+            {
+                break;
+            }
+            offset += sizeof(header) + header.payload_size;
+        }
+        return offset;
+    }
+}
+
+bool IsCompleteChunk(const ExperienceChunkHeader& header, const int64_t offset, const int64_t file_size,
+    const int64_t obs_size, const int64_t act_size)
+{
+    return std::memcmp(header.magic, experience_chunk_magic, sizeof(experience_chunk_magic)) == 0 && header.num_rows > 0 &&
+        header.payload_size == ExperienceChunkLayout(header.num_rows, obs_size, act_size).payload_size &&
+        offset + static_cast<int64_t>(sizeof(header)) + header.payload_size <= file_size;
+}
+
+ExperienceChunkLayout::ExperienceChunkLayout(const int64_t num_rows, const int64_t obs_size, const int64_t act_size)
+{
+    obs = 0;
+    action = obs + AlignedSize(num_rows * obs_size * sizeof(float));
+    reward = action + AlignedSize(num_rows * act_size * sizeof(float));
+    next_obs = reward + AlignedSize(num_rows * sizeof(float));
+    env_id = next_obs + AlignedSize(num_rows * obs_size * sizeof(float));
+    terminal_state = env_id + AlignedSize(num_rows * sizeof(int64_t));
+    payload_size = terminal_state + AlignedSize(num_rows * sizeof(uint8_t));
+}
+
+ExperienceRecorder::ExperienceRecorder(const std::string& path_, const int64_t obs_size_, const int64_t act_size_,
+    const int64_t chunk_size_, const int64_t max_pending_chunks_)
+{
+    path = path_;
+    obs_size = obs_size_;
+    act_size = act_size_;
+    chunk_size = chunk_size_;
+    max_pending_chunks = max_pending_chunks_;
+    num_recorded = 0;
+    writing = false;
+    stop = false;
+
+    if (chunk_size < 1 || max_pending_chunks < 1)
+    {
+        throw std::runtime_error("ExperienceRecorder chunk size and max pending chunks must be positive");
+    }
+
+    const bool append = std::filesystem::exists(path) && std::filesystem::file_size(path) > 0;
+    if (append)
+    {
+        const int64_t file_size = std::filesystem::file_size(path);
+        int64_t valid_size = 0;
+        {
+            std::ifstream in(path, std::ios::binary);
+            ExperienceFileHeader header;
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                std::memcmp(header.magic, experience_file_magic, sizeof(experience_file_magic)) != 0 ||
+                header.obs_size != obs_size || header.act_size != act_size)
+            {
+                throw std::runtime_error("Experience file " + path + " has a different layout, can't append to it");
+            }
+            valid_size = ScanChunks(in, file_size, obs_size, act_size);
+        }
+        // Drop the end of a chunk that was being written when the previous recording stopped
+        if (valid_size < file_size)
+        {
+            std::filesystem::resize_file(path, valid_size);
+        }
+    }
+
+    file.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    if (!file)
+    {
+        throw std::runtime_error("Can't open experience file " + path);
+    }
+    if (!append)
+    {
+        ExperienceFileHeader header = {};
+        std::memcpy(header.magic, experience_file_magic, sizeof(experience_file_magic));
+        header.obs_size = obs_size;
+        header.act_size = act_size;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.flush();
+    }
+
+    current = GetFreeChunk();
+    writer = std::thread(&ExperienceRecorder::WriterLoop, this);
+}
+
+ExperienceRecorder::~ExperienceRecorder()
+{
+    try
+    {
+        Flush();
+    }
+    catch (...)
+    {
+
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    writer.join();
+}
+
+void ExperienceRecorder::Record(const torch::Tensor& obs, const torch::Tensor& action, const torch::Tensor& reward,
+    const torch::Tensor& next_obs, const std::vector<TerminalState>& terminal_states,
+    const std::vector<int64_t>& env_ids)
+{
+    CheckWriter();
+
+    const int64_t N = obs.dim() == 2 ? obs.size(0) : 0;
+    if (obs.dim() != 2 || obs.size(1) != obs_size || !next_obs.sizes().equals(obs.sizes()) ||
+        action.dim() != 2 || action.size(0) != N || action.size(1) != act_size || reward.numel() != N)
+    {
+        throw std::runtime_error("ExperienceRecorder needs {N, " + std::to_string(obs_size) + "} obs and next obs, {N, " +
+            std::to_string(act_size) + "} actions and N rewards");
+    }
+    if (static_cast<int64_t>(terminal_states.size()) != N || static_cast<int64_t>(env_ids.size()) != N)
+    {
+        throw std::runtime_error("ExperienceRecorder needs one terminal state and one env id per transition");
+    }
+
+    // No copy if the tensors are already contiguous float on the CPU
+    const torch::Tensor obs_cpu = obs.to(torch::kCPU, torch::kFloat).contiguous();
+    const torch::Tensor action_cpu = action.to(torch::kCPU, torch::kFloat).contiguous();
+    const torch::Tensor reward_cpu = reward.to(torch::kCPU, torch::kFloat).contiguous();
+    const torch::Tensor next_obs_cpu = next_obs.to(torch::kCPU, torch::kFloat).contiguous();
+    const float* obs_data = obs_cpu.data_ptr<float>();
+    const float* action_data = action_cpu.data_ptr<float>();
+    const float* reward_data = reward_cpu.data_ptr<float>();
+    const float* next_obs_data = next_obs_cpu.data_ptr<float>();
+
+    // Rows are copied in runs, split at the chunk boundaries
+    int64_t n = 0;
+    while (n < N)
+    {
+        const int64_t row = current->num_rows;
+        const int64_t count = std::min(N - n, chunk_size - row);
+        std::copy(obs_data + n * obs_size, obs_data + (n + count) * obs_size, current->obs.data() + row * obs_size);
+        std::copy(action_data + n * act_size, action_data + (n + count) * act_size, current->action.data() + row * act_size);
+        std::copy(reward_data + n, reward_data + n + count, current->reward.data() + row);
+        std::copy(next_obs_data + n * obs_size, next_obs_data + (n + count) * obs_size, current->next_obs.data() + row * obs_size);
+        std::copy(env_ids.begin() + n, env_ids.begin() + n + count, current->env_id.data() + row);
+        for (int64_t k = 0; k < count; ++k)
+        {
+            current->terminal_state[row + k] = static_cast<uint8_t>(terminal_states[n + k]);
+        }
+        current->num_rows += count;
+        n += count;
+
+        if (current->num_rows == chunk_size)
+        {
+            SubmitChunk();
+        }
+    }
+    num_recorded += N;
+}
+
+void ExperienceRecorder::Flush()
+{
+    SubmitChunk();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return writer_exception || (pending.empty() && !writing); });
+    }
+    CheckWriter();
+}
+
+int64_t ExperienceRecorder::GetNumRecorded() const
+{
+    return num_recorded;
+}
+
+int64_t ExperienceRecorder::GetObservationSize() const
+{
+    return obs_size;
+}
+
+int64_t ExperienceRecorder::GetActionSize() const
+{
+    return act_size;
+}
+
+std::unique_ptr<ExperienceRecorder::Chunk> ExperienceRecorder::GetFreeChunk()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!free_chunks.empty())
+        {
+            std::unique_ptr<Chunk> chunk = std::move(free_chunks.back());
+            free_chunks.pop_back();
+            chunk->num_rows = 0;
+            return chunk;
+        }
+    }
+
+    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>();
+    chunk->obs.resize(chunk_size * obs_size);
+    chunk->action.resize(chunk_size * act_size);
+    chunk->reward.resize(chunk_size);
+    chunk->next_obs.resize(chunk_size * obs_size);
+    chunk->env_id.resize(chunk_size);
+    chunk->terminal_state.resize(chunk_size);
+    return chunk;
+}
+
+void ExperienceRecorder::SubmitChunk()
+{
+    if (current->num_rows == 0)
+    {
+        return;
+    }
+
+    {
+        // Block the env loop only if the disk can't keep up
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return writer_exception || static_cast<int64_t>(pending.size()) < max_pending_chunks; });
+        if (writer_exception)
+        {
+            lock.unlock();
+            CheckWriter();
+        }
+        pending.push_back(std::move(current));
+    }
+    condition.notify_all();
+    current = GetFreeChunk();
+}
+
+void ExperienceRecorder::WriteChunk(const Chunk& chunk)
+{
+    const ExperienceChunkLayout layout(chunk.num_rows, obs_size, act_size);
+    ExperienceChunkHeader header = {};
+    std::memcpy(header.magic, experience_chunk_magic, sizeof(experience_chunk_magic));
+    header.num_rows = chunk.num_rows;
+    header.payload_size = layout.payload_size;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Only the first num_rows rows of each column are written, followed by their padding
+    const char zeros[column_alignment] = {};
+    const std::pair<const void*, int64_t> columns[] = {
+        { chunk.obs.data(), chunk.num_rows * obs_size * static_cast<int64_t>(sizeof(float)) },
+        { chunk.action.data(), chunk.num_rows * act_size * static_cast<int64_t>(sizeof(float)) },
+        { chunk.reward.data(), chunk.num_rows * static_cast<int64_t>(sizeof(float)) },
+        { chunk.next_obs.data(), chunk.num_rows * obs_size * static_cast<int64_t>(sizeof(float)) },
+        { chunk.env_id.data(), chunk.num_rows * static_cast<int64_t>(sizeof(int64_t)) },
+        { chunk.terminal_state.data(), chunk.num_rows * static_cast<int64_t>(sizeof(uint8_t)) }
+    };
+    for (const auto& [data, size] : columns)
+    {
+        file.write(static_cast<const char*>(data), size);
+        file.write(zeros, AlignedSize(size) - size);
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("Can't write in experience file " + path);
+    }
+}
+
+void ExperienceRecorder::WriterLoop()
+{
+    while (true)
+    {
+        std::unique_ptr<Chunk> chunk;
+        bool last = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return stop || !pending.empty(); });
+            if (pending.empty())
+            {
+                return;
+            }
+            chunk = std::move(pending.front());
+            pending.pop_front();
+            last = pending.empty();
+            writing = true;
+        }
+        // Room in pending for the recording thread
+        condition.notify_all();
+
+        std::exception_ptr exception;
+        try
+        {
+            WriteChunk(*chunk);
+            // Readers only see complete chunks once they are flushed
+            if (last)
+            {
+                file.flush();
+            }
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            writing = false;
+            free_chunks.push_back(std::move(chunk));
+            if (exception && !writer_exception)
+            {
+                writer_exception = exception;
+            }
+        }
+        condition.notify_all();
+    }
+}
+
+void ExperienceRecorder::CheckWriter()
+{
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exception = writer_exception;
+    }
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
@@ -1,10 +1,20 @@
 #include "torchrl/envs/RunningMeanStd.hpp"
 
-RunningMeanStd::RunningMeanStd(const c10::IntArrayRef shape, const float epsilon)
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+
+RunningMeanStd::RunningMeanStd(const c10::IntArrayRef shape_, const float epsilon)
 {
-    mean = torch::zeros(shape).set_requires_grad(false);
-    var = torch::ones(shape).set_requires_grad(false);
+    shape = shape_.vec();
+    const int64_t D = std::accumulate(shape.begin(), shape.end(), int64_t{ 1 }, std::multiplies<int64_t>());
+    mean = std::vector<double>(D, 0.0);
+    var = std::vector<double>(D, 1.0);
     count = epsilon;
+    inv_std_epsilon = 0.0f;
+    cache_dirty = true;
 }
 
 RunningMeanStd::~RunningMeanStd()
@@ -12,40 +22,224 @@ RunningMeanStd::~RunningMeanStd()
 
 }
 
-const torch::Tensor& RunningMeanStd::GetMean() const
+torch::Tensor RunningMeanStd::GetMean() const
 {
-    return mean;
+    return torch::from_blob(const_cast<double*>(mean.data()), shape, torch::kDouble).to(torch::kFloat);
 }
 
-const torch::Tensor& RunningMeanStd::GetVar() const
+torch::Tensor RunningMeanStd::GetVar() const
 {
-    return var;
+    return torch::from_blob(const_cast<double*>(var.data()), shape, torch::kDouble).to(torch::kFloat);
+}
+
+double RunningMeanStd::GetCount() const
+{
+    return count;
 }
 
 void RunningMeanStd::Update(const torch::Tensor& batch)
 {
     torch::NoGradGuard no_grad;
 
-    torch::Tensor delta = batch.mean(0) - mean;
-    const int64_t N = batch.size(0);
-    const float tot_count = count + N;
+    const torch::Tensor data = batch.to(torch::kCPU, torch::kFloat).contiguous();
+    if (data.numel() != data.size(0) * static_cast<int64_t>(mean.size()))
+    {
+        throw std::runtime_error("Batch of size " + std::to_string(data.numel()) + " can't be split in samples of size " + std::to_string(mean.size()) + " in RunningMeanStd");
+    }
+    Update(data.data_ptr<float>(), data.size(0));
+}
+
+void RunningMeanStd::Update(const float* batch, const int64_t N)
+{
+    if (N == 0)
+    {
+        return;
+    }
+
+    const int64_t D = mean.size();
+
+    // Sums of the batch shifted by the current mean, so the
+    // variance doesn't suffer from catastrophic cancellation
+    batch_mean.assign(D, 0.0);
+    batch_var.assign(D, 0.0);
+    for (int64_t i = 0; i < N; ++i)
+    {
+        const float* sample = batch + i * D;
+        for (int64_t j = 0; j < D; ++j)
+        {
+            const double d = sample[j] - mean[j];
+            batch_mean[j] += d;
+            batch_var[j] += d * d;
+        }
+    }
+    for (int64_t j = 0; j < D; ++j)
+    {
+        const double shifted_mean = batch_mean[j] / N;
+        batch_var[j] = std::max(0.0, batch_var[j] / N - shifted_mean * shifted_mean);
+        batch_mean[j] = mean[j] + shifted_mean;
+    }
+
+    Combine(batch_mean.data(), batch_var.data(), static_cast<double>(N));
+}
+
+void RunningMeanStd::Merge(const RunningMeanStd& other)
+{
+    if (other.mean.size() != mean.size())
+    {
+        throw std::runtime_error("Can't merge RunningMeanStd of size " + std::to_string(other.mean.size()) + " into one of size " + std::to_string(mean.size()));
+    }
+
+    Combine(other.mean.data(), other.var.data(), other.count);
+}
+
+RunningMeanStd RunningMeanStd::Reduce(const std::vector<RunningMeanStd>& stats)
+{
+    if (stats.empty())
+    {
+        throw std::runtime_error("Can't reduce an empty list of RunningMeanStd");
+    }
+
+    std::vector<RunningMeanStd> level = stats;
+    while (level.size() > 1)
+    {
+        std::vector<RunningMeanStd> next;
+        next.reserve((level.size() + 1) / 2);
+        for (size_t i = 0; i < level.size(); i += 2)
+        {
+            if (i + 1 < level.size())
+            {
+                level[i].Merge(level[i + 1]);
+            }
+            next.push_back(std::move(level[i]));
+        }
+        level = std::move(next);
+    }
+
+    return level[0];
+}
+
+torch::Tensor RunningMeanStd::GetState() const
+{
+    const int64_t D = mean.size();
+    torch::Tensor state = torch::empty({ 2 * D + 1 }, torch::kDouble);
+    double* state_data = state.data_ptr<double>();
+    state_data[0] = count;
+    std::copy(mean.begin(), mean.end(), state_data + 1);
+    std::copy(var.begin(), var.end(), state_data + 1 + D);
+    return state;
+}
+
+torch::Tensor RunningMeanStd::SubtractState(const torch::Tensor& state, const torch::Tensor& base)
+{
+    const int64_t D = (state.numel() - 1) / 2;
+    torch::Tensor output = torch::zeros_like(state);
+    const double* s = state.data_ptr<double>();
+    const double* b = base.data_ptr<double>();
+    double* o = output.data_ptr<double>();
+
+    const double count = s[0];
+    const double base_count = b[0];
+    const double new_count = count - base_count;
+    // Relative threshold, as counts are not integers
+    if (new_count <= 1e-6 * count)
+    {
+        return output;
+    }
 
-    mean = mean + delta * N / tot_count;
-    var = (var * count + batch.var(0, false) * N + delta * delta * count * N / tot_count) / tot_count;
+    o[0] = new_count;
+    for (int64_t j = 0; j < D; ++j)
+    {
+        const double new_mean = b[1 + j] + (s[1 + j] - b[1 + j]) * count / new_count;
+        const double delta = new_mean - b[1 + j];
+        const double new_m2 = s[1 + D + j] * count - b[1 + D + j] * base_count - delta * delta * base_count * new_count / count;
+        o[1 + j] = new_mean;
+        o[1 + D + j] = std::max(0.0, new_m2 / new_count);
+    }
+    return output;
+}
+
+void RunningMeanStd::SetState(const torch::Tensor& state)
+{
+    const int64_t D = mean.size();
+    if (state.numel() != 2 * D + 1)
+    {
+        throw std::runtime_error("Wrong state size (" + std::to_string(state.numel()) + ") for a RunningMeanStd of size " + std::to_string(D));
+    }
+    const torch::Tensor contiguous_state = state.to(torch::kCPU, torch::kDouble).contiguous();
+    const double* state_data = contiguous_state.data_ptr<double>();
+    count = state_data[0];
+    std::copy(state_data + 1, state_data + 1 + D, mean.begin());
+    std::copy(state_data + 1 + D, state_data + 1 + 2 * D, var.begin());
+    cache_dirty = true;
+}
+
+void RunningMeanStd::Combine(const double* other_mean, const double* other_var, const double other_count)
+{
+    if (other_count <= 0.0)
+    {
+        return;
+    }
+
+    const double tot_count = count + other_count;
+    for (size_t j = 0; j < mean.size(); ++j)
+    {
+        const double delta = other_mean[j] - mean[j];
+        mean[j] += delta * other_count / tot_count;
+        var[j] = (var[j] * count + other_var[j] * other_count + delta * delta * count * other_count / tot_count) / tot_count;
+    }
     count = tot_count;
+    cache_dirty = true;
+}
+
+void RunningMeanStd::Normalize(float* batch, const int64_t N, const float epsilon, const float clip, const bool center) const
+{
+    const int64_t D = mean.size();
+    if (cache_dirty || epsilon != inv_std_epsilon)
+    {
+        cached_mean.resize(D);
+        inv_std.resize(D);
+        for (int64_t j = 0; j < D; ++j)
+        {
+            cached_mean[j] = static_cast<float>(mean[j]);
+            inv_std[j] = 1.0f / std::sqrt(static_cast<float>(var[j]) + epsilon);
+        }
+        inv_std_epsilon = epsilon;
+        cache_dirty = false;
+    }
+
+    const float* mean_data = cached_mean.data();
+    const float* inv_std_data = inv_std.data();
+    for (int64_t i = 0; i < N; ++i)
+    {
+        float* sample = batch + i * D;
+        for (int64_t j = 0; j < D; ++j)
+        {
+            const float x = center ? sample[j] - mean_data[j] : sample[j];
+            sample[j] = std::min(std::max(x * inv_std_data[j], -clip), clip);
+        }
+    }
 }
 
 void RunningMeanStd::Save(const std::string& path) const
 {
-    torch::save({ mean, var, torch::zeros({}) + count }, path);
+    // Same layout as before the switch to double precision, only the dtypes changed
+    torch::save({
+        torch::from_blob(const_cast<double*>(mean.data()), shape, torch::kDouble).clone(),
+        torch::from_blob(const_cast<double*>(var.data()), shape, torch::kDouble).clone(),
+        torch::zeros({}, torch::kDouble) + count
+    }, path);
 }
 
 void RunningMeanStd::Load(const std::string& path)
 {
     std::vector<torch::Tensor> data;
     torch::load(data, path);
-    mean = data[0];
-    var = data[1];
-    count = data[2].item<float>();
+    // Files saved with float statistics are converted
+    const torch::Tensor loaded_mean = data[0].to(torch::kCPU, torch::kDouble).contiguous();
+    const torch::Tensor loaded_var = data[1].to(torch::kCPU, torch::kDouble).contiguous();
+    shape = loaded_mean.sizes().vec();
+    mean.assign(loaded_mean.data_ptr<double>(), loaded_mean.data_ptr<double>() + loaded_mean.numel());
+    var.assign(loaded_var.data_ptr<double>(), loaded_var.data_ptr<double>() + loaded_var.numel());
+    count = data[2].to(torch::kDouble).item<double>();
+    cache_dirty = true;
 }
-
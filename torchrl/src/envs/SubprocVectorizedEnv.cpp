@@ -0,0 +1,607 @@
+#include "torchrl/envs/SubprocVectorizedEnv.hpp"
+
+#include <atomic>
+#include <iostream>
+
+#ifdef __linux__
+#include <chrono>
+#include <climits>
+#include <filesystem>
+#include <iterator>
+#include <thread>
+
+#include <linux/futex.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    enum class WorkerCommand : uint32_t
+    {
+        Reset,
+        Step,
+        GetObs,
+        Render,
+        Exit
+    };
+
+    /// @brief Header at the beginning of each worker shared memory.
+    /// The main process writes the command then increments command_seq,
+    /// the worker sets done_seq to the same value once it's done.
+    /// exited is set by the spawner process when the worker dies
+    struct alignas(64) ChannelHeader
+    {
+        std::atomic<uint32_t> command_seq;
+        std::atomic<uint32_t> done_seq;
+        std::atomic<uint32_t> exited;
+        uint32_t command;
+    };
+
+    /// @brief Message sent to the spawner process to start a worker
+    struct SpawnRequest
+    {
+        int64_t worker;
+        unsigned int seed;
+    };
+
+    /// @brief Max number of consecutive crashes before giving up on a worker
+    constexpr int max_restart_attempts = 5;
+}
+
+struct SubprocVectorizedEnv::Worker
+{
+    int pid = -1;
+    /// @brief Range of the envs hosted by this worker
+    int64_t begin = 0;
+    int64_t end = 0;
+    uint64_t restarts = 0;
+
+    void* shared = nullptr;
+    size_t shared_size = 0;
+
+    // Pointers in the shared memory
+    ChannelHeader* header = nullptr;
+    uint64_t* tot_steps = nullptr;
+    float* actions = nullptr;
+    float* obs = nullptr;
+    float* new_episode_obs = nullptr;
+    float* rewards = nullptr;
+    float* tot_rewards = nullptr;
+    uint8_t* terminal_states = nullptr;
+};
+
+#ifdef __linux__
+namespace
+{
+    void FutexWait(std::atomic<uint32_t>& value, const uint32_t expected, const timespec* timeout)
+    {
+        // Not FUTEX_PRIVATE as the value is shared between processes
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAIT, expected, timeout, nullptr, 0);
+    }
+
+    void FutexWake(std::atomic<uint32_t>& value)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    /// @brief Send a command to a worker without waiting for it
+    /// @return The sequence number of the command
+    uint32_t Send(ChannelHeader* header, const WorkerCommand command)
+    {
+        header->command = static_cast<uint32_t>(command);
+        const uint32_t seq = header->command_seq.fetch_add(1, std::memory_order_acq_rel) + 1;
+        FutexWake(header->command_seq);
+        return seq;
+    }
+
+    /// @brief Wait for a worker to complete a command
+    /// @param spawner_pid Process that forked the worker, and reports its death
+    /// @return False if the worker died before completing it
+    bool Wait(ChannelHeader* header, const int spawner_pid, const uint32_t seq)
+    {
+        while (true)
+        {
+            const uint32_t done = header->done_seq.load(std::memory_order_acquire);
+            if (done == seq)
+            {
+                return true;
+            }
+
+            // Wake up regularly to check if the worker is still alive
+            const timespec timeout{ 0, 50000000 };
+            FutexWait(header->done_seq, done, &timeout);
+
+            if (header->done_seq.load(std::memory_order_acquire) != seq)
+            {
+                if (header->exited.load(std::memory_order_acquire) != 0)
+                {
+                    return false;
+                }
+                // Workers are killed with the spawner, and nobody would report their death
+                int status;
+                if (waitpid(spawner_pid, &status, WNOHANG) != 0)
+                {
+                    throw std::runtime_error("SubprocVectorizedEnv spawner process died");
+                }
+            }
+        }
+    }
+
+    /// @brief Get the number of threads of this process
+    size_t CountThreads()
+    {
+        return std::distance(std::filesystem::directory_iterator("/proc/self/task"), std::filesystem::directory_iterator());
+    }
+
+    [[noreturn]] void WorkerMain(const std::function<std::unique_ptr<AbstractEnv>(const unsigned int)>& env_factory,
+        ChannelHeader* header, const uint32_t initial_seq, const int64_t begin, const int64_t end, const unsigned int seed,
+        const int64_t obs_size, const int64_t act_size,
+        uint64_t* tot_steps, float* actions, float* obs, float* new_episode_obs,
+        float* rewards, float* tot_rewards, uint8_t* terminal_states)
+    {
+        // Don't outlive the spawner (and thus the main) process
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        // Only this thread has been forked, don't let libtorch use others
+        torch::set_num_threads(1);
+
+        int exit_code = 0;
+        try
+        {
+            std::vector<std::unique_ptr<AbstractEnv>> envs;
+            envs.reserve(end - begin);
+            for (int64_t i = begin; i < end; ++i)
+            {
+                envs.push_back(env_factory(seed + static_cast<unsigned int>(i)));
+            }
+
+            // Commands sent while the envs were created are still to be run
+            uint32_t seen = initial_seq;
+            while (true)
+            {
+                uint32_t seq = header->command_seq.load(std::memory_order_acquire);
+                while (seq == seen)
+                {
+                    FutexWait(header->command_seq, seen, nullptr);
+                    seq = header->command_seq.load(std::memory_order_acquire);
+                }
+                seen = seq;
+
+                const WorkerCommand command = static_cast<WorkerCommand>(header->command);
+                if (command == WorkerCommand::Exit)
+                {
+                    break;
+                }
+
+                for (int64_t k = 0; k < static_cast<int64_t>(envs.size()); ++k)
+                {
+                    switch (command)
+                    {
+                    case WorkerCommand::Reset:
+                        envs[k]->Reset(obs + k * obs_size);
+                        break;
+                    case WorkerCommand::Step:
+                    {
+                        const StepResult res = envs[k]->Step(actions + k * act_size, obs + k * obs_size, new_episode_obs + k * obs_size);
+                        rewards[k] = res.reward;
+                        terminal_states[k] = static_cast<uint8_t>(res.terminal_state);
+                        tot_rewards[k] = res.tot_reward;
+                        tot_steps[k] = res.tot_steps;
+                        break;
+                    }
+                    case WorkerCommand::GetObs:
+                        envs[k]->WriteObs(obs + k * obs_size);
+                        break;
+                    case WorkerCommand::Render:
+                        envs[k]->Render();
+                        break;
+                    default:
+                        break;
+                    }
+                }
+
+                header->done_seq.store(seq, std::memory_order_release);
+                FutexWake(header->done_seq);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error in SubprocVectorizedEnv worker: " << e.what() << std::endl;
+            exit_code = 1;
+        }
+
+        // Skip all the destructors/atexit handlers inherited from the main process
+        _exit(exit_code);
+    }
+}
+#endif
+
+SubprocVectorizedEnv::SubprocVectorizedEnv(
+    const bool norm_obs_, const bool norm_reward_,
+    const float max_obs_, const float max_reward_,
+    const float discount_factor_, const float epsilon_
+) : VectorizedEnv(norm_obs_, norm_reward_, max_obs_, max_reward_, discount_factor_, epsilon_)
+{
+    seed = 0;
+    num_restarts = 0;
+    spawner_pid = -1;
+    spawner_socket = -1;
+}
+
+SubprocVectorizedEnv::~SubprocVectorizedEnv()
+{
+    StopWorkers();
+}
+
+uint64_t SubprocVectorizedEnv::GetNumRestarts() const
+{
+    return num_restarts;
+}
+
+void SubprocVectorizedEnv::ResetEnvs(torch::Tensor& obs)
+{
+    RunCommand(static_cast<uint32_t>(WorkerCommand::Reset));
+    for (const Worker& w : workers)
+    {
+        obs.slice(0, w.begin, w.end).copy_(torch::from_blob(w.obs, { w.end - w.begin, obs_size }));
+    }
+}
+
+void SubprocVectorizedEnv::StepEnvs(const torch::Tensor& action, VectorizedStepResult& result)
+{
+    // Write the actions directly in the workers memory
+    const torch::Tensor actions = action.to(torch::kFloat).contiguous();
+    const float* actions_data = actions.data_ptr<float>();
+    for (Worker& w : workers)
+    {
+        std::copy(actions_data + w.begin * act_size, actions_data + w.end * act_size, w.actions);
+    }
+
+    const std::vector<bool> crashed = RunCommand(static_cast<uint32_t>(WorkerCommand::Step));
+
+    float* obs = result.obs.data_ptr<float>();
+    float* rewards = result.rewards.data_ptr<float>();
+    float* new_episode_obs = result.new_episode_obs.data_ptr<float>();
+    for (size_t j = 0; j < workers.size(); ++j)
+    {
+        const Worker& w = workers[j];
+        const int64_t n = w.end - w.begin;
+        std::copy(w.obs, w.obs + n * obs_size, obs + w.begin * obs_size);
+        for (int64_t k = 0; k < n; ++k)
+        {
+            const int64_t i = w.begin + k;
+            if (crashed[j])
+            {
+                // Worker has been restarted, obs is the one of the new episode. Reported
+                // as Terminal as the last obs of the lost episode can't be bootstrapped
+                rewards[i] = 0.0f;
+                result.terminal_states[i] = TerminalState::Terminal;
+                std::copy(w.obs + k * obs_size, w.obs + (k + 1) * obs_size, new_episode_obs + i * obs_size);
+                result.episodes_tot_reward[i] = 0.0f;
+                result.episodes_tot_length[i] = 0;
+            }
+            else
+            {
+                rewards[i] = w.rewards[k];
+                result.terminal_states[i] = static_cast<TerminalState>(w.terminal_states[k]);
+                if (result.terminal_states[i] != TerminalState::NotTerminal)
+                {
+                    std::copy(w.new_episode_obs + k * obs_size, w.new_episode_obs + (k + 1) * obs_size, new_episode_obs + i * obs_size);
+                    result.episodes_tot_reward[i] = w.tot_rewards[k];
+                    result.episodes_tot_length[i] = w.tot_steps[k];
+                }
+                else
+                {
+                    result.episodes_tot_reward[i] = 0.0f;
+                    result.episodes_tot_length[i] = 0;
+                }
+            }
+        }
+    }
+}
+
+void SubprocVectorizedEnv::StepEnvsAsync(const torch::Tensor& action, const std::vector<int64_t>& env_ids)
+{
+    throw std::runtime_error("Asynchronous steps are not supported by SubprocVectorizedEnv");
+}
+
+void SubprocVectorizedEnv::GetEnvsObs(torch::Tensor& obs) const
+{
+    RunCommand(static_cast<uint32_t>(WorkerCommand::GetObs));
+    for (const Worker& w : workers)
+    {
+        obs.slice(0, w.begin, w.end).copy_(torch::from_blob(w.obs, { w.end - w.begin, obs_size }));
+    }
+}
+
+void SubprocVectorizedEnv::RenderEnvs()
+{
+    RunCommand(static_cast<uint32_t>(WorkerCommand::Render));
+}
+
+void SubprocVectorizedEnv::StartWorkers(const std::function<std::unique_ptr<AbstractEnv>(const unsigned int)>& env_factory_,
+    const int N, const int num_workers, const unsigned int seed_)
+{
+#ifdef __linux__
+    StopWorkers();
+
+    // Locks held by other threads at fork time would never be released in the children
+    if (CountThreads() > 1)
+    {
+        throw std::runtime_error("SubprocVectorizedEnv envs must be created before any other thread is started in the process");
+    }
+
+    env_factory = env_factory_;
+    seed = seed_;
+
+    // Create one env in this process to get the dimensions
+    int64_t env_obs_size = 0;
+    int64_t env_act_size = 0;
+    {
+        std::unique_ptr<AbstractEnv> env = env_factory(seed);
+        env_obs_size = env->GetObservationSize();
+        env_act_size = env->GetActionSize();
+    }
+    obs_size = env_obs_size;
+    act_size = env_act_size;
+    num_envs = N;
+
+    const int n_workers = std::max(1, std::min(num_workers, N));
+    workers = std::vector<Worker>(n_workers);
+    for (int j = 0; j < n_workers; ++j)
+    {
+        Worker& w = workers[j];
+        w.begin = static_cast<int64_t>(j) * N / n_workers;
+        w.end = static_cast<int64_t>(j + 1) * N / n_workers;
+        const int64_t n = w.end - w.begin;
+
+        // Layout of the shared memory, each array aligned on a cache line
+        size_t size = 0;
+        auto reserve = [&](const size_t bytes)
+        {
+            const size_t offset = size;
+            size += (bytes + 63) / 64 * 64;
+            return offset;
+        };
+        const size_t header_offset = reserve(sizeof(ChannelHeader));
+        const size_t tot_steps_offset = reserve(n * sizeof(uint64_t));
+        const size_t actions_offset = reserve(n * act_size * sizeof(float));
+        const size_t obs_offset = reserve(n * obs_size * sizeof(float));
+        const size_t new_episode_obs_offset = reserve(n * obs_size * sizeof(float));
+        const size_t rewards_offset = reserve(n * sizeof(float));
+        const size_t tot_rewards_offset = reserve(n * sizeof(float));
+        const size_t terminal_states_offset = reserve(n * sizeof(uint8_t));
+
+        // Anonymous shared mapping, inherited by the forked workers
+        w.shared = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (w.shared == MAP_FAILED)
+        {
+            w.shared = nullptr;
+            throw std::runtime_error("Can't allocate shared memory for SubprocVectorizedEnv worker");
+        }
+        w.shared_size = size;
+
+        char* base = static_cast<char*>(w.shared);
+        w.header = new (base + header_offset) ChannelHeader();
+        w.header->command_seq = 0;
+        w.header->done_seq = 0;
+        w.header->exited = 0;
+        w.tot_steps = reinterpret_cast<uint64_t*>(base + tot_steps_offset);
+        w.actions = reinterpret_cast<float*>(base + actions_offset);
+        w.obs = reinterpret_cast<float*>(base + obs_offset);
+        w.new_episode_obs = reinterpret_cast<float*>(base + new_episode_obs_offset);
+        w.rewards = reinterpret_cast<float*>(base + rewards_offset);
+        w.tot_rewards = reinterpret_cast<float*>(base + tot_rewards_offset);
+        w.terminal_states = reinterpret_cast<uint8_t*>(base + terminal_states_offset);
+    }
+
+    // All the workers, including the restarted ones, are forked by a single threaded
+    // spawner forked now, as this process will use libtorch and thread pools later
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    {
+        throw std::runtime_error("Can't create SubprocVectorizedEnv spawner socket");
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(sockets[0]);
+        close(sockets[1]);
+        throw std::runtime_error("Can't fork SubprocVectorizedEnv spawner");
+    }
+    if (pid == 0)
+    {
+        close(sockets[0]);
+        SpawnerMain(sockets[1]);
+    }
+    close(sockets[1]);
+    spawner_pid = pid;
+    spawner_socket = sockets[0];
+
+    Init(N, env_obs_size, env_act_size);
+
+    for (Worker& w : workers)
+    {
+        Spawn(w);
+    }
+#else
+    throw std::runtime_error("SubprocVectorizedEnv is only available on Linux");
+#endif
+}
+
+void SubprocVectorizedEnv::StopWorkers()
+{
+#ifdef __linux__
+    for (Worker& w : workers)
+    {
+        if (w.pid > 0)
+        {
+            Send(w.header, WorkerCommand::Exit);
+        }
+    }
+
+    // Give them some time to exit properly, the remaining ones
+    // are killed with the spawner when its socket is closed
+    for (Worker& w : workers)
+    {
+        for (int i = 0; i < 100 && w.pid > 0 && w.header->exited.load(std::memory_order_acquire) == 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        w.pid = -1;
+    }
+
+    if (spawner_pid > 0)
+    {
+        close(spawner_socket);
+        int status;
+        waitpid(spawner_pid, &status, 0);
+        spawner_pid = -1;
+        spawner_socket = -1;
+    }
+
+    for (Worker& w : workers)
+    {
+        if (w.shared != nullptr)
+        {
+            munmap(w.shared, w.shared_size);
+            w.shared = nullptr;
+        }
+    }
+#endif
+    workers.clear();
+}
+
+void SubprocVectorizedEnv::Spawn(Worker& w) const
+{
+#ifdef __linux__
+    // Each restart gets new seeds so it doesn't replay the same episodes
+    const SpawnRequest request{ &w - workers.data(), seed + static_cast<unsigned int>(w.restarts * num_envs) };
+
+    // Don't duplicate pending output in the child
+    std::cout.flush();
+    std::cerr.flush();
+
+    // The previous worker of this slot has been reported dead already
+    w.header->exited.store(0, std::memory_order_release);
+
+    pid_t pid = -1;
+    if (send(spawner_socket, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request) ||
+        recv(spawner_socket, &pid, sizeof(pid), MSG_WAITALL) != sizeof(pid) || pid < 0)
+    {
+        throw std::runtime_error("Can't fork SubprocVectorizedEnv worker");
+    }
+    w.pid = pid;
+#endif
+}
+
+void SubprocVectorizedEnv::SpawnerMain(const int socket) const
+{
+#ifdef __linux__
+    // Don't outlive the main process, the workers are then killed too
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+    std::vector<pid_t> pids(workers.size(), -1);
+    while (true)
+    {
+        pollfd poll_fd{ socket, POLLIN, 0 };
+        const int ready = poll(&poll_fd, 1, 50);
+
+        // Report the dead workers to the main process
+        int status;
+        pid_t dead;
+        while ((dead = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            for (size_t j = 0; j < pids.size(); ++j)
+            {
+                if (pids[j] == dead)
+                {
+                    pids[j] = -1;
+                    workers[j].header->exited.store(1, std::memory_order_release);
+                    FutexWake(workers[j].header->done_seq);
+                }
+            }
+        }
+
+        if (ready <= 0)
+        {
+            continue;
+        }
+
+        // Socket closed by the main process
+        SpawnRequest request;
+        if (recv(socket, &request, sizeof(request), MSG_WAITALL) != sizeof(request))
+        {
+            break;
+        }
+
+        const Worker& w = workers[request.worker];
+        // Read before forking, so a command sent right after Spawn returns
+        // is not mistaken for an old one by a child still creating its envs
+        const uint32_t initial_seq = w.header->command_seq.load(std::memory_order_acquire);
+
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(socket);
+            WorkerMain(env_factory, w.header, initial_seq, w.begin, w.end, request.seed, obs_size, act_size,
+                w.tot_steps, w.actions, w.obs, w.new_episode_obs, w.rewards, w.tot_rewards, w.terminal_states);
+        }
+        pids[request.worker] = pid;
+        send(socket, &pid, sizeof(pid), MSG_NOSIGNAL);
+    }
+    _exit(0);
+#endif
+}
+
+std::vector<bool> SubprocVectorizedEnv::RunCommand(const uint32_t command) const
+{
+    std::vector<bool> crashed(workers.size(), false);
+#ifdef __linux__
+    std::vector<uint32_t> seqs(workers.size());
+    for (size_t j = 0; j < workers.size(); ++j)
+    {
+        seqs[j] = Send(workers[j].header, static_cast<WorkerCommand>(command));
+    }
+
+    for (size_t j = 0; j < workers.size(); ++j)
+    {
+        Worker& w = workers[j];
+        if (Wait(w.header, spawner_pid, seqs[j]))
+        {
+            continue;
+        }
+
+        // Worker died, restart it with new envs, that need to be reset
+        crashed[j] = true;
+        bool restarted = false;
+        for (int attempt = 0; attempt < max_restart_attempts && !restarted; ++attempt)
+        {
+            std::cerr << "Warning, SubprocVectorizedEnv worker for envs [" << w.begin << ", " << w.end << ") crashed, restarting it" << std::endl;
+            w.restarts += 1;
+            num_restarts += 1;
+            Spawn(w);
+            restarted = Wait(w.header, spawner_pid, Send(w.header, WorkerCommand::Reset));
+        }
+        if (!restarted)
+        {
+            w.pid = -1;
+            throw std::runtime_error("SubprocVectorizedEnv worker for envs [" + std::to_string(w.begin) + ", " + std::to_string(w.end) + ") keeps crashing");
+        }
+
+        if (static_cast<WorkerCommand>(command) == WorkerCommand::Render)
+        {
+            Wait(w.header, spawner_pid, Send(w.header, WorkerCommand::Render));
+        }
+    }
+#endif
+    return crashed;
+}
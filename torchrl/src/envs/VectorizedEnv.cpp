@@ -1,6 +1,8 @@
 #include "torchrl/envs/VectorizedEnv.hpp"
+#include "torchrl/envs/ExperienceRecorder.hpp"
 
 #include <filesystem>
+#include <numeric>
 
 VectorizedEnv::VectorizedEnv(
     const bool norm_obs_, const bool norm_reward_,
@@ -19,11 +21,38 @@ VectorizedEnv::VectorizedEnv(
     max_reward = max_reward_;
     discount_factor = discount_factor_;
     epsilon = epsilon_;
+
+    num_stepping = 0;
+    async_step_task = [this](const int64_t begin, const int64_t end)
+    {
+        for (int64_t i = begin; i < end; ++i)
+        {
+            StepAsyncEnv(i);
+        }
+    };
+
+    reuse_buffers = false;
+    step_output = nullptr;
+
+    recorder = nullptr;
+    record_normalized = false;
+    step_task = [this](const int64_t begin, const int64_t end)
+    {
+        StepEnvsRange(begin, end);
+    };
 }
 
 VectorizedEnv::~VectorizedEnv()
 {
+    // Make sure no pool task is still using this object
+    try
+    {
+        async_tasks.Wait();
+    }
+    catch (...)
+    {
 
+    }
 }
 
 void VectorizedEnv::SetTraining(const bool b)
@@ -31,6 +60,30 @@ void VectorizedEnv::SetTraining(const bool b)
     training = b;
 }
 
+void VectorizedEnv::SetReuseBuffers(const bool b)
+{
+    reuse_buffers = b;
+    // Buffers will be (re)allocated at next step
+    step_result = VectorizedStepResult();
+}
+
+void VectorizedEnv::SetNumThreads(const int n)
+{
+    if (n > 1)
+    {
+        thread_pool = std::make_unique<ThreadPool>(n - 1);
+    }
+    else
+    {
+        thread_pool.reset();
+    }
+}
+
+int VectorizedEnv::GetNumThreads() const
+{
+    return thread_pool ? thread_pool->GetNumThreads() + 1 : 1;
+}
+
 int64_t VectorizedEnv::GetNumEnvs() const
 {
     return num_envs;
@@ -46,95 +99,241 @@ int64_t VectorizedEnv::GetActionSize() const
     return act_size;
 }
 
+RunningMeanStd& VectorizedEnv::GetObsNormalizer()
+{
+    return obs_rms;
+}
+
+const RunningMeanStd& VectorizedEnv::GetObsNormalizer() const
+{
+    return obs_rms;
+}
+
+bool VectorizedEnv::GetNormObs() const
+{
+    return norm_obs;
+}
+
+float VectorizedEnv::GetMaxObs() const
+{
+    return max_obs;
+}
+
+float VectorizedEnv::GetEpsilon() const
+{
+    return epsilon;
+}
+
+RunningMeanStd& VectorizedEnv::GetRewardNormalizer()
+{
+    return ret_rms;
+}
+
+void VectorizedEnv::SetRecorder(ExperienceRecorder* recorder_, const bool record_normalized_)
+{
+    if (num_stepping > 0)
+    {
+        throw std::runtime_error("Can't set the recorder of VectorizedEnv while some envs are still stepping, call Recv first");
+    }
+
+    if (recorder_ != nullptr && (recorder_->GetObservationSize() != obs_size || recorder_->GetActionSize() != act_size))
+    {
+        throw std::runtime_error("ExperienceRecorder sizes don't match the envs of VectorizedEnv");
+    }
+
+    recorder = recorder_;
+    record_normalized = record_normalized_;
+    if (recorder == nullptr)
+    {
+        recorder_obs = torch::Tensor();
+        recorder_actions = torch::Tensor();
+        return;
+    }
+
+    // First transitions start from the current obs of the envs
+    recorder_obs = torch::zeros({ num_envs, obs_size });
+    GetEnvsObs(recorder_obs);
+    if (record_normalized)
+    {
+        NormalizeObs(recorder_obs.data_ptr<float>(), num_envs);
+    }
+    recorder_actions = torch::zeros({ num_envs, act_size });
+    recorder_env_ids = std::vector<int64_t>(num_envs);
+    std::iota(recorder_env_ids.begin(), recorder_env_ids.end(), 0);
+}
+
 torch::Tensor VectorizedEnv::Reset()
 {
-    torch::Tensor obs = torch::zeros({ num_envs, obs_size });
-    for (int i = 0; i < num_envs; ++i)
+    if (num_stepping > 0)
     {
-        obs[i] = envs[i]->Reset();
+        throw std::runtime_error("Can't reset VectorizedEnv while some envs are still stepping, call Recv first");
     }
 
-    UpdateObs(obs);
+    torch::Tensor obs = torch::zeros({ num_envs, obs_size });
+    ResetEnvs(obs);
+
+    UpdateObs(obs.data_ptr<float>(), num_envs);
 
     if (norm_reward)
     {
         returns = torch::zeros({ num_envs }).set_requires_grad(false);
     }
 
-    return NormalizeObs(obs);
+    if (recorder != nullptr && !record_normalized)
+    {
+        recorder_obs.copy_(obs);
+    }
+    NormalizeObs(obs.data_ptr<float>(), num_envs);
+    if (recorder != nullptr && record_normalized)
+    {
+        recorder_obs.copy_(obs);
+    }
+    return obs;
 }
 
-VectorizedStepResult VectorizedEnv::Step(const torch::Tensor& action)
+const VectorizedStepResult& VectorizedEnv::Step(const torch::Tensor& action)
 {
-    torch::Tensor obs = torch::zeros({ num_envs, obs_size });
-    torch::Tensor normalizer_obs = torch::zeros({ num_envs, obs_size });
-    torch::Tensor rewards = torch::zeros({ num_envs });
-    std::vector<TerminalState> terminal_states(num_envs);
-    std::vector<torch::Tensor> new_episode_obs(num_envs);
-    std::vector<float> tot_reward(num_envs);
-    std::vector<uint64_t> tot_steps(num_envs);
+    if (num_stepping > 0)
+    {
+        throw std::runtime_error("Can't step VectorizedEnv while some envs are still stepping, call Recv first");
+    }
 
-    for (int i = 0; i < num_envs; ++i)
+    // Previous results might still be used by the caller if buffers are not reused
+    if (!reuse_buffers || !step_result.obs.defined())
     {
-        StepResult res = envs[i]->Step(action[i]);
-        obs[i] = res.obs;
-        rewards[i] = res.reward;
-        terminal_states[i] = res.terminal_state;
-        new_episode_obs[i] = res.new_episode_obs;
-        tot_reward[i] = res.tot_reward;
-        tot_steps[i] = res.tot_steps;
+        AllocateResult(step_result, num_envs, reuse_buffers && torch::cuda::is_available());
+    }
 
-        if (norm_obs)
+    StepEnvs(action, step_result);
+
+    if (recorder != nullptr && !record_normalized)
+    {
+        RecordResult(action, step_result, true);
+    }
+
+    NormalizeResult(step_result, step_normalizer_obs, true);
+
+    if (recorder != nullptr && record_normalized)
+    {
+        RecordResult(action, step_result, true);
+    }
+
+    return step_result;
+}
+
+void VectorizedEnv::StepAsync(const torch::Tensor& action, const std::vector<int64_t>& env_ids)
+{
+    // Envs are marked as stepping while checked, so an id appearing twice is rejected
+    for (size_t k = 0; k < env_ids.size(); ++k)
+    {
+        const int64_t i = env_ids[k];
+        if (i < 0 || i >= num_envs || stepping[i])
         {
-            if (res.terminal_state == TerminalState::NotTerminal)
-            {
-                normalizer_obs[i] = res.obs;
-            }
-            else
+            for (size_t j = 0; j < k; ++j)
             {
-                normalizer_obs[i] = res.new_episode_obs;
+                stepping[env_ids[j]] = false;
             }
+            throw std::runtime_error("Env " + std::to_string(i) + " can't be stepped asynchronously in VectorizedEnv");
         }
+        stepping[i] = true;
     }
+    num_stepping += env_ids.size();
 
-    UpdateObs(normalizer_obs);
-    UpdateReward(rewards);
+    try
+    {
+        if (recorder != nullptr)
+        {
+            recorder_actions.index_copy_(0, torch::tensor(env_ids, torch::kLong), action.to(torch::kCPU, torch::kFloat));
+        }
 
-    for (int i = 0; i < num_envs; ++i)
+        StepEnvsAsync(action, env_ids);
+    }
+    catch (...)
     {
-        if (terminal_states[i] != TerminalState::NotTerminal)
+        // Nothing has been launched
+        for (const int64_t i : env_ids)
         {
-            if (norm_obs)
-            {
-                new_episode_obs[i] = NormalizeObs(new_episode_obs[i].unsqueeze(0)).squeeze(0);
-            }
-            if (norm_reward)
+            stepping[i] = false;
+        }
+        num_stepping -= env_ids.size();
+        throw;
+    }
+}
+
+VectorizedStepResult VectorizedEnv::Recv(const int64_t min_batch)
+{
+    if (min_batch < 1 || min_batch > num_stepping)
+    {
+        throw std::runtime_error("Can't wait for " + std::to_string(min_batch) + " envs in VectorizedEnv, " + std::to_string(num_stepping) + " are stepping");
+    }
+
+    std::vector<int64_t> env_ids;
+    {
+        std::unique_lock<std::mutex> lock(ready_mutex);
+        ready_condition.wait(lock, [&] { return async_exception || static_cast<int64_t>(ready_envs.size()) >= min_batch; });
+        if (async_exception)
+        {
+            // Failed envs are not stepping anymore, the other ones can still be received
+            for (const int64_t i : failed_envs)
             {
-                returns[i] = 0.0f;
+                stepping[i] = false;
             }
+            num_stepping -= failed_envs.size();
+            failed_envs.clear();
+            std::exception_ptr e = async_exception;
+            async_exception = nullptr;
+            std::rethrow_exception(e);
         }
+        std::swap(env_ids, ready_envs);
     }
 
-    return VectorizedStepResult{ NormalizeObs(obs), NormalizeReward(rewards), terminal_states, new_episode_obs, tot_reward, tot_steps };
+    const int64_t N = env_ids.size();
+    VectorizedStepResult result;
+    AllocateResult(result, N, false);
+    result.env_ids = env_ids;
+    // Step is not called while envs are stepping, so its normalizer buffer is free
+    torch::Tensor normalizer_obs = step_normalizer_obs.narrow(0, 0, N);
+
+    for (int64_t k = 0; k < N; ++k)
+    {
+        WriteResult(step_results[env_ids[k]], k, result);
+        step_results[env_ids[k]] = StepResult();
+        stepping[env_ids[k]] = false;
+    }
+    num_stepping -= N;
+
+    if (recorder != nullptr && !record_normalized)
+    {
+        RecordResult(recorder_actions, result, false);
+    }
+
+    NormalizeResult(result, normalizer_obs, false);
+
+    if (recorder != nullptr && record_normalized)
+    {
+        RecordResult(recorder_actions, result, false);
+    }
+
+    return result;
+}
+
+int64_t VectorizedEnv::GetNumStepping() const
+{
+    return num_stepping;
 }
 
 void VectorizedEnv::Render(const uint64_t wait_ms)
 {
-    for (int i = 0; i < num_envs; ++i)
-    {
-        envs[i]->Render();
-    }
+    RenderEnvs();
     std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
 }
 
 torch::Tensor VectorizedEnv::GetObs() const
 {
     torch::Tensor obs = torch::zeros({ num_envs, obs_size });
-    for (int i = 0; i < num_envs; ++i)
-    {
-        obs[i] = envs[i]->GetObs();
-    }
-    return NormalizeObs(obs);
+    GetEnvsObs(obs);
+    NormalizeObs(obs.data_ptr<float>(), num_envs);
+    return obs;
 }
 
 void VectorizedEnv::Save(const std::string& path) const
@@ -161,43 +360,363 @@ void VectorizedEnv::Load(const std::string& path)
     }
 }
 
-torch::Tensor VectorizedEnv::NormalizeObs(const torch::Tensor& obs) const
+void VectorizedEnv::Init(const int64_t num_envs_, const int64_t obs_size_, const int64_t act_size_)
 {
+    num_envs = num_envs_;
+    obs_size = obs_size_;
+    act_size = act_size_;
+
+    if (batched_env)
+    {
+        batched_terminal_states = std::vector<uint8_t>(num_envs);
+    }
+
+    // The recorder would not match the new envs
+    recorder = nullptr;
+    recorder_obs = torch::Tensor();
+    recorder_actions = torch::Tensor();
+
+    step_result = VectorizedStepResult();
+    step_normalizer_obs = torch::zeros({ num_envs, obs_size });
+    env_returns.reserve(num_envs);
+    step_results = std::vector<StepResult>(num_envs);
+    async_actions = std::vector<torch::Tensor>(num_envs);
+    stepping = std::vector<bool>(num_envs, false);
+
     if (norm_obs)
     {
-        return torch::clip((obs - obs_rms.GetMean()) / torch::sqrt(obs_rms.GetVar() + epsilon), -max_obs, max_obs);
+        obs_rms = RunningMeanStd({ obs_size });
+    }
+    if (norm_reward)
+    {
+        returns = torch::zeros({ num_envs }).set_requires_grad(false);
+        ret_rms = RunningMeanStd({  });
+    }
+}
+
+void VectorizedEnv::ResetEnvs(torch::Tensor& obs)
+{
+    if (batched_env)
+    {
+        batched_env->Reset(obs.data_ptr<float>());
+        return;
+    }
+
+    float* obs_data = obs.data_ptr<float>();
+    ForEachEnv([&](const int64_t begin, const int64_t end)
+        {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                envs[i]->Reset(obs_data + i * obs_size);
+            }
+        }
+    );
+}
+
+void VectorizedEnv::StepEnvs(const torch::Tensor& action, VectorizedStepResult& result)
+{
+    if (batched_env)
+    {
+        StepBatchedEnv(action, result);
+        return;
+    }
+
+    // No copy if action is already a contiguous float tensor
+    step_actions = action.to(torch::kFloat).contiguous();
+    step_output = &result;
+    ForEachEnv(step_task);
+    step_actions = torch::Tensor();
+    step_output = nullptr;
+}
+
+void VectorizedEnv::StepEnvsAsync(const torch::Tensor& action, const std::vector<int64_t>& env_ids)
+{
+    if (batched_env)
+    {
+        throw std::runtime_error("Asynchronous steps are not supported with batched envs in VectorizedEnv");
+    }
+
+    for (size_t k = 0; k < env_ids.size(); ++k)
+    {
+        async_actions[env_ids[k]] = action[k];
+    }
+
+    for (size_t k = 0; k < env_ids.size(); ++k)
+    {
+        // One task per env, so fast envs can be received
+        // without waiting for slow ones of the same batch
+        if (thread_pool)
+        {
+            thread_pool->Submit(async_step_task, env_ids[k], env_ids[k] + 1, async_tasks);
+        }
+        else
+        {
+            async_step_task(env_ids[k], env_ids[k] + 1);
+        }
+    }
+}
+
+void VectorizedEnv::GetEnvsObs(torch::Tensor& obs) const
+{
+    if (batched_env)
+    {
+        batched_env->GetObs(obs.data_ptr<float>());
+        return;
+    }
+
+    float* obs_data = obs.data_ptr<float>();
+    for (int i = 0; i < num_envs; ++i)
+    {
+        envs[i]->WriteObs(obs_data + i * obs_size);
+    }
+}
+
+void VectorizedEnv::RenderEnvs()
+{
+    if (batched_env)
+    {
+        batched_env->Render();
+        return;
+    }
+
+    for (int i = 0; i < num_envs; ++i)
+    {
+        envs[i]->Render();
+    }
+}
+
+void VectorizedEnv::AllocateResult(VectorizedStepResult& result, const int64_t N, const bool pinned) const
+{
+    result.obs = torch::zeros({ N, obs_size });
+    result.rewards = torch::zeros({ N });
+    result.terminal_mask = torch::zeros({ N }, torch::kBool);
+    result.new_episode_obs = torch::zeros({ N, obs_size });
+    if (pinned)
+    {
+        result.obs = result.obs.pin_memory();
+        result.rewards = result.rewards.pin_memory();
+        result.terminal_mask = result.terminal_mask.pin_memory();
+        result.new_episode_obs = result.new_episode_obs.pin_memory();
+    }
+    result.terminal_states = std::vector<TerminalState>(N, TerminalState::NotTerminal);
+    result.terminated_envs.clear();
+    result.terminated_envs.reserve(N);
+    result.episodes_tot_reward = std::vector<float>(N, 0.0f);
+    result.episodes_tot_length = std::vector<uint64_t>(N, 0);
+    result.env_ids.clear();
+}
+
+void VectorizedEnv::StepEnvsRange(const int64_t begin, const int64_t end)
+{
+    const float* actions = step_actions.data_ptr<float>();
+    float* obs = step_output->obs.data_ptr<float>();
+    float* rewards = step_output->rewards.data_ptr<float>();
+    float* new_episode_obs = step_output->new_episode_obs.data_ptr<float>();
+
+    for (int64_t i = begin; i < end; ++i)
+    {
+        const StepResult res = envs[i]->Step(actions + i * act_size, obs + i * obs_size, new_episode_obs + i * obs_size);
+        rewards[i] = res.reward;
+        step_output->terminal_states[i] = res.terminal_state;
+        step_output->episodes_tot_reward[i] = res.tot_reward;
+        step_output->episodes_tot_length[i] = res.tot_steps;
+    }
+}
+
+void VectorizedEnv::StepBatchedEnv(const torch::Tensor& action, VectorizedStepResult& result)
+{
+    const torch::Tensor actions = action.to(torch::kFloat).contiguous();
+
+    batched_env->Step(actions.data_ptr<float>(), result.obs.data_ptr<float>(), result.rewards.data_ptr<float>(),
+        batched_terminal_states.data(), result.new_episode_obs.data_ptr<float>(),
+        result.episodes_tot_reward.data(), result.episodes_tot_length.data());
+
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        result.terminal_states[i] = static_cast<TerminalState>(batched_terminal_states[i]);
+    }
+}
+
+void VectorizedEnv::ForEachEnv(const std::function<void(const int64_t, const int64_t)>& f)
+{
+    if (thread_pool)
+    {
+        thread_pool->ParallelFor(num_envs, f);
     }
     else
     {
-        return obs;
+        f(0, num_envs);
+    }
+}
+
+void VectorizedEnv::StepAsyncEnv(const int64_t i)
+{
+    try
+    {
+        step_results[i] = envs[i]->Step(async_actions[i]);
+        async_actions[i] = torch::Tensor();
+    }
+    catch (...)
+    {
+        async_actions[i] = torch::Tensor();
+        std::lock_guard<std::mutex> lock(ready_mutex);
+        // Only the first exception is rethrown by Recv, but all the failed envs are released
+        if (!async_exception)
+        {
+            async_exception = std::current_exception();
+        }
+        failed_envs.push_back(i);
+        ready_condition.notify_all();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(ready_mutex);
+    ready_envs.push_back(i);
+    ready_condition.notify_all();
+}
+
+void VectorizedEnv::WriteResult(const StepResult& res, const int64_t k, VectorizedStepResult& result) const
+{
+    result.obs[k] = res.obs;
+    result.rewards.data_ptr<float>()[k] = res.reward;
+    result.terminal_states[k] = res.terminal_state;
+    if (res.terminal_state != TerminalState::NotTerminal)
+    {
+        result.new_episode_obs[k] = res.new_episode_obs;
     }
+    result.episodes_tot_reward[k] = res.tot_reward;
+    result.episodes_tot_length[k] = res.tot_steps;
 }
 
-torch::Tensor VectorizedEnv::NormalizeReward(const torch::Tensor& reward) const
+void VectorizedEnv::NormalizeResult(VectorizedStepResult& result, torch::Tensor& normalizer_obs, const bool all_envs)
 {
+    const int64_t N = result.terminal_states.size();
+    bool* terminal_mask = result.terminal_mask.data_ptr<bool>();
+    result.terminated_envs.clear();
+    for (int64_t k = 0; k < N; ++k)
+    {
+        terminal_mask[k] = result.terminal_states[k] != TerminalState::NotTerminal;
+        if (terminal_mask[k])
+        {
+            result.terminated_envs.push_back(k);
+        }
+    }
+
+    if (training && norm_obs)
+    {
+        // Obs of the new episodes for the terminated envs, as the
+        // terminal obs will never be seen by the policy
+        normalizer_obs.copy_(result.obs);
+        float* normalizer_data = normalizer_obs.data_ptr<float>();
+        const float* new_episode_obs = result.new_episode_obs.data_ptr<float>();
+        for (const int64_t k : result.terminated_envs)
+        {
+            std::copy(new_episode_obs + k * obs_size, new_episode_obs + (k + 1) * obs_size, normalizer_data + k * obs_size);
+        }
+        UpdateObs(normalizer_data, N);
+    }
+
+    UpdateReward(result.rewards.data_ptr<float>(), N, all_envs ? nullptr : &result.env_ids);
+
     if (norm_reward)
     {
-        return torch::clip(reward / torch::sqrt(ret_rms.GetVar() + epsilon), -max_reward, max_reward);
+        float* returns_data = returns.data_ptr<float>();
+        for (const int64_t k : result.terminated_envs)
+        {
+            returns_data[all_envs ? k : result.env_ids[k]] = 0.0f;
+        }
+    }
+
+    NormalizeObs(result.obs.data_ptr<float>(), N);
+    // Only the rows of the terminated envs are meaningful in new_episode_obs
+    float* new_episode_obs = result.new_episode_obs.data_ptr<float>();
+    for (const int64_t k : result.terminated_envs)
+    {
+        NormalizeObs(new_episode_obs + k * obs_size, 1);
+    }
+    NormalizeReward(result.rewards.data_ptr<float>(), N);
+}
+
+void VectorizedEnv::RecordResult(const torch::Tensor& action, const VectorizedStepResult& result, const bool all_envs)
+{
+    torch::NoGradGuard no_grad;
+
+    const int64_t N = result.terminal_states.size();
+    if (all_envs)
+    {
+        recorder->Record(recorder_obs, action, result.rewards, result.obs, result.terminal_states, recorder_env_ids);
+        recorder_obs.copy_(result.obs);
     }
     else
     {
-        return reward;
+        // action contains the actions of all the envs, in the order of their ids
+        const torch::Tensor indices = torch::tensor(result.env_ids, torch::kLong);
+        recorder->Record(recorder_obs.index_select(0, indices), action.index_select(0, indices),
+            result.rewards, result.obs, result.terminal_states, result.env_ids);
+        recorder_obs.index_copy_(0, indices, result.obs);
+    }
+
+    // Next action of the terminated envs is chosen on the first obs of their new episode
+    float* recorder_obs_data = recorder_obs.data_ptr<float>();
+    const float* new_episode_obs = result.new_episode_obs.data_ptr<float>();
+    for (int64_t k = 0; k < N; ++k)
+    {
+        if (result.terminal_states[k] != TerminalState::NotTerminal)
+        {
+            const int64_t i = all_envs ? k : result.env_ids[k];
+            std::copy(new_episode_obs + k * obs_size, new_episode_obs + (k + 1) * obs_size, recorder_obs_data + i * obs_size);
+        }
     }
 }
 
-void VectorizedEnv::UpdateObs(const torch::Tensor& obs)
+void VectorizedEnv::NormalizeObs(float* obs, const int64_t N) const
+{
+    if (norm_obs)
+    {
+        obs_rms.Normalize(obs, N, epsilon, max_obs);
+    }
+}
+
+void VectorizedEnv::NormalizeReward(float* reward, const int64_t N) const
+{
+    if (norm_reward)
+    {
+        ret_rms.Normalize(reward, N, epsilon, max_reward, false);
+    }
+}
+
+void VectorizedEnv::UpdateObs(const float* obs, const int64_t N)
 {
     if (training && norm_obs)
     {
-        obs_rms.Update(obs);
+        obs_rms.Update(obs, N);
     }
 }
 
-void VectorizedEnv::UpdateReward(const torch::Tensor& reward)
+void VectorizedEnv::UpdateReward(const float* reward, const int64_t N, const std::vector<int64_t>* env_ids)
 {
     if (training && norm_reward)
     {
-        returns = returns + discount_factor * reward;
-        ret_rms.Update(returns);
+        float* returns_data = returns.data_ptr<float>();
+        if (env_ids != nullptr)
+        {
+            // Returns of the envs in the result, gathered in a buffer reused across calls
+            env_returns.resize(N);
+            for (int64_t k = 0; k < N; ++k)
+            {
+                const int64_t i = (*env_ids)[k];
+                returns_data[i] += discount_factor * reward[k];
+                env_returns[k] = returns_data[i];
+            }
+            ret_rms.Update(env_returns.data(), N);
+        }
+        else
+        {
+            for (int64_t k = 0; k < N; ++k)
+            {
+                returns_data[k] += discount_factor * reward[k];
+            }
+            ret_rms.Update(returns_data, N);
+        }
     }
 }
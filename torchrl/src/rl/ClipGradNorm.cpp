@@ -0,0 +1,30 @@
+#include "torchrl/rl/ClipGradNorm.hpp"
+
+void ClipGradNorm(const std::vector<torch::Tensor>& parameters, const float max_norm)
+{
+    torch::NoGradGuard no_grad;
+
+    std::vector<torch::Tensor> norms;
+    norms.reserve(parameters.size());
+    for (const torch::Tensor& p : parameters)
+    {
+        if (p.grad().defined())
+        {
+            norms.push_back(p.grad().norm(2.0));
+        }
+    }
+    if (norms.empty())
+    {
+        return;
+    }
+
+    const torch::Tensor total_norm = torch::stack(norms).norm(2.0);
+    const torch::Tensor clip_coef = torch::clamp_max(max_norm / (total_norm + 1e-6), 1.0);
+    for (const torch::Tensor& p : parameters)
+    {
+        if (p.grad().defined())
+        {
+            p.grad().mul_(clip_coef);
+        }
+    }
+}
@@ -0,0 +1,277 @@
+#include "torchrl/rl/ExperienceReader.hpp"
+#include "torchrl/envs/ExperienceRecorder.hpp"
+#include "torchrl/rl/ReplayBuffer.hpp"
+#include "torchrl/rl/RolloutBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::vector<int64_t> ExperienceBatch::GetEnvIds() const
+{
+    const int64_t* data = env_id.data_ptr<int64_t>();
+    return std::vector<int64_t>(data, data + env_id.numel());
+}
+
+std::vector<TerminalState> ExperienceBatch::GetTerminalStates() const
+{
+    const uint8_t* data = terminal_state.data_ptr<uint8_t>();
+    std::vector<TerminalState> terminal_states(terminal_state.numel());
+    for (size_t i = 0; i < terminal_states.size(); ++i)
+    {
+        terminal_states[i] = static_cast<TerminalState>(data[i]);
+    }
+    return terminal_states;
+}
+
+ExperienceReader::ExperienceReader(const std::string& path_)
+{
+    path = path_;
+    obs_size = 0;
+    act_size = 0;
+    num_transitions = 0;
+    cursor_chunk = 0;
+    cursor_row = 0;
+    fd = -1;
+    mapping = nullptr;
+    mapping_size = 0;
+
+#ifdef __linux__
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Can't open experience file " + path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Can't get the size of experience file " + path);
+    }
+    mapping_size = file_stat.st_size;
+    if (mapping_size < sizeof(ExperienceFileHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Experience file " + path + " is too small to be valid");
+    }
+
+    // Private mapping, so the views can't modify the file
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        close(fd);
+        throw std::runtime_error("Can't map experience file " + path);
+    }
+    // Chunks are streamed in order, let the OS read ahead
+    madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+    const char* data = static_cast<const char*>(mapping);
+    const ExperienceFileHeader* header = reinterpret_cast<const ExperienceFileHeader*>(data);
+    if (std::memcmp(header->magic, experience_file_magic, sizeof(experience_file_magic)) != 0)
+    {
+        munmap(mapping, mapping_size);
+        close(fd);
+        throw std::runtime_error(path + " is not an experience file");
+    }
+    obs_size = header->obs_size;
+    act_size = header->act_size;
+
+    // The file can still be written by a recorder, only its complete chunks are indexed
+    size_t offset = sizeof(ExperienceFileHeader);
+    while (offset + sizeof(ExperienceChunkHeader) <= mapping_size)
+    {
+        const ExperienceChunkHeader* chunk = reinterpret_cast<const ExperienceChunkHeader*>(data + offset);
+        if (!IsCompleteChunk(*chunk, offset, mapping_size, obs_size, act_size))
+        {
+            break;
+        }
+        chunks.push_back({ data + offset + sizeof(ExperienceChunkHeader), chunk->num_rows });
+        num_transitions += chunk->num_rows;
+        offset += sizeof(ExperienceChunkHeader) + chunk->payload_size;
+    }
+#else
+    throw std::runtime_error("ExperienceReader is only available on Linux");
+#endif
+}
+
+ExperienceReader::~ExperienceReader()
+{
+#ifdef __linux__
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mapping_size);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+}
+
+int64_t ExperienceReader::GetObservationSize() const
+{
+    return obs_size;
+}
+
+int64_t ExperienceReader::GetActionSize() const
+{
+    return act_size;
+}
+
+int64_t ExperienceReader::GetNumChunks() const
+{
+    return chunks.size();
+}
+
+int64_t ExperienceReader::GetNumTransitions() const
+{
+    return num_transitions;
+}
+
+ExperienceBatch ExperienceReader::GetChunk(const int64_t i) const
+{
+    if (i < 0 || i >= static_cast<int64_t>(chunks.size()))
+    {
+        throw std::runtime_error("Chunk " + std::to_string(i) + " doesn't exist in experience file " + path);
+    }
+    return GetRows(chunks[i], 0, chunks[i].num_rows);
+}
+
+bool ExperienceReader::Next(const int64_t max_size, ExperienceBatch& batch)
+{
+    if (cursor_chunk >= static_cast<int64_t>(chunks.size()))
+    {
+        return false;
+    }
+
+    const ChunkInfo& chunk = chunks[cursor_chunk];
+    const int64_t n = std::min(max_size, chunk.num_rows - cursor_row);
+    batch = GetRows(chunk, cursor_row, n);
+
+    cursor_row += n;
+    if (cursor_row == chunk.num_rows)
+    {
+        cursor_chunk += 1;
+        cursor_row = 0;
+    }
+    return true;
+}
+
+void ExperienceReader::Rewind()
+{
+    cursor_chunk = 0;
+    cursor_row = 0;
+}
+
+int64_t ExperienceReader::Fill(ReplayBuffer& buffer)
+{
+    // The views are copied directly in the buffer storage
+    int64_t added = 0;
+    ExperienceBatch batch;
+    while (Next(buffer.GetCapacity(), batch))
+    {
+        buffer.Add(batch.obs, batch.action, batch.reward, batch.next_obs, batch.GetTerminalStates());
+        added += batch.obs.size(0);
+    }
+    return added;
+}
+
+int64_t ExperienceReader::Fill(RolloutBuffer& buffer, Policy& policy, const float gamma, torch::Tensor& last_values)
+{
+    torch::NoGradGuard no_grad;
+
+    buffer.Reset();
+    const int64_t num_envs = buffer.GetNumEnvs();
+    const int64_t n_steps = buffer.GetNumSteps();
+    const int64_t max_transitions = num_envs * n_steps;
+
+    // Number of steps read for each env, and next obs and terminal state of its last one
+    std::vector<int64_t> env_steps(num_envs, 0);
+    torch::Tensor last_obs = torch::zeros({ num_envs, obs_size });
+    torch::Tensor last_ended = torch::zeros({ num_envs }, torch::kBool);
+    bool* last_ended_data = last_ended.data_ptr<bool>();
+
+    int64_t added = 0;
+    ExperienceBatch batch;
+    while (added < max_transitions && Next(max_transitions - added, batch))
+    {
+        const std::vector<int64_t> env_ids = batch.GetEnvIds();
+        const std::vector<TerminalState> terminal_states = batch.GetTerminalStates();
+
+        // Checked before anything is added, so a mismatching file leaves the buffer untouched
+        std::vector<int64_t> batch_env_steps = env_steps;
+        // Row of the last step of each env in this batch, -1 if it has none
+        std::vector<int64_t> last_rows(num_envs, -1);
+        for (size_t k = 0; k < env_ids.size(); ++k)
+        {
+            const int64_t i = env_ids[k];
+            if (i < 0 || i >= num_envs || batch_env_steps[i] >= n_steps)
+            {
+                throw std::runtime_error("Transitions of experience file " + path + " don't match the " +
+                    std::to_string(num_envs) + " envs and " + std::to_string(n_steps) + " steps of the RolloutBuffer");
+            }
+            batch_env_steps[i] += 1;
+            last_rows[i] = k;
+        }
+        env_steps = batch_env_steps;
+
+        auto [values, log_probs, entropy] = policy->EvaluateActions(batch.obs, batch.action);
+
+        // Same approx of the future rewards of the timed out episodes as in PPO,
+        // on a copy as the recorded rewards are read-only
+        torch::Tensor rewards = batch.reward;
+        if (std::find(terminal_states.begin(), terminal_states.end(), TerminalState::Timeout) != terminal_states.end())
+        {
+            const torch::Tensor timeout_mask = batch.terminal_state == static_cast<uint8_t>(TerminalState::Timeout);
+            const torch::Tensor terminal_value = policy->PredictValues(batch.next_obs).view({ -1 });
+            rewards = batch.reward + (gamma * terminal_value).masked_fill_(timeout_mask.logical_not(), 0.0f);
+        }
+
+        buffer.Add(env_ids, batch.obs, batch.action, values, log_probs, rewards, terminal_states);
+        added += batch.obs.size(0);
+
+        std::vector<int64_t> updated_envs;
+        std::vector<int64_t> updated_rows;
+        for (int64_t i = 0; i < num_envs; ++i)
+        {
+            if (last_rows[i] >= 0)
+            {
+                updated_envs.push_back(i);
+                updated_rows.push_back(last_rows[i]);
+                last_ended_data[i] = terminal_states[last_rows[i]] != TerminalState::NotTerminal;
+            }
+        }
+        last_obs.index_copy_(0, torch::tensor(updated_envs, torch::kLong), batch.next_obs.index_select(0, torch::tensor(updated_rows, torch::kLong)));
+    }
+
+    // Same approx of the future rewards of the unfinished episodes as in PPO
+    if (added == max_transitions)
+    {
+        last_values = policy->PredictValues(last_obs);
+        last_values.masked_fill_(last_ended.unsqueeze(1), 0.0f);
+    }
+    return added;
+}
+
+ExperienceBatch ExperienceReader::GetRows(const ChunkInfo& chunk, const int64_t begin, const int64_t n) const
+{
+    // Views don't own the memory, they must not outlive this reader
+    const ExperienceChunkLayout layout(chunk.num_rows, obs_size, act_size);
+    char* payload = const_cast<char*>(chunk.payload);
+    ExperienceBatch batch;
+    batch.obs = torch::from_blob(payload + layout.obs, { chunk.num_rows, obs_size }, torch::kFloat).narrow(0, begin, n);
+    batch.action = torch::from_blob(payload + layout.action, { chunk.num_rows, act_size }, torch::kFloat).narrow(0, begin, n);
+    batch.reward = torch::from_blob(payload + layout.reward, { chunk.num_rows }, torch::kFloat).narrow(0, begin, n);
+    batch.next_obs = torch::from_blob(payload + layout.next_obs, { chunk.num_rows, obs_size }, torch::kFloat).narrow(0, begin, n);
+    batch.env_id = torch::from_blob(payload + layout.env_id, { chunk.num_rows }, torch::kLong).narrow(0, begin, n);
+    batch.terminal_state = torch::from_blob(payload + layout.terminal_state, { chunk.num_rows }, torch::kUInt8).narrow(0, begin, n);
+    return batch;
+}
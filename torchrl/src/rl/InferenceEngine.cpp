@@ -0,0 +1,295 @@
+#include "torchrl/rl/InferenceEngine.hpp"
+#include "torchrl/utils/SIMD.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Local constant, as M_PI depends on _USE_MATH_DEFINES being defined before any include
+    constexpr float pi = 3.14159265358979323846f;
+    const float half_log_2_pi = 0.5f * std::log(2.0f * pi);
+    const float two_pi = 2.0f * pi;
+
+    /// @brief Number of floats in a cache line
+    constexpr int64_t cache_line_floats = 64 / sizeof(float);
+    /// @brief Max number of SIMD vectors of outputs accumulated at once for each row
+    constexpr int block_vectors = 8;
+
+    int64_t AlignedSize(const int64_t n)
+    {
+        return (n + cache_line_floats - 1) / cache_line_floats * cache_line_floats;
+    }
+
+    int64_t PaddedSize(const int64_t n)
+    {
+        return (n + simd::width - 1) / simd::width * simd::width;
+    }
+
+    /// @brief Number of floats needed to store the packed layers of a MLP
+    size_t StorageSize(const MLP& mlp)
+    {
+        size_t size = 0;
+        for (const torch::nn::Linear& layer : mlp->GetLayers())
+        {
+            const int64_t stride = PaddedSize(layer->weight.size(0));
+            size += AlignedSize(layer->weight.size(1) * stride) + AlignedSize(stride);
+        }
+        return size;
+    }
+
+    /// @brief Compute V SIMD vectors of a row of bias + in * weights, with a tanh activation if needed
+    template<int V>
+    inline void DenseBlock(const float* in, const int64_t in_size, const float* weights, const int64_t stride,
+        const float* bias, float* out, const bool activation)
+    {
+        simd::vfloat acc[V];
+        for (int v = 0; v < V; ++v)
+        {
+            acc[v] = simd::Load<simd::vfloat>(bias + v * simd::width);
+        }
+        for (int64_t k = 0; k < in_size; ++k)
+        {
+            const simd::vfloat x = simd::Set1<simd::vfloat>(in[k]);
+            const float* w = weights + k * stride;
+            for (int v = 0; v < V; ++v)
+            {
+                acc[v] = simd::Fma(x, simd::Load<simd::vfloat>(w + v * simd::width), acc[v]);
+            }
+        }
+        for (int v = 0; v < V; ++v)
+        {
+            simd::Store(out + v * simd::width, activation ? simd::Tanh(acc[v]) : acc[v]);
+        }
+    }
+
+    /// @brief Box-Muller transform of two uniform samples into two standard normal ones
+    /// @param u1 Uniform samples in (0, 1]
+    /// @param u2 Uniform samples in [0, 1)
+    template<class T>
+    inline void BoxMuller(const float* u1, const float* u2, float* z0, float* z1)
+    {
+        const T r = simd::Sqrt(simd::Mul(simd::Set1<T>(-2.0f), simd::Log(simd::Load<T>(u1))));
+        T s, c;
+        simd::SinCos(simd::Mul(simd::Set1<T>(two_pi), simd::Load<T>(u2)), s, c);
+        simd::Store(z0, simd::Mul(r, c));
+        simd::Store(z1, simd::Mul(r, s));
+    }
+}
+
+InferenceEngine::InferenceEngine(const unsigned int seed) : random_engine(seed)
+{
+    mean_log_prob = 0.0f;
+}
+
+InferenceEngine::~InferenceEngine()
+{
+
+}
+
+void InferenceEngine::Update(const Policy& policy)
+{
+    torch::NoGradGuard no_grad;
+
+    const MLP& actor = policy->GetActorNet();
+    const MLP& critic = policy->GetCriticNet();
+
+    // Extra cache line to align the start of the storage
+    storage.resize(StorageSize(actor) + StorageSize(critic) + cache_line_floats);
+    float* aligned = storage.data();
+    while (reinterpret_cast<uintptr_t>(aligned) % (cache_line_floats * sizeof(float)) != 0)
+    {
+        aligned += 1;
+    }
+    aligned += PackMLP(actor, actor_layers, aligned);
+    PackMLP(critic, critic_layers, aligned);
+
+    const torch::Tensor log_std = policy->GetLogStd().to(torch::kCPU, torch::kFloat).contiguous();
+    const float* log_std_data = log_std.data_ptr<float>();
+    action_std.resize(log_std.numel());
+    mean_log_prob = 0.0f;
+    for (int64_t i = 0; i < log_std.numel(); ++i)
+    {
+        action_std[i] = std::exp(log_std_data[i]);
+        mean_log_prob -= log_std_data[i] + half_log_2_pi;
+    }
+}
+
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> InferenceEngine::Forward(const torch::Tensor& observations, const bool deterministic)
+{
+    if (actor_layers.empty() || observations.size(1) != actor_layers[0].in_size)
+    {
+        throw std::runtime_error("InferenceEngine weights don't match the observations, was Update called?");
+    }
+
+    const torch::Tensor obs = observations.to(torch::kCPU, torch::kFloat).contiguous();
+    const int64_t N = obs.size(0);
+    const int64_t action_dim = actor_layers.back().out_size;
+    torch::Tensor actions = torch::empty({ N, action_dim });
+    torch::Tensor values = torch::empty({ N, 1 });
+    torch::Tensor log_probs = torch::empty({ N, 1 });
+    float* actions_data = actions.data_ptr<float>();
+    float* values_data = values.data_ptr<float>();
+    float* log_probs_data = log_probs.data_ptr<float>();
+
+    if (!deterministic)
+    {
+        SampleNormal(N * action_dim);
+    }
+
+    // Actions are written before running the critic, which reuses the hidden buffers
+    const float* means = RunMLP(actor_layers, obs.data_ptr<float>(), N);
+    const int64_t means_stride = actor_layers.back().stride;
+    for (int64_t n = 0; n < N; ++n)
+    {
+        // (action - mean) / std is the sampled noise, so only its square norm is needed
+        float log_prob = mean_log_prob;
+        for (int64_t j = 0; j < action_dim; ++j)
+        {
+            const float mean = means[n * means_stride + j];
+            if (deterministic)
+            {
+                actions_data[n * action_dim + j] = mean;
+            }
+            else
+            {
+                const float eps = noise[n * action_dim + j];
+                actions_data[n * action_dim + j] = mean + eps * action_std[j];
+                log_prob -= 0.5f * eps * eps;
+            }
+        }
+        log_probs_data[n] = log_prob;
+    }
+
+    const float* critic_out = RunMLP(critic_layers, obs.data_ptr<float>(), N);
+    const int64_t critic_stride = critic_layers.back().stride;
+    for (int64_t n = 0; n < N; ++n)
+    {
+        values_data[n] = critic_out[n * critic_stride];
+    }
+
+    return { actions, values, log_probs };
+}
+
+torch::Tensor InferenceEngine::PredictValues(const torch::Tensor& observations)
+{
+    if (critic_layers.empty() || observations.size(1) != critic_layers[0].in_size)
+    {
+        throw std::runtime_error("InferenceEngine weights don't match the observations, was Update called?");
+    }
+
+    const torch::Tensor obs = observations.to(torch::kCPU, torch::kFloat).contiguous();
+    const int64_t N = obs.size(0);
+    torch::Tensor values = torch::empty({ N, 1 });
+    float* values_data = values.data_ptr<float>();
+
+    const float* critic_out = RunMLP(critic_layers, obs.data_ptr<float>(), N);
+    const int64_t critic_stride = critic_layers.back().stride;
+    for (int64_t n = 0; n < N; ++n)
+    {
+        values_data[n] = critic_out[n * critic_stride];
+    }
+
+    return values;
+}
+
+size_t InferenceEngine::PackMLP(const MLP& mlp, std::vector<Layer>& layers, float* buffer)
+{
+    const std::vector<torch::nn::Linear> linears = mlp->GetLayers();
+    layers.resize(linears.size());
+
+    size_t used = 0;
+    for (size_t l = 0; l < linears.size(); ++l)
+    {
+        const torch::Tensor weight = linears[l]->weight.to(torch::kCPU, torch::kFloat).contiguous();
+        const torch::Tensor bias = linears[l]->bias.to(torch::kCPU, torch::kFloat).contiguous();
+        const float* weight_data = weight.data_ptr<float>();
+        const float* bias_data = bias.data_ptr<float>();
+
+        Layer& layer = layers[l];
+        layer.out_size = weight.size(0);
+        layer.in_size = weight.size(1);
+        layer.stride = PaddedSize(layer.out_size);
+        layer.weights = buffer + used;
+        used += AlignedSize(layer.in_size * layer.stride);
+        layer.bias = buffer + used;
+        used += AlignedSize(layer.stride);
+
+        // Padding outputs have zero weights and bias, so they are always 0
+        std::fill(layer.weights, layer.weights + layer.in_size * layer.stride, 0.0f);
+        std::fill(layer.bias, layer.bias + layer.stride, 0.0f);
+        for (int64_t h = 0; h < layer.out_size; ++h)
+        {
+            for (int64_t k = 0; k < layer.in_size; ++k)
+            {
+                layer.weights[k * layer.stride + h] = weight_data[h * layer.in_size + k];
+            }
+            layer.bias[h] = bias_data[h];
+        }
+    }
+
+    return used;
+}
+
+const float* InferenceEngine::RunMLP(const std::vector<Layer>& layers, const float* in, const int64_t N)
+{
+    int64_t max_stride = 0;
+    for (const Layer& layer : layers)
+    {
+        max_stride = std::max(max_stride, layer.stride);
+    }
+    for (std::vector<float>& h : hidden)
+    {
+        if (static_cast<int64_t>(h.size()) < N * max_stride)
+        {
+            h.resize(N * max_stride);
+        }
+    }
+
+    int64_t in_stride = layers[0].in_size;
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        const Layer& layer = layers[l];
+        // All layers but the output one have a tanh activation
+        const bool activation = l + 1 < layers.size();
+        float* out = hidden[l % 2].data();
+        for (int64_t n = 0; n < N; ++n)
+        {
+            const float* in_row = in + n * in_stride;
+            float* out_row = out + n * layer.stride;
+            int64_t h = 0;
+            for (; h + block_vectors * simd::width <= layer.stride; h += block_vectors * simd::width)
+            {
+                DenseBlock<block_vectors>(in_row, layer.in_size, layer.weights + h, layer.stride, layer.bias + h, out_row + h, activation);
+            }
+            for (; h < layer.stride; h += simd::width)
+            {
+                DenseBlock<1>(in_row, layer.in_size, layer.weights + h, layer.stride, layer.bias + h, out_row + h, activation);
+            }
+        }
+        in = out;
+        in_stride = layer.stride;
+    }
+
+    return in;
+}
+
+void InferenceEngine::SampleNormal(const int64_t count)
+{
+    // Each transform gives two samples, from the first and second half of uniform
+    const int64_t num_pairs = PaddedSize((count + 1) / 2);
+    uniform.resize(2 * num_pairs);
+    noise.resize(2 * num_pairs);
+
+    constexpr float scale = 1.0f / 16777216.0f;
+    for (int64_t i = 0; i < num_pairs; ++i)
+    {
+        uniform[i] = static_cast<float>((random_engine() >> 8) + 1) * scale;
+        uniform[num_pairs + i] = static_cast<float>(random_engine() >> 8) * scale;
+    }
+
+    for (int64_t i = 0; i < num_pairs; i += simd::width)
+    {
+        BoxMuller<simd::vfloat>(uniform.data() + i, uniform.data() + num_pairs + i, noise.data() + i, noise.data() + num_pairs + i);
+    }
+}
@@ -32,3 +32,8 @@ void MLPImpl::InitOrtho(const float gain_backbone, const float gain_out)
     torch::nn::init::orthogonal_(out_layer->weight, gain_out);
     torch::nn::init::constant_(out_layer->bias, 0.0);
 }
+
+std::vector<torch::nn::Linear> MLPImpl::GetLayers() const
+{
+    return { l1, l2, out_layer };
+}
@@ -0,0 +1,200 @@
+#include "torchrl/rl/MappedStorage.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char magic[8] = { 'T', 'R', 'L', 'S', 'T', 'O', 'R', '1' };
+    /// @brief Rows start after the header, on a page boundary
+    constexpr size_t header_size = 4096;
+
+    struct FileHeader
+    {
+        char magic[8];
+        int64_t capacity;
+        int64_t obs_size;
+        int64_t act_size;
+        int64_t store_next_obs;
+        int64_t stride;
+        int64_t position;
+        int64_t size;
+    };
+    static_assert(sizeof(FileHeader) <= header_size, "MappedStorage header doesn't fit in its page");
+}
+
+MappedStorage::MappedStorage(const std::string& path_, const int64_t capacity_, const int64_t obs_size_, const int64_t act_size_, const bool store_next_obs_)
+{
+    path = path_;
+    capacity = capacity_;
+    obs_size = obs_size_;
+    act_size = act_size_;
+    store_next_obs = store_next_obs_;
+    stride = obs_size + act_size + 4 + (store_next_obs ? obs_size : 0);
+    resumed = false;
+    fd = -1;
+    mapping = nullptr;
+    mapping_size = header_size + capacity * stride * sizeof(float);
+    rows = nullptr;
+
+#ifdef __linux__
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Can't open MappedStorage file " + path);
+    }
+
+    struct stat file_stat;
+    fstat(fd, &file_stat);
+    resumed = file_stat.st_size > 0;
+    if (resumed && static_cast<size_t>(file_stat.st_size) != mapping_size)
+    {
+        close(fd);
+        throw std::runtime_error("MappedStorage file " + path + " exists with a different size, can't resume it");
+    }
+    // The file is sparse, disk blocks are only allocated when rows are written
+    if (!resumed && ftruncate(fd, mapping_size) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Can't resize MappedStorage file " + path);
+    }
+
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        close(fd);
+        throw std::runtime_error("Can't map MappedStorage file " + path);
+    }
+    // Batches are gathered at random rows, read-ahead would only evict useful pages
+    madvise(mapping, mapping_size, MADV_RANDOM);
+    rows = reinterpret_cast<float*>(static_cast<char*>(mapping) + header_size);
+
+    FileHeader* header = static_cast<FileHeader*>(mapping);
+    if (resumed)
+    {
+        if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->capacity != capacity ||
+            header->obs_size != obs_size || header->act_size != act_size ||
+            header->store_next_obs != store_next_obs || header->stride != stride)
+        {
+            munmap(mapping, mapping_size);
+            close(fd);
+            throw std::runtime_error("MappedStorage file " + path + " has a different layout, can't resume it");
+        }
+    }
+    else
+    {
+        std::memcpy(header->magic, magic, sizeof(magic));
+        header->capacity = capacity;
+        header->obs_size = obs_size;
+        header->act_size = act_size;
+        header->store_next_obs = store_next_obs;
+        header->stride = stride;
+        header->position = 0;
+        header->size = 0;
+    }
+#else
+    throw std::runtime_error("MappedStorage is only available on Linux");
+#endif
+}
+
+MappedStorage::~MappedStorage()
+{
+#ifdef __linux__
+    if (mapping != nullptr)
+    {
+        msync(mapping, mapping_size, MS_SYNC);
+        munmap(mapping, mapping_size);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+}
+
+bool MappedStorage::IsResumed() const
+{
+    return resumed;
+}
+
+torch::Tensor MappedStorage::GetObservations() const
+{
+    return Field(0, obs_size);
+}
+
+torch::Tensor MappedStorage::GetActions() const
+{
+    return Field(obs_size, act_size);
+}
+
+torch::Tensor MappedStorage::GetRewards() const
+{
+    return Field(obs_size + act_size, 1);
+}
+
+torch::Tensor MappedStorage::GetTerminals() const
+{
+    return Field(obs_size + act_size + 1, 1);
+}
+
+torch::Tensor MappedStorage::GetValues() const
+{
+    return Field(obs_size + act_size + 2, 1);
+}
+
+torch::Tensor MappedStorage::GetLogProbs() const
+{
+    return Field(obs_size + act_size + 3, 1);
+}
+
+torch::Tensor MappedStorage::GetNextObservations() const
+{
+    return store_next_obs ? Field(obs_size + act_size + 4, obs_size) : torch::Tensor();
+}
+
+int64_t MappedStorage::GetStride() const
+{
+    return stride;
+}
+
+int64_t MappedStorage::GetCapacity() const
+{
+    return capacity;
+}
+
+void MappedStorage::SetState(const int64_t position, const int64_t size)
+{
+    FileHeader* header = static_cast<FileHeader*>(mapping);
+    header->position = position;
+    header->size = size;
+}
+
+int64_t MappedStorage::GetPosition() const
+{
+    return static_cast<const FileHeader*>(mapping)->position;
+}
+
+int64_t MappedStorage::GetSize() const
+{
+    return static_cast<const FileHeader*>(mapping)->size;
+}
+
+void MappedStorage::Flush(const bool blocking)
+{
+#ifdef __linux__
+    msync(mapping, mapping_size, blocking ? MS_SYNC : MS_ASYNC);
+#endif
+}
+
+torch::Tensor MappedStorage::Field(const int64_t offset, const int64_t n) const
+{
+    // Views don't own the memory, they must not outlive this storage
+    return torch::from_blob(rows + offset, { capacity, n }, { stride, 1 }, torch::kFloat);
+}
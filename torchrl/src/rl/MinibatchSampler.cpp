@@ -0,0 +1,92 @@
+#include "torchrl/rl/MinibatchSampler.hpp"
+
+MinibatchSampler::MinibatchSampler(const RolloutBuffer& buffer_, const int64_t batch_size_, const bool prefetch) : buffer(buffer_)
+{
+    if (batch_size_ < 1)
+    {
+        throw std::runtime_error("MinibatchSampler batch size must be positive");
+    }
+    batch_size = batch_size_;
+    num_samples = 0;
+    position = 0;
+    current_slot = 0;
+    prefetching = false;
+
+    if (prefetch)
+    {
+        thread_pool = std::make_unique<ThreadPool>(1);
+        gather_task = [this](const int64_t begin, const int64_t slot) { Gather(begin, slot); };
+    }
+}
+
+MinibatchSampler::~MinibatchSampler()
+{
+    if (prefetching)
+    {
+        try
+        {
+            prefetch_group.Wait();
+        }
+        catch (...)
+        {
+
+        }
+    }
+}
+
+void MinibatchSampler::Reset()
+{
+    if (prefetching)
+    {
+        prefetching = false;
+        prefetch_group.Wait();
+    }
+
+    num_samples = buffer.size().value();
+    permutation = torch::randperm(num_samples, torch::kLong);
+    position = 0;
+
+    if (thread_pool != nullptr && num_samples > 0)
+    {
+        thread_pool->Submit(gather_task, 0, current_slot, prefetch_group);
+        prefetching = true;
+    }
+}
+
+bool MinibatchSampler::Next(RolloutSample& batch)
+{
+    if (position >= num_samples)
+    {
+        return false;
+    }
+
+    if (prefetching)
+    {
+        prefetching = false;
+        prefetch_group.Wait();
+    }
+    else
+    {
+        Gather(position, current_slot);
+    }
+    batch = gathered[current_slot];
+
+    position += batch_size;
+    current_slot = 1 - current_slot;
+    // Fill the other slot while the caller uses this minibatch. The
+    // other slot was returned by the previous call so it's not used anymore
+    if (thread_pool != nullptr && position < num_samples)
+    {
+        thread_pool->Submit(gather_task, position, current_slot, prefetch_group);
+        prefetching = true;
+    }
+
+    return true;
+}
+
+void MinibatchSampler::Gather(const int64_t begin, const int64_t slot)
+{
+    // NoGradGuard is thread local, so it's needed here even if the caller has one
+    torch::NoGradGuard no_grad;
+    buffer.GetBatch(permutation.slice(0, begin, std::min(begin + batch_size, num_samples)), gathered[slot]);
+}
@@ -1,8 +1,10 @@
 #include "torchrl/rl/Policy.hpp"
 #include "torchrl/rl/NormalDistribution.hpp"
 
-PolicyImpl::PolicyImpl(const int64_t obs_dim, const int64_t action_dim, const bool ortho_init, const float init_log_std)
+PolicyImpl::PolicyImpl(const int64_t obs_dim, const int64_t action_dim, const bool ortho_init, const float init_log_std, const bool fused_)
 {
+    fused = fused_;
+
     pi_net = register_module("pi_net", MLP(obs_dim, 64, action_dim));
     v_net = register_module("v_net", MLP(obs_dim, 64, 1));
 
@@ -22,8 +24,17 @@ PolicyImpl::~PolicyImpl()
 
 std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> PolicyImpl::forward(const torch::Tensor& observations, const bool deterministic)
 {
-    torch::Tensor action_means = pi_net(observations);
-    torch::Tensor values = v_net(observations);
+    torch::Tensor action_means;
+    torch::Tensor values;
+    if (fused && !at::GradMode::is_enabled())
+    {
+        std::tie(action_means, values) = FusedForward(observations);
+    }
+    else
+    {
+        action_means = pi_net(observations);
+        values = v_net(observations);
+    }
 
     NormalDistribution dist(action_means, log_std.exp());
     torch::Tensor actions = deterministic ? action_means : dist.Sample(observations.size(0));
@@ -45,3 +56,79 @@ torch::Tensor PolicyImpl::PredictValues(const torch::Tensor& observations)
 {
     return v_net(observations);
 }
+
+const MLP& PolicyImpl::GetActorNet() const
+{
+    return pi_net;
+}
+
+const MLP& PolicyImpl::GetCriticNet() const
+{
+    return v_net;
+}
+
+const torch::Tensor& PolicyImpl::GetLogStd() const
+{
+    return log_std;
+}
+
+std::tuple<torch::Tensor, torch::Tensor> PolicyImpl::FusedForward(const torch::Tensor& observations)
+{
+    UpdateFusedWeights();
+
+    torch::Tensor out = torch::tanh(torch::addmm(fused_biases[0], observations, fused_weights[0]));
+    out = torch::tanh(torch::addmm(fused_biases[1], out, fused_weights[1]));
+    out = torch::addmm(fused_biases[2], out, fused_weights[2]);
+
+    const int64_t action_dim = log_std.size(0);
+    return { out.narrow(1, 0, action_dim), out.narrow(1, action_dim, 1) };
+}
+
+void PolicyImpl::UpdateFusedWeights()
+{
+    // The parameters list is only built once instead of at each forward. A
+    // cloned module has new parameters, so the list is rebuilt if log_std
+    // (the first registered parameter) is not the one of the cached list
+    if (fused_parameters.empty() || !fused_parameters[0].is_same(log_std))
+    {
+        fused_parameters = this->parameters();
+        fused_versions.clear();
+    }
+
+    // Optimizer steps, weight copies and loading all modify the parameters
+    // in place, which increments their version counter
+    const std::vector<torch::Tensor>& parameters = fused_parameters;
+    bool up_to_date = fused_versions.size() == parameters.size();
+    for (size_t i = 0; i < parameters.size() && up_to_date; ++i)
+    {
+        up_to_date = fused_versions[i] == static_cast<int64_t>(parameters[i]._version());
+    }
+    if (up_to_date)
+    {
+        return;
+    }
+
+    torch::NoGradGuard no_grad;
+    const std::vector<torch::nn::Linear> pi_layers = pi_net->GetLayers();
+    const std::vector<torch::nn::Linear> v_layers = v_net->GetLayers();
+
+    fused_weights.resize(pi_layers.size());
+    fused_biases.resize(pi_layers.size());
+    for (size_t i = 0; i < pi_layers.size(); ++i)
+    {
+        // Both networks see the same observations, so their first layers are just
+        // stacked. Deeper layers only mix the outputs of their own network
+        fused_weights[i] = i == 0 ?
+            torch::cat({ pi_layers[i]->weight, v_layers[i]->weight }, 0) :
+            torch::block_diag({ pi_layers[i]->weight, v_layers[i]->weight });
+        // Stored as {in, out} so addmm doesn't have to transpose them
+        fused_weights[i] = fused_weights[i].t().contiguous();
+        fused_biases[i] = torch::cat({ pi_layers[i]->bias, v_layers[i]->bias }, 0);
+    }
+
+    fused_versions.resize(parameters.size());
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        fused_versions[i] = static_cast<int64_t>(parameters[i]._version());
+    }
+}
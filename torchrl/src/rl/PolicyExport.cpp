@@ -0,0 +1,48 @@
+#include "torchrl/rl/PolicyExport.hpp"
+#include "torchrl/envs/VectorizedEnv.hpp"
+
+#include <torch/script.h>
+
+void ExportTorchScript(const Policy& policy, const VectorizedEnv& env, const std::string& path)
+{
+    torch::NoGradGuard no_grad;
+
+    torch::jit::Module module("DeterministicActor");
+    // Not added by the C++ constructor, but needed to put the module in eval mode before freezing it
+    module.register_attribute("training", c10::BoolType::get(), true);
+    std::string source = "def forward(self, obs: Tensor) -> Tensor:\n";
+
+    if (env.GetNormObs())
+    {
+        const RunningMeanStd& obs_rms = env.GetObsNormalizer();
+        module.register_buffer("obs_mean", obs_rms.GetMean());
+        module.register_buffer("obs_inv_std", torch::rsqrt(obs_rms.GetVar() + env.GetEpsilon()));
+        module.register_attribute("obs_clip", c10::FloatType::get(), static_cast<double>(env.GetMaxObs()));
+        source += "    x = torch.clamp((obs - self.obs_mean) * self.obs_inv_std, -self.obs_clip, self.obs_clip)\n";
+    }
+    else
+    {
+        source += "    x = obs\n";
+    }
+
+    // Actions are the means of the gaussian, the output of the actor MLP
+    const std::vector<torch::nn::Linear> layers = policy->GetActorNet()->GetLayers();
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        const std::string weight = "l" + std::to_string(i) + "_weight";
+        const std::string bias = "l" + std::to_string(i) + "_bias";
+        module.register_parameter(weight, layers[i]->weight.detach().clone(), false);
+        module.register_parameter(bias, layers[i]->bias.detach().clone(), false);
+
+        const std::string linear = "torch.linear(x, self." + weight + ", self." + bias + ")";
+        source += i + 1 < layers.size() ? "    x = torch.tanh(" + linear + ")\n" : "    return " + linear + "\n";
+    }
+
+    module.define(source);
+    module.eval();
+
+    // Freezing inlines the weights as constants, so they can be folded and fused
+    torch::jit::Module frozen = torch::jit::freeze(module);
+    frozen = torch::jit::optimize_for_inference(frozen);
+    frozen.save(path);
+}
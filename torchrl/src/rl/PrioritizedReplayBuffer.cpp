@@ -0,0 +1,115 @@
+#include "torchrl/rl/PrioritizedReplayBuffer.hpp"
+
+#include <cmath>
+
+namespace
+{
+    /// @brief Added to the priorities so transitions with a TD error of 0 can still be sampled
+    constexpr float priority_epsilon = 1e-6f;
+}
+
+PrioritizedReplayBuffer::PrioritizedReplayBuffer(const int64_t capacity_, const int64_t obs_size, const int64_t act_size,
+    const float alpha_, const unsigned int seed, const std::string& storage_path)
+    : ReplayBuffer(capacity_, obs_size, act_size, storage_path), tree(capacity_), random_engine(seed)
+{
+    alpha = alpha_;
+    beta = 0.4f;
+    max_priority = 1.0f;
+
+    // Priorities are not stored, transitions resumed from a mapped storage start equal
+    if (size() > 0)
+    {
+        tree_indices.resize(size());
+        tree_priorities.assign(size(), 1.0f);
+        for (int64_t i = 0; i < size(); ++i)
+        {
+            tree_indices[i] = i;
+        }
+        tree.Update(tree_indices.data(), tree_priorities.data(), size());
+    }
+}
+
+PrioritizedReplayBuffer::~PrioritizedReplayBuffer()
+{
+
+}
+
+void PrioritizedReplayBuffer::Add(const torch::Tensor& obs, const torch::Tensor& action, const torch::Tensor& reward,
+    const torch::Tensor& next_obs, const std::vector<TerminalState>& terminal_states)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const int64_t start = position;
+    ReplayBuffer::Add(obs, action, reward, next_obs, terminal_states);
+
+    // New transitions are sampled at least once with high probability
+    const int64_t N = obs.size(0);
+    tree_indices.resize(N);
+    tree_priorities.assign(N, std::pow(max_priority, alpha));
+    for (int64_t i = 0; i < N; ++i)
+    {
+        tree_indices[i] = (start + i) % capacity;
+    }
+    tree.Update(tree_indices.data(), tree_priorities.data(), N);
+}
+
+void PrioritizedReplayBuffer::Sample(const int64_t batch_size, ReplaySample& batch)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (size() == 0)
+    {
+        throw std::runtime_error("Can't sample from an empty PrioritizedReplayBuffer");
+    }
+
+    batch.indices = torch::empty({ batch_size }, torch::kLong);
+    batch.weight = torch::empty({ batch_size, 1 });
+    int64_t* indices_data = batch.indices.data_ptr<int64_t>();
+    float* weight_data = batch.weight.data_ptr<float>();
+
+    tree_priorities.resize(batch_size);
+    tree.Sample(batch_size, random_engine, indices_data, tree_priorities.data());
+
+    // (N * P(i))^-beta normalized by its max, which is reached for the min priority
+    const float min_priority = tree.GetMin();
+    for (int64_t i = 0; i < batch_size; ++i)
+    {
+        weight_data[i] = std::pow(min_priority / tree_priorities[i], beta);
+    }
+
+    GetBatch(batch.indices, batch);
+}
+
+void PrioritizedReplayBuffer::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ReplayBuffer::Reset();
+    tree.Clear();
+    max_priority = 1.0f;
+}
+
+void PrioritizedReplayBuffer::UpdatePriorities(const torch::Tensor& indices, const torch::Tensor& priorities)
+{
+    const torch::Tensor indices_cpu = indices.to(torch::kCPU, torch::kLong).contiguous();
+    const torch::Tensor priorities_cpu = priorities.detach().to(torch::kCPU, torch::kFloat).contiguous();
+    const int64_t* indices_data = indices_cpu.data_ptr<int64_t>();
+    const float* priorities_data = priorities_cpu.data_ptr<float>();
+    const int64_t n = indices_cpu.numel();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    tree_priorities.resize(n);
+    for (int64_t i = 0; i < n; ++i)
+    {
+        const float p = std::abs(priorities_data[i]) + priority_epsilon;
+        max_priority = std::max(max_priority, p);
+        tree_priorities[i] = std::pow(p, alpha);
+    }
+    tree.Update(indices_data, tree_priorities.data(), n);
+}
+
+void PrioritizedReplayBuffer::SetBeta(const float beta_)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    beta = beta_;
+}
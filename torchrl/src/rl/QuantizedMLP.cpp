@@ -0,0 +1,154 @@
+#include "torchrl/rl/QuantizedMLP.hpp"
+#include "torchrl/utils/SIMD.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    /// @brief Quantize n floats to int8 with a given scale, saturating out of range values
+    void QuantizeRow(const float* in, const int64_t n, const float scale, int8_t* out)
+    {
+        const float inv_scale = scale > 0.0f ? 1.0f / scale : 0.0f;
+        for (int64_t k = 0; k < n; ++k)
+        {
+            out[k] = static_cast<int8_t>(std::clamp(std::nearbyint(in[k] * inv_scale), -127.0f, 127.0f));
+        }
+    }
+
+    /// @brief Apply tanh in place on n floats
+    void TanhRow(float* x, const int64_t n)
+    {
+        int64_t k = 0;
+#if TORCHRL_SIMD_WIDTH > 1
+        for (; k + simd::width <= n; k += simd::width)
+        {
+            simd::Store(x + k, simd::Tanh(simd::Load<simd::vfloat>(x + k)));
+        }
+#endif
+        for (; k < n; ++k)
+        {
+            x[k] = simd::Tanh(x[k]);
+        }
+    }
+}
+
+QuantizedMLP::QuantizedMLP(const MLP& mlp, const torch::Tensor& calibration_inputs)
+{
+    torch::NoGradGuard no_grad;
+
+    const bool calibrate = calibration_inputs.defined() && calibration_inputs.size(0) > 0;
+    torch::Tensor x = calibrate ? calibration_inputs.to(torch::kCPU, torch::kFloat) : torch::Tensor();
+
+    std::vector<torch::nn::Linear> linears = mlp->GetLayers();
+    layers.resize(linears.size());
+    for (size_t l = 0; l < linears.size(); ++l)
+    {
+        const torch::Tensor weight = linears[l]->weight.to(torch::kCPU, torch::kFloat).contiguous();
+        const torch::Tensor bias = linears[l]->bias.to(torch::kCPU, torch::kFloat).contiguous();
+        const float* weight_data = weight.data_ptr<float>();
+        const float* bias_data = bias.data_ptr<float>();
+
+        Layer& layer = layers[l];
+        layer.out_size = weight.size(0);
+        layer.in_size = weight.size(1);
+        layer.weights.resize(layer.out_size * layer.in_size);
+        layer.weight_scales.resize(layer.out_size);
+        layer.bias.assign(bias_data, bias_data + layer.out_size);
+        for (int64_t h = 0; h < layer.out_size; ++h)
+        {
+            const float* row = weight_data + h * layer.in_size;
+            float max_abs = 0.0f;
+            for (int64_t k = 0; k < layer.in_size; ++k)
+            {
+                max_abs = std::max(max_abs, std::abs(row[k]));
+            }
+            layer.weight_scales[h] = max_abs / 127.0f;
+            QuantizeRow(row, layer.in_size, layer.weight_scales[h], layer.weights.data() + h * layer.in_size);
+        }
+
+        // The fp32 activations of the calibration sample give the range of the inputs of each layer
+        layer.input_scale = 0.0f;
+        if (calibrate)
+        {
+            layer.input_scale = x.abs().max().item<float>() / 127.0f;
+            x = linears[l](x);
+            if (l + 1 < linears.size())
+            {
+                x = torch::tanh(x);
+            }
+        }
+    }
+}
+
+QuantizedMLP::~QuantizedMLP()
+{
+
+}
+
+bool QuantizedMLP::IsCalibrated() const
+{
+    return !layers.empty() && layers[0].input_scale > 0.0f;
+}
+
+torch::Tensor QuantizedMLP::Forward(const torch::Tensor& in)
+{
+    if (layers.empty() || in.size(1) != layers[0].in_size)
+    {
+        throw std::runtime_error("QuantizedMLP input size doesn't match its first layer");
+    }
+
+    const torch::Tensor input = in.to(torch::kCPU, torch::kFloat).contiguous();
+    const int64_t N = input.size(0);
+    torch::Tensor output = torch::empty({ N, layers.back().out_size });
+
+    int64_t max_size = 0;
+    for (const Layer& layer : layers)
+    {
+        max_size = std::max({ max_size, layer.in_size, layer.out_size });
+    }
+    for (std::vector<float>& a : activations)
+    {
+        if (static_cast<int64_t>(a.size()) < N * max_size)
+        {
+            a.resize(N * max_size);
+        }
+    }
+    quantized_row.resize(max_size);
+
+    const float* x = input.data_ptr<float>();
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        const Layer& layer = layers[l];
+        float* out = l + 1 < layers.size() ? activations[l % 2].data() : output.data_ptr<float>();
+        for (int64_t n = 0; n < N; ++n)
+        {
+            const float* x_row = x + n * layer.in_size;
+            float input_scale = layer.input_scale;
+            if (input_scale == 0.0f)
+            {
+                float max_abs = 0.0f;
+                for (int64_t k = 0; k < layer.in_size; ++k)
+                {
+                    max_abs = std::max(max_abs, std::abs(x_row[k]));
+                }
+                input_scale = max_abs / 127.0f;
+            }
+            QuantizeRow(x_row, layer.in_size, input_scale, quantized_row.data());
+
+            float* out_row = out + n * layer.out_size;
+            for (int64_t h = 0; h < layer.out_size; ++h)
+            {
+                const int32_t acc = simd::DotInt8(quantized_row.data(), layer.weights.data() + h * layer.in_size, layer.in_size);
+                out_row[h] = static_cast<float>(acc) * (input_scale * layer.weight_scales[h]) + layer.bias[h];
+            }
+            if (l + 1 < layers.size())
+            {
+                TanhRow(out_row, layer.out_size);
+            }
+        }
+        x = out;
+    }
+
+    return output;
+}
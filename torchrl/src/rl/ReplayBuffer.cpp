@@ -0,0 +1,132 @@
+#include "torchrl/rl/ReplayBuffer.hpp"
+#include "torchrl/rl/MappedStorage.hpp"
+
+ReplayBuffer::ReplayBuffer(const int64_t capacity_, const int64_t obs_size, const int64_t act_size, const std::string& storage_path)
+{
+    capacity = capacity_;
+    position = 0;
+    full = false;
+
+    if (storage_path.empty())
+    {
+        observations = torch::zeros({ capacity, obs_size });
+        actions = torch::zeros({ capacity, act_size });
+        rewards = torch::zeros({ capacity, 1 });
+        next_observations = torch::zeros({ capacity, obs_size });
+        dones = torch::zeros({ capacity, 1 });
+    }
+    else
+    {
+        storage = std::make_unique<MappedStorage>(storage_path, capacity, obs_size, act_size, true);
+        observations = storage->GetObservations();
+        actions = storage->GetActions();
+        rewards = storage->GetRewards();
+        next_observations = storage->GetNextObservations();
+        dones = storage->GetTerminals();
+        // Continue where the previous run stopped
+        position = storage->GetPosition();
+        full = storage->GetSize() == capacity;
+    }
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+
+}
+
+void ReplayBuffer::Add(const torch::Tensor& obs, const torch::Tensor& action, const torch::Tensor& reward,
+    const torch::Tensor& next_obs, const std::vector<TerminalState>& terminal_states)
+{
+    torch::NoGradGuard no_grad;
+
+    const int64_t N = obs.size(0);
+    if (N > capacity)
+    {
+        throw std::runtime_error("Can't add " + std::to_string(N) + " transitions at once in a ReplayBuffer of capacity " + std::to_string(capacity));
+    }
+
+    // Timeouts are not real ends of episodes, their next value must still be bootstrapped
+    torch::Tensor done = torch::empty({ N, 1 });
+    float* done_data = done.data_ptr<float>();
+    for (int64_t i = 0; i < N; ++i)
+    {
+        done_data[i] = terminal_states[i] == TerminalState::Terminal ? 1.0f : 0.0f;
+    }
+
+    const std::pair<torch::Tensor*, torch::Tensor> fields[] = {
+        { &observations, obs },
+        { &actions, action },
+        { &rewards, reward.view({ N, 1 }) },
+        { &next_observations, next_obs },
+        { &dones, done }
+    };
+
+    // Rows past the end of the storage wrap around to its start
+    const int64_t first = std::min(N, capacity - position);
+    for (const auto& [field, src] : fields)
+    {
+        field->narrow(0, position, first).copy_(src.narrow(0, 0, first));
+        if (first < N)
+        {
+            field->narrow(0, 0, N - first).copy_(src.narrow(0, first, N - first));
+        }
+    }
+
+    full = full || position + N >= capacity;
+    position = (position + N) % capacity;
+    if (storage != nullptr)
+    {
+        storage->SetState(position, size());
+    }
+}
+
+void ReplayBuffer::Sample(const int64_t batch_size, ReplaySample& batch)
+{
+    if (size() == 0)
+    {
+        throw std::runtime_error("Can't sample from an empty ReplayBuffer");
+    }
+    batch.indices = torch::randint(size(), { batch_size }, torch::kLong);
+    GetBatch(batch.indices, batch);
+}
+
+void ReplayBuffer::GetBatch(const torch::Tensor& indices, ReplaySample& batch) const
+{
+    torch::NoGradGuard no_grad;
+
+    const std::pair<const torch::Tensor*, torch::Tensor*> fields[] = {
+        { &observations, &batch.observation },
+        { &actions, &batch.action },
+        { &rewards, &batch.reward },
+        { &next_observations, &batch.next_observation },
+        { &dones, &batch.done }
+    };
+    for (const auto& [field, out] : fields)
+    {
+        if (!out->defined())
+        {
+            *out = torch::empty({ 0 });
+        }
+        torch::index_select_out(*out, *field, 0, indices);
+    }
+}
+
+void ReplayBuffer::Reset()
+{
+    position = 0;
+    full = false;
+    if (storage != nullptr)
+    {
+        storage->SetState(position, 0);
+    }
+}
+
+int64_t ReplayBuffer::size() const
+{
+    return full ? capacity : position;
+}
+
+int64_t ReplayBuffer::GetCapacity() const
+{
+    return capacity;
+}
@@ -1,90 +1,287 @@
 #include "torchrl/rl/RolloutBuffer.hpp"
+#include "torchrl/rl/MappedStorage.hpp"
 
-RolloutBuffer::RolloutBuffer(const uint64_t num_envs, const uint64_t reserve)
+#include <algorithm>
 
+RolloutBuffer::RolloutBuffer(const int64_t num_envs_, const int64_t n_steps_, const int64_t obs_size, const int64_t act_size, const std::string& storage_path, const bool compact_)
 {
-    data = std::vector<std::vector<RolloutSample>>(num_envs);
-    rewards = std::vector<std::vector<float>>(num_envs);
-    episode_ends = std::vector<std::vector<bool>>(num_envs);
-    if (reserve != 0)
+    num_envs = num_envs_;
+    n_steps = n_steps_;
+    compact = compact_;
+    positions = std::vector<int64_t>(num_envs, 0);
+
+    if (compact && !storage_path.empty())
+    {
+        throw std::runtime_error("RolloutBuffer compact storage can't be used with a mapped storage");
+    }
+
+    if (storage_path.empty())
     {
-        for (int i = 0; i < num_envs; ++i)
+        sample_stride = 1;
+        // bfloat16 keeps the float exponent range, so unnormalized obs can't overflow
+        observations = torch::zeros({ n_steps, num_envs, obs_size }, compact ? torch::kBFloat16 : torch::kFloat);
+        actions = torch::zeros({ n_steps, num_envs, act_size });
+        values = torch::zeros({ n_steps, num_envs, 1 });
+        log_probs = torch::zeros({ n_steps, num_envs, 1 });
+        rewards = torch::zeros({ n_steps, num_envs });
+        if (compact)
+        {
+            episode_end_bits = std::vector<uint64_t>((n_steps * num_envs + 63) / 64, 0);
+        }
+        else
         {
-            data[i].reserve(reserve);
-            rewards[i].reserve(reserve);
-            episode_ends[i].reserve(reserve);
+            episode_ends = torch::zeros({ n_steps, num_envs });
         }
     }
+    else
+    {
+        // Storage rows are in the same order as the samples, t * n_envs + i
+        storage = std::make_unique<MappedStorage>(storage_path, n_steps * num_envs, obs_size, act_size, false);
+        sample_stride = storage->GetStride();
+        observations = storage->GetObservations().view({ n_steps, num_envs, obs_size });
+        actions = storage->GetActions().view({ n_steps, num_envs, act_size });
+        values = storage->GetValues().view({ n_steps, num_envs, 1 });
+        log_probs = storage->GetLogProbs().view({ n_steps, num_envs, 1 });
+        rewards = storage->GetRewards().view({ n_steps, num_envs });
+        episode_ends = storage->GetTerminals().view({ n_steps, num_envs });
+        // Envs are reset when training starts, so the steps of a previous run can't be continued
+        storage->SetState(0, 0);
+    }
+    advantages = torch::zeros({ n_steps, num_envs, 1 });
+    returns = torch::zeros({ n_steps, num_envs, 1 });
+}
+
+RolloutBuffer::~RolloutBuffer()
+{
+
 }
 
 void RolloutBuffer::Add(const torch::Tensor& obs, const torch::Tensor& action,
     const torch::Tensor& value, const torch::Tensor& log_prob,
     const torch::Tensor& reward, const std::vector<TerminalState>& episode_end)
 {
-    for (int i = 0; i < data.size(); ++i)
+    torch::NoGradGuard no_grad;
+
+    const int64_t t = positions[0];
+    for (int64_t i = 0; i < num_envs; ++i)
     {
-        data[i].push_back(RolloutSample(obs[i], action[i], value[i], log_prob[i]));
-        rewards[i].push_back(reward[i].item<float>());
-        episode_ends[i].push_back(episode_end[i] != TerminalState::NotTerminal);
+        if (positions[i] != t || t >= n_steps)
+        {
+            throw std::runtime_error("Can't add a step for all envs in RolloutBuffer, env " + std::to_string(i) + " has " + std::to_string(positions[i]) + " steps");
+        }
+    }
+
+    observations[t].copy_(obs);
+    actions[t].copy_(action);
+    values[t].copy_(value);
+    log_probs[t].copy_(log_prob);
+    rewards[t].copy_(reward);
+    for (int64_t i = 0; i < num_envs; ++i)
+    {
+        SetEpisodeEnd(t * num_envs + i, episode_end[i] != TerminalState::NotTerminal);
+        positions[i] += 1;
+    }
+    if (storage != nullptr)
+    {
+        storage->SetState(t + 1, (t + 1) * num_envs);
+    }
+}
+
+void RolloutBuffer::Add(const std::vector<int64_t>& env_ids,
+    const torch::Tensor& obs, const torch::Tensor& action,
+    const torch::Tensor& value, const torch::Tensor& log_prob,
+    const torch::Tensor& reward, const std::vector<TerminalState>& episode_end)
+{
+    torch::NoGradGuard no_grad;
+
+    // Row of each step in the flattened {n_steps * n_envs, ...} storage
+    std::vector<int64_t> rows(env_ids.size());
+    for (size_t k = 0; k < env_ids.size(); ++k)
+    {
+        const int64_t i = env_ids[k];
+        if (i < 0 || i >= num_envs || positions[i] >= n_steps)
+        {
+            // Leave the buffer as it was
+            for (size_t j = 0; j < k; ++j)
+            {
+                positions[env_ids[j]] -= 1;
+            }
+            throw std::runtime_error("Can't add a step for env " + std::to_string(i) + " in RolloutBuffer, it doesn't exist or is already full");
+        }
+        rows[k] = positions[i] * num_envs + i;
+        positions[i] += 1;
+    }
+    const torch::Tensor indices = torch::tensor(rows, torch::kLong);
+
+    observations.view({ n_steps * num_envs, -1 }).index_copy_(0, indices, obs.to(observations.scalar_type()));
+    actions.view({ n_steps * num_envs, -1 }).index_copy_(0, indices, action);
+    values.view({ n_steps * num_envs, -1 }).index_copy_(0, indices, value);
+    log_probs.view({ n_steps * num_envs, -1 }).index_copy_(0, indices, log_prob);
+
+    rewards.view({ -1 }).index_copy_(0, indices, reward);
+
+    // Terminal states are on the host, no need to go through a tensor
+    for (size_t k = 0; k < env_ids.size(); ++k)
+    {
+        SetEpisodeEnd(rows[k], episode_end[k] != TerminalState::NotTerminal);
+    }
+    // Only the steps done by all the envs can be resumed
+    if (storage != nullptr)
+    {
+        const int64_t t = *std::min_element(positions.begin(), positions.end());
+        storage->SetState(t, t * num_envs);
     }
 }
 
 void RolloutBuffer::Reset()
 {
-    for (int i = 0; i < data.size(); ++i)
+    std::fill(positions.begin(), positions.end(), 0);
+    if (storage != nullptr)
+    {
+        storage->SetState(0, 0);
+    }
+}
+
+RolloutSample RolloutBuffer::GetBatch(const torch::Tensor& indices) const
+{
+    torch::NoGradGuard no_grad;
+
+    return RolloutSample(
+        observations.view({ n_steps * num_envs, -1 }).index_select(0, indices).to(torch::kFloat),
+        actions.view({ n_steps * num_envs, -1 }).index_select(0, indices),
+        values.view({ n_steps * num_envs, -1 }).index_select(0, indices),
+        log_probs.view({ n_steps * num_envs, -1 }).index_select(0, indices),
+        advantages.view({ n_steps * num_envs, -1 }).index_select(0, indices),
+        returns.view({ n_steps * num_envs, -1 }).index_select(0, indices)
+    );
+}
+
+void RolloutBuffer::GetBatch(const torch::Tensor& indices, RolloutSample& batch) const
+{
+    torch::NoGradGuard no_grad;
+
+    // Compact observations are gathered at their size in a reused
+    // scratch tensor, then converted in the output
+    if (compact)
+    {
+        if (!batch.compact_observation.defined())
+        {
+            batch.compact_observation = torch::empty({ 0 }, torch::kBFloat16);
+        }
+        torch::index_select_out(batch.compact_observation, observations.view({ n_steps * num_envs, -1 }), 0, indices);
+        if (!batch.observation.defined())
+        {
+            batch.observation = torch::empty({ 0 });
+        }
+        batch.observation.resize_(batch.compact_observation.sizes());
+        batch.observation.copy_(batch.compact_observation);
+    }
+
+    const std::pair<const torch::Tensor*, torch::Tensor*> fields[] = {
+        { compact ? nullptr : &observations, &batch.observation },
+        { &actions, &batch.action },
+        { &values, &batch.value },
+        { &log_probs, &batch.log_prob },
+        { &advantages, &batch.advantage },
+        { &returns, &batch.returns }
+    };
+    for (const auto& [field, out] : fields)
     {
-        data[i].clear();
-        rewards[i].clear();
-        episode_ends[i].clear();
+        if (field == nullptr)
+        {
+            continue;
+        }
+        if (!out->defined())
+        {
+            *out = torch::empty({ 0 });
+        }
+        torch::index_select_out(*out, field->view({ n_steps * num_envs, -1 }), 0, indices);
     }
 }
 
-RolloutSample RolloutBuffer::get(uint64_t index)
+size_t RolloutBuffer::GetMemorySize(const bool full_precision) const
 {
-    uint64_t i = 0;
-    while (index >= data[i].size())
+    size_t memory = 0;
+    for (const torch::Tensor* t : { &observations, &actions, &values, &log_probs, &advantages, &returns, &rewards })
     {
-        index -= data[i].size();
-        i += 1;
+        memory += t->numel() * (full_precision ? sizeof(float) : t->element_size());
     }
-    return data[i][index];
+    memory += full_precision || !compact ? n_steps * num_envs * sizeof(float) : episode_end_bits.size() * sizeof(uint64_t);
+    return memory;
 }
 
-torch::optional<uint64_t> RolloutBuffer::size() const
+torch::optional<size_t> RolloutBuffer::size() const
 {
-    uint64_t size = 0;
-    for (int i = 0; i < data.size(); ++i)
+    size_t size = 0;
+    for (const int64_t p : positions)
     {
-        size += data[i].size();
+        size += p;
     }
     return size;
 }
 
+int64_t RolloutBuffer::GetNumEnvs() const
+{
+    return num_envs;
+}
+
+int64_t RolloutBuffer::GetNumSteps() const
+{
+    return n_steps;
+}
+
 void RolloutBuffer::ComputeReturnsAndAdvantage(const torch::Tensor& value,
     const float gamma, const float lambda_gae)
 {
     torch::NoGradGuard no_grad;
 
-    for (int env = 0; env < data.size(); ++env)
+    const int64_t T = positions[0];
+    for (int64_t i = 0; i < num_envs; ++i)
     {
-        for (int i = data[env].size() - 1; i > -1; --i)
+        if (positions[i] != T)
         {
-            torch::Tensor next_value;
-            torch::Tensor next_gae_lambda;
-            if (i == data[env].size() - 1)
-            {
-                next_value = value[env];
-                next_gae_lambda = torch::zeros_like(value[env]);
-            }
-            else
-            {
-                next_value = data[env][i + 1].value;
-                next_gae_lambda = data[env][i + 1].advantage;
-            }
-            float next_step_same_episode = episode_ends[env][i] ? 0.0f : 1.0f;
-            torch::Tensor delta = rewards[env][i] + gamma * next_value * next_step_same_episode - data[env][i].value;
-            data[env][i].advantage = delta + gamma * lambda_gae * next_step_same_episode * next_gae_lambda;
-            data[env][i].returns = data[env][i].advantage + data[env][i].value;
+            throw std::runtime_error("All envs must have the same number of steps to compute returns in RolloutBuffer");
         }
     }
+
+    // Sweep backward in time once over the storage, with all the envs
+    // processed together at each step. Operations are done in the same order as the
+    // per env tensor version so results are bit-identical (this file is compiled
+    // without floating point contraction, see CMakeLists.txt)
+    const torch::Tensor last_value = value.to(torch::kCPU, torch::kFloat).contiguous();
+    const float* last_value_data = last_value.data_ptr<float>();
+    const float* rewards_data = rewards.data_ptr<float>();
+    const float* values_data = values.data_ptr<float>();
+    float* advantages_data = advantages.data_ptr<float>();
+    float* returns_data = returns.data_ptr<float>();
+    const float* episode_ends_data = compact ? nullptr : episode_ends.data_ptr<float>();
+    const float gamma_lambda = gamma * lambda_gae;
+    const int64_t s = sample_stride;
+    for (int64_t t = T - 1; t > -1; --t)
+    {
+        const int64_t offset = t * num_envs;
+        for (int64_t i = 0; i < num_envs; ++i)
+        {
+            const float next_value = t == T - 1 ? last_value_data[i] : values_data[(offset + num_envs + i) * s];
+            const float next_gae_lambda = t == T - 1 ? 0.0f : advantages_data[offset + num_envs + i];
+            const float episode_end = compact ? static_cast<float>((episode_end_bits[(offset + i) / 64] >> ((offset + i) % 64)) & 1) : episode_ends_data[(offset + i) * s];
+            const float next_step_same_episode = 1.0f - episode_end;
+            const float delta = rewards_data[(offset + i) * s] + gamma * next_value * next_step_same_episode - values_data[(offset + i) * s];
+            advantages_data[offset + i] = delta + gamma_lambda * next_step_same_episode * next_gae_lambda;
+            returns_data[offset + i] = advantages_data[offset + i] + values_data[(offset + i) * s];
+        }
+    }
+}
+
+void RolloutBuffer::SetEpisodeEnd(const int64_t k, const bool ended)
+{
+    if (compact)
+    {
+        const uint64_t mask = uint64_t(1) << (k % 64);
+        episode_end_bits[k / 64] = ended ? (episode_end_bits[k / 64] | mask) : (episode_end_bits[k / 64] & ~mask);
+    }
+    else
+    {
+        episode_ends.data_ptr<float>()[k * sample_stride] = ended ? 1.0f : 0.0f;
+    }
 }
@@ -0,0 +1,69 @@
+#include "torchrl/rl/SACPolicy.hpp"
+#include "torchrl/rl/NormalDistribution.hpp"
+
+#include <cmath>
+
+namespace
+{
+    const float log_std_min = -20.0f;
+    const float log_std_max = 2.0f;
+    const float log_2 = std::log(2.0f);
+}
+
+SquashedGaussianActorImpl::SquashedGaussianActorImpl(const int64_t obs_dim, const int64_t action_dim_, const float action_scale_)
+{
+    action_dim = action_dim_;
+    action_scale = action_scale_;
+
+    net = register_module("net", MLP(obs_dim, 64, 2 * action_dim));
+}
+
+SquashedGaussianActorImpl::~SquashedGaussianActorImpl()
+{
+
+}
+
+std::pair<torch::Tensor, torch::Tensor> SquashedGaussianActorImpl::forward(const torch::Tensor& observations, const bool deterministic)
+{
+    const torch::Tensor out = net(observations);
+    const torch::Tensor means = out.narrow(1, 0, action_dim);
+    const torch::Tensor log_std = torch::clamp(out.narrow(1, action_dim, action_dim), log_std_min, log_std_max);
+
+    NormalDistribution dist(means, log_std.exp());
+    const torch::Tensor u = deterministic ? means : dist.Sample(observations.size(0));
+
+    // Change of variable for a = scale * tanh(u): log(1 - tanh(u)^2) is
+    // computed as 2 * (log(2) - u - softplus(-2u)) for numerical stability
+    const torch::Tensor log_prob = dist.LogProb(u)
+        - (2.0f * (log_2 - u - torch::softplus(-2.0f * u))).sum(1, true)
+        - action_dim * std::log(action_scale);
+
+    return { action_scale * torch::tanh(u), log_prob };
+}
+
+const MLP& SquashedGaussianActorImpl::GetNet() const
+{
+    return net;
+}
+
+float SquashedGaussianActorImpl::GetActionScale() const
+{
+    return action_scale;
+}
+
+TwinQNetworkImpl::TwinQNetworkImpl(const int64_t obs_dim, const int64_t action_dim)
+{
+    q1 = register_module("q1", MLP(obs_dim + action_dim, 64, 1));
+    q2 = register_module("q2", MLP(obs_dim + action_dim, 64, 1));
+}
+
+TwinQNetworkImpl::~TwinQNetworkImpl()
+{
+
+}
+
+std::pair<torch::Tensor, torch::Tensor> TwinQNetworkImpl::forward(const torch::Tensor& observations, const torch::Tensor& actions)
+{
+    const torch::Tensor in = torch::cat({ observations, actions }, 1);
+    return { q1(in), q2(in) };
+}
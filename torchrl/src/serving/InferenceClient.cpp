@@ -0,0 +1,104 @@
+#include "torchrl/serving/InferenceClient.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+    /// @brief Send or receive exactly n bytes, looping on partial transfers
+    template<class F>
+    void Transfer(F f, char* data, const size_t n, const char* what)
+    {
+        size_t done = 0;
+        while (done < n)
+        {
+            const ssize_t r = f(data + done, n - done);
+            if (r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (r <= 0)
+            {
+                throw std::runtime_error(std::string("InferenceClient can't ") + what + ", is the server still running?");
+            }
+            done += r;
+        }
+    }
+#endif
+}
+
+InferenceClient::InferenceClient(const std::string& socket_path)
+{
+#ifdef __linux__
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("InferenceClient socket path is too long: " + socket_path);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("InferenceClient can't connect to " + socket_path);
+    }
+
+    uint32_t sizes[2];
+    Transfer([&](char* p, size_t n) { return recv(fd, p, n, 0); }, reinterpret_cast<char*>(sizes), sizeof(sizes), "receive the handshake");
+    obs_size = sizes[0];
+    action_size = sizes[1];
+#else
+    throw std::runtime_error("InferenceClient is only available on Linux");
+#endif
+}
+
+InferenceClient::~InferenceClient()
+{
+#ifdef __linux__
+    close(fd);
+#endif
+}
+
+int64_t InferenceClient::GetObservationSize() const
+{
+    return obs_size;
+}
+
+int64_t InferenceClient::GetActionSize() const
+{
+    return action_size;
+}
+
+void InferenceClient::Act(const float* obs, float* action)
+{
+#ifdef __linux__
+    Transfer([&](char* p, size_t n) { return send(fd, p, n, MSG_NOSIGNAL); },
+        reinterpret_cast<char*>(const_cast<float*>(obs)), obs_size * sizeof(float), "send the observation");
+    Transfer([&](char* p, size_t n) { return recv(fd, p, n, 0); },
+        reinterpret_cast<char*>(action), action_size * sizeof(float), "receive the action");
+#endif
+}
+
+torch::Tensor InferenceClient::Act(const torch::Tensor& obs)
+{
+    const torch::Tensor input = obs.to(torch::kCPU, torch::kFloat).contiguous();
+    if (input.numel() != obs_size)
+    {
+        throw std::runtime_error("InferenceClient observation has " + std::to_string(input.numel()) + " values instead of " + std::to_string(obs_size));
+    }
+    torch::Tensor action = torch::empty({ action_size });
+    Act(input.data_ptr<float>(), action.data_ptr<float>());
+    return action;
+}
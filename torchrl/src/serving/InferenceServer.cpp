@@ -0,0 +1,394 @@
+#include "torchrl/serving/InferenceServer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// @brief Latencies are counted in a log-linear histogram: 1us wide buckets below
+    /// 2^latency_sub_bits us, then 2^latency_sub_bits buckets per power of 2 up to 2^32 us.
+    /// Percentiles are read with a relative error below 2^-(latency_sub_bits + 1)
+    constexpr int latency_sub_bits = 4;
+    constexpr size_t num_latency_buckets = (32 - latency_sub_bits + 2) << latency_sub_bits;
+
+    size_t LatencyBucket(const float latency_us)
+    {
+        const uint64_t us = static_cast<uint64_t>(std::max(latency_us, 0.0f));
+        if (us < (1ull << latency_sub_bits))
+        {
+            return us;
+        }
+        int exponent = latency_sub_bits;
+        while (exponent < 32 && (us >> (exponent + 1)) != 0)
+        {
+            exponent += 1;
+        }
+        // Top latency_sub_bits bits after the leading one
+        const size_t sub = std::min<uint64_t>((us >> (exponent - latency_sub_bits)) - (1ull << latency_sub_bits), (1ull << latency_sub_bits) - 1);
+        return (static_cast<size_t>(exponent - latency_sub_bits + 1) << latency_sub_bits) + sub;
+    }
+
+    /// @brief Get the middle of the latencies counted in a bucket
+    float LatencyBucketValue(const size_t bucket)
+    {
+        if (bucket < (1ull << latency_sub_bits))
+        {
+            return bucket + 0.5f;
+        }
+        const int exponent = static_cast<int>(bucket >> latency_sub_bits) - 1 + latency_sub_bits;
+        const size_t sub = bucket & ((1ull << latency_sub_bits) - 1);
+        const float width = static_cast<float>(1ull << (exponent - latency_sub_bits));
+        return ((1ull << latency_sub_bits) + sub) * width + 0.5f * width;
+    }
+}
+
+InferenceServer::InferenceServer(Policy policy_, const std::string& socket_path_,
+    const int64_t max_batch_size_, const int64_t max_wait_us_, const bool deterministic_)
+    : policy(policy_), running(false)
+{
+    socket_path = socket_path_;
+    max_batch_size = max_batch_size_;
+    max_wait_us = max_wait_us_;
+    deterministic = deterministic_;
+    obs_size = policy->GetActorNet()->GetLayers()[0]->weight.size(1);
+    action_size = policy->GetLogStd().size(0);
+    listen_fd = -1;
+    wake_pipe[0] = -1;
+    wake_pipe[1] = -1;
+    num_batches = 0;
+    num_requests = 0;
+    receive_start = 0;
+    latency_histogram = std::vector<uint64_t>(num_latency_buckets, 0);
+
+    if (max_batch_size < 1)
+    {
+        throw std::runtime_error("InferenceServer max batch size must be at least 1");
+    }
+    batch_size_histogram = std::vector<uint64_t>(max_batch_size + 1, 0);
+}
+
+InferenceServer::~InferenceServer()
+{
+    Stop();
+}
+
+void InferenceServer::Start()
+{
+#ifdef __linux__
+    if (running)
+    {
+        throw std::runtime_error("InferenceServer is already running");
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("InferenceServer socket path is too long: " + socket_path);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        throw std::runtime_error("Can't create InferenceServer socket");
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+        throw std::runtime_error("Can't listen on InferenceServer socket " + socket_path);
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+    if (pipe(wake_pipe) != 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+        throw std::runtime_error("Can't create InferenceServer wake up pipe");
+    }
+
+    running = true;
+    thread = std::thread(&InferenceServer::Run, this);
+#else
+    throw std::runtime_error("InferenceServer is only available on Linux");
+#endif
+}
+
+void InferenceServer::Stop()
+{
+#ifdef __linux__
+    if (!running)
+    {
+        return;
+    }
+
+    running = false;
+    const char c = 0;
+    if (write(wake_pipe[1], &c, 1) < 0)
+    {
+        // The thread will still stop, just not wake up immediately if it's waiting
+    }
+    thread.join();
+
+    for (const auto& [fd, client] : clients)
+    {
+        close(fd);
+    }
+    clients.clear();
+    batch_fds.clear();
+    batch_times.clear();
+    batch_obs.clear();
+
+    close(listen_fd);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    listen_fd = -1;
+    wake_pipe[0] = -1;
+    wake_pipe[1] = -1;
+    unlink(socket_path.c_str());
+#endif
+}
+
+int64_t InferenceServer::GetObservationSize() const
+{
+    return obs_size;
+}
+
+int64_t InferenceServer::GetActionSize() const
+{
+    return action_size;
+}
+
+InferenceServerStats InferenceServer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    InferenceServerStats stats;
+    stats.num_requests = num_requests;
+    stats.num_batches = num_batches;
+    stats.batch_size_histogram = batch_size_histogram;
+    if (num_requests > 0)
+    {
+        const std::pair<uint64_t, float*> percentiles[] = {
+            { (num_requests - 1) * 50 / 100, &stats.latency_p50_us },
+            { (num_requests - 1) * 99 / 100, &stats.latency_p99_us }
+        };
+        for (const auto& [rank, percentile] : percentiles)
+        {
+            uint64_t count = 0;
+            for (size_t i = 0; i < latency_histogram.size(); ++i)
+            {
+                count += latency_histogram[i];
+                if (count > rank)
+                {
+                    *percentile = LatencyBucketValue(i);
+                    break;
+                }
+            }
+        }
+    }
+    return stats;
+}
+
+void InferenceServer::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    std::fill(latency_histogram.begin(), latency_histogram.end(), 0);
+    num_requests = 0;
+    std::fill(batch_size_histogram.begin(), batch_size_histogram.end(), 0);
+    num_batches = 0;
+}
+
+void InferenceServer::Run()
+{
+#ifdef __linux__
+    torch::NoGradGuard no_grad;
+    policy->train(false);
+
+    std::vector<pollfd> poll_fds;
+    while (running)
+    {
+        // Clients with a request in the batch can't send anything before being answered
+        poll_fds.clear();
+        poll_fds.push_back({ wake_pipe[0], POLLIN, 0 });
+        poll_fds.push_back({ listen_fd, POLLIN, 0 });
+        for (const auto& [fd, client] : clients)
+        {
+            if (!client.pending)
+            {
+                poll_fds.push_back({ fd, POLLIN, 0 });
+            }
+        }
+
+        // Wait for new requests until the oldest one in the batch reaches the budget
+        timespec timeout;
+        timespec* timeout_ptr = nullptr;
+        if (!batch_fds.empty())
+        {
+            const int64_t remaining_ns = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                batch_times[0] + std::chrono::microseconds(max_wait_us) - std::chrono::steady_clock::now()).count());
+            timeout.tv_sec = remaining_ns / 1000000000;
+            timeout.tv_nsec = remaining_ns % 1000000000;
+            timeout_ptr = &timeout;
+        }
+        if (ppoll(poll_fds.data(), poll_fds.size(), timeout_ptr, nullptr) < 0)
+        {
+            continue;
+        }
+        if (!running)
+        {
+            break;
+        }
+
+        if (poll_fds[1].revents & POLLIN)
+        {
+            Accept();
+        }
+        // The first client read rotates, so when there are more requests than
+        // room in the batch, the same clients aren't always the ones served first
+        const size_t num_client_fds = poll_fds.size() - 2;
+        for (size_t k = 0; k < num_client_fds; ++k)
+        {
+            // Requests of the other clients stay in their sockets until the next batch
+            if (static_cast<int64_t>(batch_fds.size()) >= max_batch_size)
+            {
+                break;
+            }
+            const size_t i = 2 + (receive_start + k) % num_client_fds;
+            if (poll_fds[i].revents == 0)
+            {
+                continue;
+            }
+            if (!Receive(poll_fds[i].fd, clients[poll_fds[i].fd]))
+            {
+                CloseClient(poll_fds[i].fd);
+            }
+        }
+        receive_start = num_client_fds > 0 ? (receive_start + 1) % num_client_fds : 0;
+
+        if (!batch_fds.empty() && (static_cast<int64_t>(batch_fds.size()) >= max_batch_size ||
+            std::chrono::steady_clock::now() >= batch_times[0] + std::chrono::microseconds(max_wait_us)))
+        {
+            RunBatch();
+        }
+    }
+#endif
+}
+
+void InferenceServer::Accept()
+{
+#ifdef __linux__
+    while (true)
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        // The handshake is small enough to be sent at once on a new socket
+        const uint32_t sizes[2] = { static_cast<uint32_t>(obs_size), static_cast<uint32_t>(action_size) };
+        if (send(fd, sizes, sizeof(sizes), MSG_NOSIGNAL) != sizeof(sizes))
+        {
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        Client& client = clients[fd];
+        client.obs.resize(obs_size);
+    }
+#endif
+}
+
+bool InferenceServer::Receive(const int fd, Client& client)
+{
+#ifdef __linux__
+    const size_t request_bytes = obs_size * sizeof(float);
+    const ssize_t n = recv(fd, reinterpret_cast<char*>(client.obs.data()) + client.received_bytes, request_bytes - client.received_bytes, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        return false;
+    }
+    if (n < 0)
+    {
+        return true;
+    }
+
+    client.received_bytes += n;
+    if (client.received_bytes == request_bytes)
+    {
+        client.received_bytes = 0;
+        client.pending = true;
+        batch_fds.push_back(fd);
+        batch_times.push_back(std::chrono::steady_clock::now());
+        batch_obs.insert(batch_obs.end(), client.obs.begin(), client.obs.end());
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void InferenceServer::RunBatch()
+{
+#ifdef __linux__
+    const int64_t batch_size = batch_fds.size();
+    const torch::Tensor obs = torch::from_blob(batch_obs.data(), { batch_size, obs_size });
+    const torch::Tensor actions = std::get<0>(policy(obs, deterministic)).to(torch::kFloat).contiguous();
+    const float* actions_data = actions.data_ptr<float>();
+
+    std::vector<int> dropped;
+    batch_latencies_us.resize(batch_size);
+    const size_t answer_bytes = action_size * sizeof(float);
+    for (int64_t i = 0; i < batch_size; ++i)
+    {
+        // Answers are small, a client that can't take one at once is not following the protocol
+        if (send(batch_fds[i], actions_data + i * action_size, answer_bytes, MSG_NOSIGNAL) != static_cast<ssize_t>(answer_bytes))
+        {
+            dropped.push_back(batch_fds[i]);
+        }
+        clients[batch_fds[i]].pending = false;
+        batch_latencies_us[i] = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - batch_times[i]).count();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        for (const float latency_us : batch_latencies_us)
+        {
+            latency_histogram[LatencyBucket(latency_us)] += 1;
+        }
+        num_requests += batch_size;
+        batch_size_histogram[batch_size] += 1;
+        num_batches += 1;
+    }
+
+    batch_fds.clear();
+    batch_times.clear();
+    batch_obs.clear();
+
+    for (const int fd : dropped)
+    {
+        CloseClient(fd);
+    }
+#endif
+}
+
+void InferenceServer::CloseClient(const int fd)
+{
+#ifdef __linux__
+    close(fd);
+    clients.erase(fd);
+#endif
+}
@@ -0,0 +1,180 @@
+#include "torchrl/utils/Distributed.hpp"
+#include "torchrl/envs/RunningMeanStd.hpp"
+
+#include <algorithm>
+
+#ifdef WITH_DISTRIBUTED
+#include <torch/csrc/distributed/c10d/FileStore.hpp>
+#include <torch/csrc/distributed/c10d/ProcessGroupGloo.hpp>
+#endif
+
+#ifdef WITH_DISTRIBUTED
+struct Distributed::Impl
+{
+    c10::intrusive_ptr<c10d::ProcessGroupGloo> process_group;
+};
+#else
+struct Distributed::Impl
+{
+
+};
+#endif
+
+Distributed::Distributed(const int rank_, const int world_size_, const std::string& store_path)
+{
+    if (world_size_ < 1 || rank_ < 0 || rank_ >= world_size_)
+    {
+        throw std::runtime_error("Invalid rank " + std::to_string(rank_) + " for a world size of " + std::to_string(world_size_) + " in Distributed");
+    }
+    rank = rank_;
+    world_size = world_size_;
+    impl = std::make_unique<Impl>();
+
+#ifdef WITH_DISTRIBUTED
+    if (world_size > 1)
+    {
+        c10::intrusive_ptr<c10d::FileStore> store = c10::make_intrusive<c10d::FileStore>(store_path, world_size);
+        c10::intrusive_ptr<c10d::ProcessGroupGloo::Options> options = c10d::ProcessGroupGloo::Options::create();
+        // All the processes are on this machine
+        options->devices.push_back(c10d::ProcessGroupGloo::createDeviceForHostname("127.0.0.1"));
+        impl->process_group = c10::make_intrusive<c10d::ProcessGroupGloo>(store, rank, world_size, options);
+    }
+#else
+    if (world_size > 1)
+    {
+        throw std::runtime_error("Can't create a group of " + std::to_string(world_size) + " processes, torchRL was compiled without TORCHRL_DISTRIBUTED");
+    }
+#endif
+}
+
+Distributed::~Distributed()
+{
+
+}
+
+int Distributed::GetRank() const
+{
+    return rank;
+}
+
+int Distributed::GetWorldSize() const
+{
+    return world_size;
+}
+
+void Distributed::AllReduceSum(std::vector<torch::Tensor>& tensors) const
+{
+#ifdef WITH_DISTRIBUTED
+    if (world_size > 1)
+    {
+        impl->process_group->allreduce(tensors)->wait();
+    }
+#endif
+}
+
+void Distributed::Broadcast(std::vector<torch::Tensor>& tensors, const int root) const
+{
+#ifdef WITH_DISTRIBUTED
+    if (world_size > 1)
+    {
+        c10d::BroadcastOptions options;
+        options.rootRank = root;
+        // gloo broadcast only takes one tensor per process
+        for (torch::Tensor& t : tensors)
+        {
+            std::vector<torch::Tensor> single = { t };
+            impl->process_group->broadcast(single, options)->wait();
+        }
+    }
+#endif
+}
+
+void Distributed::AverageGradients(const std::vector<torch::Tensor>& parameters) const
+{
+    if (world_size == 1)
+    {
+        return;
+    }
+
+    torch::NoGradGuard no_grad;
+
+    // Pack all the gradients in one buffer so there is only one all-reduce
+    std::vector<torch::Tensor> grads;
+    grads.reserve(parameters.size());
+    for (const torch::Tensor& p : parameters)
+    {
+        if (p.grad().defined())
+        {
+            grads.push_back(p.grad().reshape({ -1 }));
+        }
+    }
+    if (grads.empty())
+    {
+        return;
+    }
+
+    std::vector<torch::Tensor> packed = { torch::cat(grads) };
+    AllReduceSum(packed);
+    packed[0].div_(world_size);
+
+    int64_t offset = 0;
+    for (const torch::Tensor& p : parameters)
+    {
+        if (p.grad().defined())
+        {
+            const int64_t n = p.grad().numel();
+            p.grad().copy_(packed[0].slice(0, offset, offset + n).view_as(p.grad()));
+            offset += n;
+        }
+    }
+}
+
+void Distributed::BroadcastParameters(const std::vector<torch::Tensor>& parameters, const int root) const
+{
+    if (world_size == 1)
+    {
+        return;
+    }
+
+    torch::NoGradGuard no_grad;
+
+    std::vector<torch::Tensor> tensors;
+    tensors.reserve(parameters.size());
+    for (const torch::Tensor& p : parameters)
+    {
+        tensors.push_back(p.detach().contiguous());
+    }
+    Broadcast(tensors, root);
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        // No-op if the parameter was already contiguous, as tensors[i] is then a view of it
+        parameters[i].detach().copy_(tensors[i]);
+    }
+}
+
+void Distributed::SyncRunningMeanStd(RunningMeanStd& rms, torch::Tensor& last_synced) const
+{
+    if (world_size == 1)
+    {
+        last_synced = rms.GetState();
+        return;
+    }
+
+    const torch::Tensor state = rms.GetState();
+    const torch::Tensor base = last_synced.defined() ? last_synced : torch::zeros_like(state);
+
+    // Gather the new samples statistics of every process, one row each
+    std::vector<torch::Tensor> gathered = { torch::zeros({ world_size, state.numel() }, torch::kDouble) };
+    gathered[0][rank].copy_(RunningMeanStd::SubtractState(state, base));
+    AllReduceSum(gathered);
+
+    // Add them all to the common base, merged in a tree
+    std::vector<RunningMeanStd> stats(world_size + 1, rms);
+    stats[0].SetState(base);
+    for (int i = 0; i < world_size; ++i)
+    {
+        stats[i + 1].SetState(gathered[0][i]);
+    }
+    rms = RunningMeanStd::Reduce(stats);
+    last_synced = rms.GetState();
+}
@@ -0,0 +1,143 @@
+#include "torchrl/utils/SumTree.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+SumTree::SumTree(const int64_t capacity_)
+{
+    if (capacity_ < 1)
+    {
+        throw std::runtime_error("SumTree capacity must be at least 1");
+    }
+    capacity = capacity_;
+    num_leaves = 1;
+    depth = 0;
+    while (num_leaves < capacity)
+    {
+        num_leaves *= 2;
+        depth += 1;
+    }
+    Clear();
+}
+
+SumTree::~SumTree()
+{
+
+}
+
+void SumTree::Update(const int64_t* indices, const float* priorities, const int64_t n)
+{
+    for (int64_t i = 0; i < n; ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= capacity)
+        {
+            throw std::runtime_error("SumTree index " + std::to_string(indices[i]) + " out of range [0, " + std::to_string(capacity) + ")");
+        }
+        sums[num_leaves + indices[i]] = priorities[i];
+        mins[num_leaves + indices[i]] = priorities[i] > 0.0f ? priorities[i] : std::numeric_limits<float>::infinity();
+    }
+
+    // Parents are recomputed from their children one level at a time, so each
+    // node is written once per level even if several updated leaves share it.
+    // Nothing is accumulated, so the tree doesn't drift after many updates
+    sorted.assign(indices, indices + n);
+    std::sort(sorted.begin(), sorted.end());
+    for (int64_t& node : sorted)
+    {
+        node += num_leaves;
+    }
+    for (int level = 0; level < depth; ++level)
+    {
+        int64_t previous = 0;
+        for (int64_t& node : sorted)
+        {
+            node >>= 1;
+            if (node == previous)
+            {
+                continue;
+            }
+            previous = node;
+            sums[node] = sums[2 * node] + sums[2 * node + 1];
+            mins[node] = std::min(mins[2 * node], mins[2 * node + 1]);
+        }
+    }
+}
+
+void SumTree::Find(const float* values, const int64_t n, int64_t* indices_out) const
+{
+    // Values are rewritten as the remaining prefix sum in the current subtree
+    std::vector<float> remaining(values, values + n);
+    std::fill(indices_out, indices_out + n, 1);
+
+    for (int level = 0; level < depth; ++level)
+    {
+        for (int64_t i = 0; i < n; ++i)
+        {
+            const int64_t left = 2 * indices_out[i];
+            const float left_sum = sums[left];
+            // Going right into an empty subtree can only come from a rounding error
+            const bool right = remaining[i] >= left_sum && sums[left + 1] > 0.0f;
+            remaining[i] -= right ? left_sum : 0.0f;
+            indices_out[i] = left + right;
+        }
+    }
+
+    for (int64_t i = 0; i < n; ++i)
+    {
+        indices_out[i] -= num_leaves;
+    }
+}
+
+void SumTree::Sample(const int64_t n, std::mt19937& random_engine, int64_t* indices_out, float* priorities_out) const
+{
+    const float total = GetTotal();
+    if (!(total > 0.0f))
+    {
+        throw std::runtime_error("Can't sample from a SumTree with only zero priorities");
+    }
+
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    const float segment = total / n;
+    std::vector<float> values(n);
+    for (int64_t i = 0; i < n; ++i)
+    {
+        values[i] = std::min((i + distribution(random_engine)) * segment, total);
+    }
+    Find(values.data(), n, indices_out);
+
+    if (priorities_out != nullptr)
+    {
+        for (int64_t i = 0; i < n; ++i)
+        {
+            priorities_out[i] = sums[num_leaves + indices_out[i]];
+        }
+    }
+}
+
+float SumTree::Get(const int64_t index) const
+{
+    return sums[num_leaves + index];
+}
+
+float SumTree::GetTotal() const
+{
+    return sums[1];
+}
+
+float SumTree::GetMin() const
+{
+    return mins[1];
+}
+
+int64_t SumTree::GetCapacity() const
+{
+    return capacity;
+}
+
+void SumTree::Clear()
+{
+    sums.assign(2 * num_leaves, 0.0f);
+    mins.assign(2 * num_leaves, std::numeric_limits<float>::infinity());
+}
@@ -0,0 +1,173 @@
+#include "torchrl/utils/ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::TaskGroup::TaskGroup()
+{
+    pending = 0;
+}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+
+}
+
+void ThreadPool::TaskGroup::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return pending == 0; });
+
+    if (exception)
+    {
+        std::exception_ptr e = exception;
+        exception = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void ThreadPool::TaskGroup::Add()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending += 1;
+}
+
+void ThreadPool::TaskGroup::Done(const std::exception_ptr& e)
+{
+    // Notify while holding the lock, so the group can't be
+    // destroyed by a waiting thread before we are done with it
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e && !exception)
+    {
+        exception = e;
+    }
+    pending -= 1;
+    if (pending == 0)
+    {
+        condition.notify_all();
+    }
+}
+
+ThreadPool::ThreadPool(const int num_threads)
+{
+    tasks = std::vector<Task>(64);
+    tasks_head = 0;
+    num_tasks = 0;
+    stop = false;
+
+    workers.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i)
+    {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        stop = true;
+    }
+    tasks_condition.notify_all();
+    for (auto& w : workers)
+    {
+        if (w.joinable())
+        {
+            w.join();
+        }
+    }
+}
+
+int ThreadPool::GetNumThreads() const
+{
+    return static_cast<int>(workers.size());
+}
+
+void ThreadPool::Submit(const std::function<void(const int64_t, const int64_t)>& f,
+    const int64_t begin, const int64_t end, TaskGroup& group)
+{
+    group.Add();
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        if (num_tasks == tasks.size())
+        {
+            // Unroll the ring in a bigger buffer
+            std::vector<Task> new_tasks(2 * tasks.size());
+            for (size_t i = 0; i < num_tasks; ++i)
+            {
+                new_tasks[i] = tasks[(tasks_head + i) % tasks.size()];
+            }
+            tasks = std::move(new_tasks);
+            tasks_head = 0;
+        }
+        tasks[(tasks_head + num_tasks) % tasks.size()] = Task{ &f, begin, end, &group };
+        num_tasks += 1;
+    }
+    tasks_condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(const int64_t N, const std::function<void(const int64_t, const int64_t)>& f)
+{
+    const int64_t num_shards = std::min<int64_t>(N, workers.size() + 1);
+    if (num_shards < 2)
+    {
+        if (N > 0)
+        {
+            f(0, N);
+        }
+        return;
+    }
+
+    TaskGroup group;
+    for (int64_t s = 1; s < num_shards; ++s)
+    {
+        Submit(f, s * N / num_shards, (s + 1) * N / num_shards, group);
+    }
+
+    // Process the first shard in this thread instead of waiting idle
+    std::exception_ptr exception;
+    try
+    {
+        f(0, N / num_shards);
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    // Always wait for the other shards, as they reference f
+    group.Wait();
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(tasks_mutex);
+            tasks_condition.wait(lock, [this] { return stop || num_tasks > 0; });
+            if (num_tasks == 0)
+            {
+                return;
+            }
+            task = tasks[tasks_head];
+            tasks_head = (tasks_head + 1) % tasks.size();
+            num_tasks -= 1;
+        }
+
+        std::exception_ptr exception;
+        try
+        {
+            (*task.f)(task.begin, task.end);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        task.group->Done(exception);
+    }
+}